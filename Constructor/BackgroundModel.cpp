@@ -0,0 +1,105 @@
+#include "Stdafx.h"
+
+#include "BackgroundModel.h"
+#include "ScaledFrameSource.h"
+#include "Exception.h"
+
+#include "background_model.cuh"
+
+BackgroundModel::BackgroundModel(void)
+{
+	this->m_NumFrames = 0;
+
+	this->m_Treshold = BACKGROUND_TRESHOLD;
+	this->m_LearningRate = BACKGROUND_LEARNING_RATE;
+
+	this->m_IsLearned = false;
+}
+
+BackgroundModel::~BackgroundModel(void)
+{
+}
+
+void BackgroundModel::Learn(const cv::cuda::GpuMat &frame)
+{
+	assert(frame.type() == CV_8UC3);
+	assert(!this->m_IsLearned);
+
+	if (this->m_NumFrames == 0)
+	{
+		this->m_Mean.create(frame.size(), CV_32FC3);
+		this->m_Variance.create(frame.size(), CV_32FC3);
+
+		this->m_Mean.setTo(cv::Scalar::all(0));
+		this->m_Variance.setTo(cv::Scalar::all(0));
+	}
+	else if (frame.size() != this->m_Mean.size())
+	{
+		throw_line("Background frames should all have the same size");
+	}
+
+	// While learning the variance holds the sum of squared differences
+	learn_background(frame, this->m_Mean, this->m_Variance, ++this->m_NumFrames);
+}
+
+bool BackgroundModel::Learn(const std::string &videoFile, const cv::Size &size, const unsigned int maxFrames)
+{
+	cv::VideoCapture video(videoFile);
+	if (!video.isOpened())
+	{
+		return false;
+	}
+
+	cv::Mat frame;
+	cv::cuda::GpuMat gpuFrame;
+	while (this->m_NumFrames < maxFrames && video.read(frame))
+	{
+		if (frame.cols > size.width || frame.rows > size.height)
+		{
+			ScaledFrameSource::Reduce(frame, frame, size);
+		}
+
+		gpuFrame.upload(frame);
+		this->Learn(gpuFrame);
+	}
+
+	video.release();
+
+	if (this->m_NumFrames == 0)
+	{
+		return false;
+	}
+
+	this->Finalize();
+
+	return true;
+}
+
+void BackgroundModel::Finalize(void)
+{
+	if (this->m_NumFrames == 0)
+	{
+		throw_line("Background model has not seen any frames");
+	}
+
+	finalize_background(this->m_Variance, this->m_NumFrames, BACKGROUND_MIN_VARIANCE);
+
+	this->m_IsLearned = true;
+}
+
+const cv::cuda::GpuMat &BackgroundModel::ComputeMatte(const cv::cuda::GpuMat &in)
+{
+	assert(this->m_IsLearned);
+
+	if (in.size() != this->m_Mean.size())
+	{
+		throw_line("Frame size doesn't match the background model");
+	}
+
+	// Only allocates on the first frame
+	this->m_Matte.create(in.size(), CV_8UC1);
+
+	segment_background(in, this->m_Mean, this->m_Variance, this->m_Treshold, this->m_LearningRate, BACKGROUND_MIN_VARIANCE, this->m_Matte);
+
+	return this->m_Matte;
+}
\ No newline at end of file
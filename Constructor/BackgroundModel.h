@@ -0,0 +1,58 @@
+#pragma once
+
+// Pixels further than this many standard deviations from the background are foreground
+#define BACKGROUND_TRESHOLD 4.0f
+
+// Lower bound of the variance per channel, keeps perfectly still pixels from turning foreground on sensor noise
+#define BACKGROUND_MIN_VARIANCE 9.0f
+
+// Rate at which background pixels are blended into the model while segmenting, 0 freezes the model
+#define BACKGROUND_LEARNING_RATE 0.01f
+
+// Maximum number of empty stage frames the model is learned from
+#define BACKGROUND_MAX_FRAMES 100
+
+// Per pixel statistical model of the empty stage, segments by comparing frames with the running mean and variance. An
+// alternative to the distance keyer when lighting is too uneven for a single key color
+class BackgroundModel
+{
+private:
+	cv::cuda::GpuMat m_Mean;
+	cv::cuda::GpuMat m_Variance;
+
+	// Matte storage, reused every frame
+	cv::cuda::GpuMat m_Matte;
+
+	unsigned int m_NumFrames;
+
+	float m_Treshold;
+	float m_LearningRate;
+
+	bool m_IsLearned;
+public:
+	BackgroundModel(void);
+	~BackgroundModel(void);
+
+	// Add an empty stage frame to the model
+	void Learn(const cv::cuda::GpuMat &frame);
+
+	// Learn from (up to maxFrames of) an empty stage video and finish the model, returns false if the video can't be read.
+	// Larger frames are reduced to the given size, that of the frames the camera decodes
+	bool Learn(const std::string &videoFile, const cv::Size &size, const unsigned int maxFrames = BACKGROUND_MAX_FRAMES);
+
+	// Done learning, the model can be used for segmenting
+	void Finalize(void);
+
+	// The returned matte is owned by the model and overwritten by the next call
+	const cv::cuda::GpuMat &ComputeMatte(const cv::cuda::GpuMat &in);
+
+	bool IsLearned(void) const { return this->m_IsLearned; }
+
+	unsigned int GetNumFrames(void) const { return this->m_NumFrames; }
+
+	void SetTreshold(const float treshold) { this->m_Treshold = treshold; }
+	float GetTreshold(void) const { return this->m_Treshold; }
+
+	void SetLearningRate(const float learningRate) { this->m_LearningRate = learningRate; }
+	float GetLearningRate(void) const { return this->m_LearningRate; }
+};
\ No newline at end of file
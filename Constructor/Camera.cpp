@@ -2,8 +2,15 @@
 
 #include "Common.h"
 #include "Camera.h"
+#include "VideoFrameSource.h"
+#include "ScaledFrameSource.h"
 #include "Exception.h"
 
+#include "silhouette.cuh"
+#include "yuv.cuh"
+#include "raw.cuh"
+#include "tiled_image.cuh"
+
 Camera::Camera(Settings &settings, std::string cameraPath, const int id) : m_Id(id), m_Settings(settings), m_CameraPath(cameraPath)
 {
 	this->m_Initialized = false;
@@ -20,62 +27,134 @@ Camera::Camera(Settings &settings, std::string cameraPath, const int id) : m_Id(
 
 	// Number of frames
 	this->m_Frames = 0;
+	this->m_FrameNumber = 0;
+	this->m_Timestamp = -1;
+	this->m_TimestampOffset = 0;
+
+	this->m_MatteCache = 0;
+	this->m_IsSilhouetteCached = false;
+
+	this->m_Source = 0;
+	this->m_MatteSource = 0;
+
+	this->m_Prefetcher = 0;
+
+	this->m_FramePool = 0;
+	this->m_MattePool = 0;
+	this->m_FrameStaging = -1;
+	this->m_MatteStaging = -1;
+
+	this->m_Stream = 0;
+	this->m_Uploaded = 0;
+
+	this->m_IsFrameConverted = true;
+	this->m_IsFrameTiled = false;
 }
 
 Camera::~Camera(void)
 {
+	delete this->m_Prefetcher;
+
+	// Pools wait for the uploads from their buffers
+	delete this->m_FramePool;
+	delete this->m_MattePool;
+
+	if (this->m_Stream != 0)
+	{
+		cudaStreamDestroy(this->m_Stream);
+		cudaEventDestroy(this->m_Uploaded);
+	}
+
+	delete this->m_MatteCache;
+	delete this->m_MatteSource;
+	delete this->m_Source;
 }
 
 bool Camera::Initialize(void)
 {
-	// Open the video for this camera
-	this->m_Video = cv::VideoCapture(this->m_CameraPath + Common::VideoFile);
+	// Open the frames of this camera, a raw frame file or image sequence stored under the name of the video takes its place
+	this->m_Source = FrameSource::Open(this->m_CameraPath, Common::VideoFile, this->m_Settings.UseYuvFrames);
+	if (this->m_Source == 0)
 	{
-		assert(this->m_Video.isOpened());
+		throw_line("Unable to locate: " + this->m_CameraPath + Common::VideoFile);
+	}
 
-		// Determine image size
-		this->m_FrustumSize.width = (int)this->m_Video.get(CV_CAP_PROP_FRAME_WIDTH);
-		this->m_FrustumSize.height = (int)this->m_Video.get(CV_CAP_PROP_FRAME_HEIGHT);
-		assert(this->m_FrustumSize.area() > 0);
+	this->m_SourceSize = this->m_Source->GetSize();
+	this->m_Frames = this->m_Source->GetNumFrames();
 
-		// Fetch number of frames
-		this->m_Video.set(CV_CAP_PROP_POS_AVI_RATIO, 1);
-		this->m_Frames = (long)this->m_Video.get(CV_CAP_PROP_POS_FRAMES);
-		assert(this->m_Frames > 1);
-		this->m_Video.set(CV_CAP_PROP_POS_AVI_RATIO, 0);
+	const VideoFrameSource *video = dynamic_cast<const VideoFrameSource*>(this->m_Source);
+	if (video != 0 && video->GetIndex().IsEmpty())
+	{
+		std::cout << "No keyframe index for camera " << this->m_Id + 1 << ", seeks are left to the decoder" << std::endl;
+	}
+	else if (video != 0)
+	{
+		std::cout << "Video of camera " << this->m_Id + 1 << " has " << video->GetIndex().GetNumKeyframes() << " keyframes" << std::endl;
+	}
 
-		// Rewind
-		this->m_Video.release();
+	// Reduced frames, neither the capture nor the image reader decode at a lower resolution so frames are box filtered
+	if (this->m_Settings.DecodeScale > 1)
+	{
+		this->m_Source = new ScaledFrameSource(this->m_Source, this->m_Settings.DecodeScale, this->m_Settings.UseYuvFrames);
 	}
-	this->m_Video = cv::VideoCapture(this->m_CameraPath + Common::VideoFile);
 
-	// Load matte video if required
-	this->m_MatteVideo = cv::VideoCapture(this->m_CameraPath + Common::MatteVideo);
+	this->m_FrustumSize = this->m_Source->GetSize();
+
+	if (this->m_Settings.UseYuvFrames && ((this->m_FrustumSize.width & 1) != 0 || (this->m_FrustumSize.height & 3) != 0))
+	{
+		throw_line("YUV frames require a width that is a multiple of 2 and a height that is a multiple of 4");
+	}
+
+	if (this->m_FrustumSize != this->m_SourceSize)
 	{
-		assert(this->m_MatteVideo.isOpened());
+		std::cout << "Camera " << this->m_Id + 1 << " decodes " << this->m_SourceSize.width << "x" << this->m_SourceSize.height << " frames at " << this->m_FrustumSize.width << "x" << this->m_FrustumSize.height << std::endl;
+	}
 
-		// Determine image size
-		cv::Size size;
-		size.width = (int)this->m_MatteVideo.get(CV_CAP_PROP_FRAME_WIDTH);
-		size.height = (int)this->m_MatteVideo.get(CV_CAP_PROP_FRAME_HEIGHT);
-		assert(size.area() > 0);
+	// Capture times from an external sync, when there is one
+	cv::FileStorage timestamps;
+	timestamps.open(this->m_CameraPath + Common::TimestampsFile, cv::FileStorage::READ);
+	if (timestamps.isOpened())
+	{
+		timestamps["Timestamps"] >> this->m_Timestamps;
+		timestamps.release();
 
-		// Fetch number of frames
-		this->m_MatteVideo.set(CV_CAP_PROP_POS_AVI_RATIO, 1);
-		const int frames = (long)this->m_MatteVideo.get(CV_CAP_PROP_POS_FRAMES);
-		assert(frames > 1);
-		this->m_MatteVideo.set(CV_CAP_PROP_POS_AVI_RATIO, 0);
+		if ((long)this->m_Timestamps.size() < this->m_Frames)
+		{
+			throw_line("Timestamps file lists fewer frames than the video has");
+		}
+	}
+	else if (this->m_Source->GetFrameRate() > 0)
+	{
+		// Times of the source start wherever the container starts, count them from the first frame of the video
+		cv::Mat first;
+		if (this->m_Source->Read(first) && this->m_Source->GetTimestamp() >= 0)
+		{
+			this->m_TimestampOffset = this->m_Source->GetTimestamp();
+		}
 
-		// Rewind
-		this->m_MatteVideo.release();
+		this->m_Source->Seek(0);
+	}
+
+	// Load matte video if required
+	if (this->m_Settings.UseMatteVideo)
+	{
+		this->m_MatteSource = FrameSource::Open(this->m_CameraPath, Common::MatteVideo, false);
+		if (this->m_MatteSource == 0)
+		{
+			throw_line("Unable to locate: " + this->m_CameraPath + Common::MatteVideo);
+		}
+
+		if (this->m_Settings.DecodeScale > 1)
+		{
+			this->m_MatteSource = new ScaledFrameSource(this->m_MatteSource, this->m_Settings.DecodeScale, false);
+		}
 
 		// Check if matte video is of same length as normal video
-		if (size.width != this->m_FrustumSize.width || size.height != this->m_FrustumSize.height || frames != this->m_Frames)
+		if (this->m_MatteSource->GetSize() != this->m_FrustumSize || this->m_MatteSource->GetNumFrames() != this->m_Frames || this->m_MatteSource->GetFormat() != FRAME_FORMAT_BGR)
 		{
 			throw_line("Matte video is not equal to video input");
 		}
 	}
-	this->m_MatteVideo = cv::VideoCapture(this->m_CameraPath + Common::MatteVideo);
 
 	// Read the camera properties
 	cv::FileStorage fs;
@@ -96,6 +175,19 @@ bool Camera::Initialize(void)
 
 		fs.release();
 
+		// Calibration is done on full frames, the camera matrix is scaled along with reduced frames. Pixel centers are
+		// at integer coordinates, a reduced pixel is centered on the block it averages
+		if (this->m_Settings.DecodeScale > 1)
+		{
+			const float scale = 1.0f / this->m_Settings.DecodeScale;
+
+			*this->m_CameraMatrix.ptr<float>(0, 0) *= scale;
+			*this->m_CameraMatrix.ptr<float>(0, 1) *= scale;
+			*this->m_CameraMatrix.ptr<float>(1, 1) *= scale;
+			*this->m_CameraMatrix.ptr<float>(0, 2) = (*this->m_CameraMatrix.ptr<float>(0, 2) + 0.5f) * scale - 0.5f;
+			*this->m_CameraMatrix.ptr<float>(1, 2) = (*this->m_CameraMatrix.ptr<float>(1, 2) + 0.5f) * scale - 0.5f;
+		}
+
 		// Reload focal length and principal point
 		this->m_Fx = *this->m_CameraMatrix.ptr<float>(0, 0);
 		this->m_Fy = *this->m_CameraMatrix.ptr<float>(1, 1);
@@ -115,6 +207,34 @@ bool Camera::Initialize(void)
 	// Initialize camera parameters
 	this->InitializeCameraLocation();
 	this->DefineFrustumPoints();
+	this->DefineFloorPoints();
+
+	this->LoadMask();
+
+	// Open (or start) the matte cache
+	if (this->m_Settings.UseMatteCache)
+	{
+		this->m_MatteCache = new MatteCache(this->m_CameraPath + Common::MatteCacheFile, this->m_FrustumSize, this->ComputeMatteSignature());
+
+		std::cout << "Matte cache of camera " << this->m_Id + 1 << " holds " << this->m_MatteCache->GetNumFrames() << " frames, " << this->m_MatteCache->GetSize() / 1000 << "KB" << std::endl;
+	}
+
+	// Uploads of every camera are queued on a stream of its own. The stream synchronizes with the legacy default stream
+	// OpenCV uses, kernels on per-thread default streams wait for the upload event
+	if (cudaStreamCreate(&this->m_Stream) != cudaSuccess || cudaEventCreateWithFlags(&this->m_Uploaded, cudaEventDisableTiming) != cudaSuccess)
+	{
+		throw_line("Failed to create upload stream");
+	}
+
+	// Room for the frames decoded ahead, the frame being decoded and the current frame
+	this->m_FramePool = new StagingPool(this->m_Settings.PrefetchDepth + 2);
+	this->m_MattePool = new StagingPool(this->m_Settings.PrefetchDepth + 2);
+
+	// Start decoding ahead
+	if (this->m_Settings.PrefetchDepth > 0)
+	{
+		this->m_Prefetcher = new FramePrefetcher(this->m_Source, this->m_MatteSource, this->m_FramePool, this->m_MattePool, this->m_Settings.PrefetchDepth);
+	}
 
 	// Indicate that the camera is initialized
 	this->m_Initialized = true;
@@ -122,36 +242,154 @@ bool Camera::Initialize(void)
 	return true;
 }
 
-cv::cuda::GpuMat &Camera::NextVideoFrame(void)
+bool Camera::NextVideoFrame(void)
 {
-	// Fetch new frame
-	cv::Mat frame;
-	this->m_Video >> frame;
+	// Fetch new frame, prefetched frames come with their matte. Both are in staging buffers
+	cv::Mat frame, matteFrame;
+	int frameStaging = -1, matteStaging = -1;
+	if (this->m_Prefetcher != 0)
+	{
+		PrefetchedFrame prefetched;
+		if (!this->m_Prefetcher->Pop(prefetched))
+		{
+			return false;
+		}
+
+		this->m_FrameNumber = prefetched.Number;
+		this->m_Timestamp = prefetched.Timestamp;
+		frame = prefetched.Frame;
+		matteFrame = prefetched.Matte;
+		frameStaging = prefetched.FrameStaging;
+		matteStaging = prefetched.MatteStaging;
+	}
+	else
+	{
+		this->m_FrameNumber = this->m_Source->GetPosition();
+
+		if (!FramePrefetcher::ReadFrame(this->m_Source, this->m_FramePool, frame, frameStaging))
+		{
+			return false;
+		}
+
+		this->m_Timestamp = this->m_Source->GetTimestamp();
+	}
 	assert(!frame.empty());
 
-	// Upload to device
-	this->m_Frame.upload(frame);
+	if (this->m_FrameNumber < (int)this->m_Timestamps.size())
+	{
+		this->m_Timestamp = this->m_Timestamps[this->m_FrameNumber];
+	}
+	else if (this->m_Timestamp >= 0)
+	{
+		this->m_Timestamp -= this->m_TimestampOffset;
+	}
 
-	if (this->m_Settings.UseMatteVideo)
+	this->UploadFrame(frame);
+
+	// A cached silhouette replaces decoding the matte video or keying the frame
+	this->m_IsSilhouetteCached = this->m_MatteCache != 0 && this->m_MatteCache->GetFrame(this->m_FrameNumber, this->m_CachedSilhouette);
+	if (this->m_IsSilhouetteCached)
+	{
+		this->m_ForegroundImage.release();
+		this->Upload(this->m_CachedSilhouette, this->m_Silhouette);
+	}
+	else if (this->m_Settings.UseMatteVideo)
 	{
-		cv::Mat matteFrame;
-		this->m_MatteVideo >> matteFrame;
-		assert(!matteFrame.empty());
+		if (this->m_Prefetcher == 0)
+		{
+			// Catch up on matte frames that were skipped because they were cached, converted to greyscale
+			this->m_MatteSource->Seek(this->m_FrameNumber);
 
-		// Convert the #$@#%!% to grayscale
-		cv::cvtColor(matteFrame, matteFrame, CV_BGR2GRAY);
+			FramePrefetcher::ReadMatte(this->m_MatteSource, this->m_MattePool, matteFrame, matteStaging);
+			assert(!matteFrame.empty());
+		}
 
 		// Upload to device
-		this->m_ForegroundImage.upload(matteFrame);
+		this->Upload(matteFrame, this->m_ForegroundImage);
 	}
 
-	return this->m_Frame;
+	// The buffers of the previous frame are reused once everything queued so far is uploaded
+	cudaEventRecord(this->m_Uploaded, this->m_Stream);
+	if (this->m_FrameStaging >= 0)
+	{
+		this->m_FramePool->Release(this->m_FrameStaging, this->m_Stream);
+	}
+	if (this->m_MatteStaging >= 0)
+	{
+		this->m_MattePool->Release(this->m_MatteStaging, this->m_Stream);
+	}
+	this->m_FrameStaging = frameStaging;
+	this->m_MatteStaging = matteStaging;
+
+	this->WaitForUpload();
+
+	if (!this->m_IsSilhouetteCached && this->m_Settings.UseMatteVideo)
+	{
+		this->PackSilhouette();
+	}
+
+	return true;
+}
+
+bool Camera::SkipVideoFrames(const int count)
+{
+	if (count <= 0)
+	{
+		return true;
+	}
+
+	// Frames that are decoded already are cheaper to drop than seeking past them
+	if (this->m_Prefetcher != 0 && (size_t)count <= this->m_Prefetcher->GetDepth())
+	{
+		PrefetchedFrame skipped;
+		for (int i = 0 ; i < count ; ++i)
+		{
+			if (!this->m_Prefetcher->Pop(skipped))
+			{
+				return false;
+			}
+
+			this->m_FrameNumber = skipped.Number;
+
+			if (skipped.FrameStaging >= 0)
+			{
+				this->m_FramePool->Release(skipped.FrameStaging);
+			}
+			if (skipped.MatteStaging >= 0)
+			{
+				this->m_MattePool->Release(skipped.MatteStaging);
+			}
+		}
+
+		return true;
+	}
+
+	// Count from the current frame, the source belongs to the prefetcher and may have read further. Sources start at 0
+	const int frame = (this->HasFrame() ? this->m_FrameNumber + 1 : 0) + count;
+	if (frame >= this->m_Frames)
+	{
+		return false;
+	}
+
+	this->SetVideoFrame(frame);
+
+	return true;
 }
 
 void Camera::SetVideoFrame(int frameNumber)
 {
-	this->m_Video.set(CV_CAP_PROP_POS_FRAMES, frameNumber);
-	this->m_MatteVideo.set(CV_CAP_PROP_POS_FRAMES, frameNumber);
+	if (this->m_Prefetcher != 0)
+	{
+		this->m_Prefetcher->Seek(frameNumber);
+		return;
+	}
+
+	this->m_Source->Seek(frameNumber);
+
+	if (this->m_MatteSource != 0)
+	{
+		this->m_MatteSource->Seek(frameNumber);
+	}
 }
 
 void Camera::LoadForegroundFromMatteVideo(void)
@@ -168,14 +406,278 @@ void Camera::LoadForegroundFromMatteStill(void)
 		throw_line("Could not read camera still image!");
 	}
 
+	if (this->m_Settings.DecodeScale > 1)
+	{
+		ScaledFrameSource::Reduce(hostMatte, hostMatte, this->m_FrustumSize);
+	}
+
 	this->m_ForegroundImage.upload(hostMatte);
+	this->PackSilhouette();
 }
 
-cv::cuda::GpuMat Camera::GetVideoFrame(int frameNumber)
+void Camera::CacheSilhouette(void)
+{
+	if (this->m_MatteCache == 0 || this->m_Silhouette.empty() || this->m_MatteCache->HasFrame(this->m_FrameNumber))
+	{
+		return;
+	}
+
+	this->m_Silhouette.download(this->m_CachedSilhouette);
+	this->m_MatteCache->AddFrame(this->m_FrameNumber, this->m_CachedSilhouette);
+}
+
+void Camera::SetKeySignature(const unsigned long long int signature)
+{
+	if (this->m_MatteCache != 0)
+	{
+		this->m_MatteCache->SetKeySignature(signature);
+	}
+}
+
+unsigned long long int Camera::ComputeMatteSignature(void)
+{
+	MatteSignature signature;
+
+	// How silhouettes are made
+	signature.Add(this->m_Settings.UseMatteVideo);
+	signature.Add(this->m_Settings.UseBackgroundModel);
+	signature.Add(this->m_Settings.UseHostKeyer);
+	signature.Add(this->m_Settings.UseKeyTable);
+	signature.Add(this->m_Settings.UseYuvFrames);
+	signature.Add(this->m_Settings.UseAutoTreshold);
+	signature.Add(this->m_Settings.KeyRefreshInterval);
+
+	// Cleanup
+	signature.Add(this->m_Settings.CleanupRadius);
+	signature.Add(this->m_Settings.FillHoles);
+
+	// Region of interest and garbage mask
+	signature.Add(this->m_Roi.x);
+	signature.Add(this->m_Roi.y);
+	signature.Add(this->m_Roi.width);
+	signature.Add(this->m_Roi.height);
+
+	if (!this->m_Mask.empty())
+	{
+		cv::Mat mask;
+		this->m_Mask.download(mask);
+
+		for (int y = 0 ; y < mask.rows ; ++y)
+		{
+			signature.Add(mask.ptr<unsigned int>(y), sizeof(unsigned int) * mask.cols);
+		}
+	}
+
+	return signature.Get();
+}
+
+void Camera::PackSilhouette(void)
+{
+	if (this->m_ForegroundImage.empty())
+	{
+		this->m_Silhouette.release();
+		return;
+	}
+
+	this->m_Silhouette.create(this->m_ForegroundImage.rows, silhouette_words(this->m_ForegroundImage.cols), CV_32SC1);
+
+	pack_silhouette(this->m_ForegroundImage, this->m_Mask, this->m_Silhouette);
+
+	// Tile the frame on the thread that segments this camera, in stead of serially while carving
+	if (this->m_Settings.UseTiledImages && this->HasFrame() && !this->m_IsFrameTiled)
+	{
+		this->TileFrame();
+	}
+}
+
+void Camera::LoadMask(void)
+{
+	const cv::Rect frame(cv::Point(0, 0), this->m_FrustumSize);
+
+	// Region of interest as x, y, width, height
+	this->m_Roi = frame;
+
+	cv::FileStorage fs;
+	fs.open(this->m_CameraPath + Common::RoiFile, cv::FileStorage::READ);
+	if (fs.isOpened())
+	{
+		std::vector<int> roi;
+		fs["Roi"] >> roi;
+		fs.release();
+
+		if (roi.size() != 4)
+		{
+			throw_line("Region of interest should be given as x, y, width and height");
+		}
+
+		// Given on full frames, reduced regions keep every pixel that is partly inside
+		const int scale = this->m_Settings.DecodeScale;
+		this->m_Roi = cv::Rect(cv::Point(roi[0] / scale, roi[1] / scale), cv::Point((roi[0] + roi[2] + scale - 1) / scale, (roi[1] + roi[3] + scale - 1) / scale)) & frame;
+		if (this->m_Roi.area() == 0)
+		{
+			throw_line("Region of interest lies outside of the frame");
+		}
+	}
+
+	// Non zero pixels of the garbage mask are garbage
+	cv::Mat garbage = cv::imread(this->m_CameraPath + Common::GarbageMaskFile, CV_LOAD_IMAGE_GRAYSCALE);
+	if (garbage.data && garbage.size() != this->m_SourceSize)
+	{
+		throw_line("Garbage mask is not equal to video input");
+	}
+
+	// Reduced pixels are garbage when any part of them is
+	if (garbage.data && garbage.size() != this->m_FrustumSize)
+	{
+		cv::threshold(garbage, garbage, 0, 255, cv::THRESH_BINARY);
+		ScaledFrameSource::Reduce(garbage, garbage, this->m_FrustumSize);
+	}
+
+	if (!garbage.data && this->m_Roi == frame)
+	{
+		this->m_Mask.release();
+		return;
+	}
+
+	cv::Mat keep(this->m_FrustumSize, CV_8UC1, cv::Scalar(0));
+	keep(this->m_Roi).setTo(cv::Scalar(255));
+	if (garbage.data)
+	{
+		keep.setTo(cv::Scalar(0), garbage);
+	}
+
+	cv::cuda::GpuMat gpuKeep;
+	gpuKeep.upload(keep);
+
+	this->m_Mask.create(this->m_FrustumSize.height, silhouette_words(this->m_FrustumSize.width), CV_32SC1);
+	pack_silhouette(gpuKeep, cv::cuda::PtrStepSz<uint>(), this->m_Mask);
+
+	std::cout << "Camera " << this->m_Id + 1 << " keys " << this->m_Roi.width << "x" << this->m_Roi.height << " at (" << this->m_Roi.x << ", " << this->m_Roi.y << ")" << (garbage.data ? ", with garbage mask" : "") << std::endl;
+}
+
+void Camera::GetVideoFrame(int frameNumber)
 {
 	this->SetVideoFrame(frameNumber);
 
-	return this->NextVideoFrame();
+	if (!this->NextVideoFrame())
+	{
+		throw_line("Read past the end of the video");
+	}
+}
+
+double Camera::GetFrameRate(void) const
+{
+	// Average rate over the sync file, the frames may not be evenly spaced
+	if (this->m_Timestamps.size() > 1 && this->m_Timestamps.back() > this->m_Timestamps.front())
+	{
+		return (this->m_Timestamps.size() - 1) / (this->m_Timestamps.back() - this->m_Timestamps.front());
+	}
+
+	return this->m_Source->GetFrameRate();
+}
+
+void Camera::UploadFrame(const cv::Mat &frame)
+{
+	const FrameFormat format = this->m_Source->GetFormat();
+
+	this->m_IsFrameTiled = false;
+
+	// Raw frames are a third (Bayer) or two thirds (UYVY) of the size of BGR frames, they're converted after the upload
+	if (format != FRAME_FORMAT_BGR)
+	{
+		this->m_HostFrame.release();
+
+		this->Upload(frame, this->m_RawFrame);
+		this->m_YuvFrame.release();
+		this->m_Frame.create(this->m_FrustumSize, CV_8UC3);
+
+		// The conversion runs on this thread's stream
+		cudaEventRecord(this->m_Uploaded, this->m_Stream);
+		this->WaitForUpload();
+
+		switch (format)
+		{
+		case FRAME_FORMAT_BAYER_RGGB:
+			convert_bayer_frame(this->m_RawFrame, make_int2(0, 0), this->m_Frame);
+			break;
+		case FRAME_FORMAT_BAYER_GRBG:
+			convert_bayer_frame(this->m_RawFrame, make_int2(1, 0), this->m_Frame);
+			break;
+		case FRAME_FORMAT_BAYER_GBRG:
+			convert_bayer_frame(this->m_RawFrame, make_int2(0, 1), this->m_Frame);
+			break;
+		case FRAME_FORMAT_BAYER_BGGR:
+			convert_bayer_frame(this->m_RawFrame, make_int2(1, 1), this->m_Frame);
+			break;
+		case FRAME_FORMAT_UYVY:
+			convert_uyvy_frame(this->m_RawFrame, this->m_Frame);
+			break;
+		}
+
+		this->m_IsFrameConverted = true;
+	}
+	// YUV frames are half the size of BGR frames and are converted lazily
+	else if (this->m_Settings.UseYuvFrames && is_yuv_frame(frame.rows, frame.cols, this->m_FrustumSize.width, this->m_FrustumSize.height))
+	{
+		this->m_HostFrame.release();
+
+		this->Upload(frame, this->m_YuvFrame);
+		this->m_IsFrameConverted = false;
+	}
+	else
+	{
+		if (this->m_Settings.UseYuvFrames && this->m_Frame.empty())
+		{
+			std::cout << "Camera " << this->m_Id + 1 << " doesn't decode to YUV, using BGR frames" << std::endl;
+		}
+
+		this->m_YuvFrame.release();
+
+		// Greyscale image sequences, the host frame may still point into the staging buffer of the previous frame
+		if (frame.channels() == 1)
+		{
+			this->m_HostFrame.release();
+			cv::cvtColor(frame, this->m_HostFrame, CV_GRAY2BGR);
+		}
+		else
+		{
+			this->m_HostFrame = frame;
+		}
+
+		this->Upload(this->m_HostFrame, this->m_Frame);
+
+		this->m_IsFrameConverted = true;
+	}
+}
+
+void Camera::Upload(const cv::Mat &host, cv::cuda::GpuMat &device)
+{
+	device.create(host.size(), host.type());
+
+	if (cudaMemcpy2DAsync(device.data, device.step, host.data, host.step, host.cols * host.elemSize(), host.rows, cudaMemcpyHostToDevice, this->m_Stream) != cudaSuccess)
+	{
+		throw_line("Failed to queue upload");
+	}
+}
+
+void Camera::WaitForUpload(void)
+{
+	cudaStreamWaitEvent(cudaStreamPerThread, this->m_Uploaded, 0);
+}
+
+void Camera::TileFrame(void)
+{
+	tile_frame(this->GetFrame(), this->m_TiledFrame);
+
+	this->m_IsFrameTiled = true;
+}
+
+void Camera::ConvertFrame(void)
+{
+	this->m_Frame.create(this->m_FrustumSize, CV_8UC3);
+	convert_yuv_frame(this->m_YuvFrame, this->m_Frame);
+
+	this->m_IsFrameConverted = true;
 }
 
 double Camera::ComputeReprojectionErrors(const std::vector<std::vector<cv::Point3f>> &objectPoints, const std::vector<std::vector<cv::Point2f>> &imagePoints, const std::vector<cv::Mat> &rvecs, const std::vector<cv::Mat> &tvecs, const cv::Mat &cameraMatrix, const cv::Mat &distCoeffs, std::vector<float> &perViewErrors)
@@ -294,8 +796,11 @@ bool Camera::Calibrate(void)
 
 					// Show the found pattern for a short while
 					cv::drawChessboardCorners(frame, boardSize, resultPointsBuffer, found);
-					cv::imshow("Calibration", frame);
-					cv::waitKey(10);
+					if (!this->m_Settings.Headless)
+					{
+						cv::imshow("Calibration", frame);
+						cv::waitKey(10);
+					}
 
 					results.push_back(frame);
 					imagePoints.push_back(resultPointsBuffer);
@@ -359,8 +864,11 @@ calibrate:
 				(*rit).copyTo(result);
 				cv::putText(result, ss.str(), cvPoint(30, 30), cv::FONT_HERSHEY_COMPLEX_SMALL, 0.8, cvScalar(200, 200, 250), 1, CV_AA);
 
-				cv::imshow("Result", result);
-				cv::waitKey(100);
+				if (!this->m_Settings.Headless)
+				{
+					cv::imshow("Result", result);
+					cv::waitKey(100);
+				}
 #endif
 
 				if (*it > TARGET_AVG_PROJECTION_ERROR)
@@ -393,7 +901,7 @@ calibrate:
 			}
 
 #if DISPLAY_REPROJECTION_OPTIMIZATION_RESULT
-			for (rit = results.begin() ; rit != results.end() ; ++rit)
+			for (rit = results.begin() ; rit != results.end() && !this->m_Settings.Headless ; ++rit)
 			{
 				cv::imshow("Result", *rit);
 				cv::waitKey(1000);
@@ -532,8 +1040,11 @@ bool Camera::ComputeExtrinsics(void)
 				cv::drawChessboardCorners(frame, boardSize, Camera::s_Corners, found);
 
 				// Draw the result
-				cv::imshow("Corners Validation", frame);
-				cv::waitKey(500);
+				if (!this->m_Settings.Headless)
+				{
+					cv::imshow("Corners Validation", frame);
+					cv::waitKey(500);
+				}
 
 				if (found)
 				{
@@ -713,6 +1224,35 @@ void Camera::DefineFrustumPoints(void)
 	this->m_Frustum.push_back(p);
 }
 
+void Camera::DefineFloorPoints(void)
+{
+	this->m_CameraFloor.clear();
+
+	// The floor footprint is where the rays through the image corners hit the checkerboard plane (z = 0), corners looking
+	// above the horizon never hit the floor and are left out
+	const cv::Point corners[4] = {
+		cv::Point(0, 0),
+		cv::Point(this->m_FrustumSize.width, 0),
+		cv::Point(this->m_FrustumSize.width, this->m_FrustumSize.height),
+		cv::Point(0, this->m_FrustumSize.height)
+	};
+
+	for (int i = 0 ; i < 4 ; ++i)
+	{
+		cv::Point3f direction = this->CameraSpaceToWorld(corners[i]) - this->m_CameraLocation;
+		if (direction.z == 0)
+		{
+			continue;
+		}
+
+		const float t = -this->m_CameraLocation.z / direction.z;
+		if (t > 0)
+		{
+			this->m_CameraFloor.push_back(this->m_CameraLocation + direction * t);
+		}
+	}
+}
+
 cv::Point3f Camera::CameraSpaceToWorld(const cv::Point &point)
 {
 	// Translate a 2d camera point to a 3d camera point by offsetting with the camera principal point and z half focal length
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "Settings.h"
+#include "MatteCache.h"
+#include "FrameSource.h"
+#include "FramePrefetcher.h"
+#include "StagingPool.h"
 
 #define REPROJECT_OPTIMIZATION 1
 #define DISPLAY_REPROJECTION_OPTIMIZATION_RESULT 1
@@ -20,10 +24,49 @@ class Camera
 
 	cv::cuda::GpuMat m_ForegroundImage;
 
-	cv::VideoCapture m_Video;
-	cv::VideoCapture m_MatteVideo;
+	// Packed 1 bit per pixel foreground, this is what carving reads
+	cv::cuda::GpuMat m_Silhouette;
 
+	// Static region of interest and garbage mask, pixels outside the region or under the garbage mask are never foreground.
+	// The mask is packed like the silhouette and combines both, it's empty when the whole frame is of interest
+	cv::Rect m_Roi;
+	cv::cuda::GpuMat m_Mask;
+
+	// Frames of the camera and, when the matte video is used, their mattes
+	FrameSource *m_Source;
+	FrameSource *m_MatteSource;
+
+	// Decodes ahead on a thread of its own, the sources are only read through it when set
+	FramePrefetcher *m_Prefetcher;
+
+	// Page-locked buffers frames and mattes are decoded into, the current frame and matte hold on to theirs until the
+	// next frame. Uploads are queued on the stream of the camera, the event marks the end of the uploads of the frame
+	StagingPool *m_FramePool;
+	StagingPool *m_MattePool;
+	int m_FrameStaging, m_MatteStaging;
+	cv::Mat m_HostFrame;
+
+	cudaStream_t m_Stream;
+	cudaEvent_t m_Uploaded;
+
+	// Frame number of the current frame in the video
+	int m_FrameNumber;
+
+	// Capture time in seconds of the current frame, negative if unknown. An external sync file (Common::TimestampsFile)
+	// lists the capture time of every frame and replaces the timing of the source. Times of the source are counted from
+	// the first frame of the video, they only line up with other cameras if the videos started together
+	double m_Timestamp;
+	double m_TimestampOffset;
+	std::vector<double> m_Timestamps;
+
+	// Silhouettes cached on disk, the host copy is reused every frame
+	MatteCache *m_MatteCache;
+	cv::Mat m_CachedSilhouette;
+	bool m_IsSilhouetteCached;
+
+	// Size of the frames as decoded and as stored, they differ when frames are reduced
 	cv::Size m_FrustumSize;
+	cv::Size m_SourceSize;
 
 	long m_Frames;
 
@@ -42,15 +85,46 @@ class Camera
 
 	cv::cuda::GpuMat m_Frame;
 
+	// Frame as decoded, I420 (see yuv.cuh), when the decoder hands out its native planes. The BGR frame is only converted
+	// from it when something asks for it
+	cv::cuda::GpuMat m_YuvFrame;
+	bool m_IsFrameConverted;
+
+	// Frame in the tiled layout (see tiled_image.cuh) for carving, made along with the silhouette. The buffer is kept
+	// across frames
+	cv::cuda::GpuMat m_TiledFrame;
+	bool m_IsFrameTiled;
+
+	// Frame as stored by a raw source, converted to BGR on the device right away
+	cv::cuda::GpuMat m_RawFrame;
+
 	std::vector<cv::Point2f> s_Corners;
 
 	void InitializeCameraLocation(void);
 
 	void DefineFrustumPoints(void);
 
+	void DefineFloorPoints(void);
+
+	void LoadMask(void);
+
+	// Signature of the settings of the camera the silhouettes depend on, see MatteCache
+	unsigned long long int ComputeMatteSignature(void);
+
 	cv::Point3f CameraSpaceToWorld(const cv::Point &);
 
 	cv::Point3f Camera3dToWorld(const cv::Point3f &);
+
+	void PackSilhouette(void);
+
+	void ConvertFrame(void);
+
+	void TileFrame(void);
+
+	void UploadFrame(const cv::Mat &frame);
+
+	// Queue the copy on the stream of the camera, the host memory should stay untouched until the copy is done
+	void Upload(const cv::Mat &host, cv::cuda::GpuMat &device);
 public:
 	Camera(Settings &settings, std::string cameraPath, const int id);
 	~Camera(void);
@@ -59,7 +133,23 @@ public:
 
 	cv::Point Project(const cv::Point3f &coords);
 
-	cv::cuda::GpuMat &NextVideoFrame(void);
+	// Returns false past the end of the video
+	bool NextVideoFrame(void);
+
+	// Move past the given number of frames without uploading them, returns false past the end of the video
+	bool SkipVideoFrames(const int count);
+
+	// Order the work this thread queues after the uploads of the current frame. Kernels run on the default stream of the
+	// thread that launches them, every thread touching the frame or matte of the camera should wait first
+	void WaitForUpload(void);
+
+	// Host copy of the current frame, as it was uploaded. Only BGR frames have one, returns false otherwise
+	bool GetHostFrame(cv::Mat &frame) const
+	{
+		frame = this->m_HostFrame;
+
+		return !frame.empty();
+	}
 	
 	bool IsInitialized(void) const
 	{
@@ -73,13 +163,45 @@ public:
 
 	static cv::Point Project(const cv::Point3f &, const cv::Mat &, const cv::Mat &, const cv::Mat &, const cv::Mat &);
 	
-	cv::cuda::GpuMat GetVideoFrame(int);
+	void GetVideoFrame(int);
 
 	cv::Mat GetConcatenateForegroundFrame(void);
 
 	void LoadForegroundFromMatteVideo(void);
 	void LoadForegroundFromMatteStill(void);
 
+	// Store the silhouette of the current frame in the matte cache, unless it's cached already
+	void CacheSilhouette(void);
+
+	// Signature of the keyer parameters the silhouettes are keyed with, cached silhouettes keyed otherwise are dropped
+	void SetKeySignature(const unsigned long long int signature);
+
+	// Frame number of the current frame in the video
+	int GetFrameNumber(void) const
+	{
+		return this->m_FrameNumber;
+	}
+
+	double GetTimestamp(void) const
+	{
+		return this->m_Timestamp;
+	}
+
+	// True if the capture times come from the sync file
+	bool HasSyncTimestamps(void) const
+	{
+		return !this->m_Timestamps.empty();
+	}
+
+	// Frames per second, 0 if the frames have no timing
+	double GetFrameRate(void) const;
+
+	// True if the silhouette of the current frame was read from the matte cache, it needs no segmenting
+	bool IsSilhouetteCached(void) const
+	{
+		return this->m_IsSilhouetteCached;
+	}
+
 	const std::string GetCameraPath(void)
 	{
 		return this->m_CameraPath;
@@ -110,9 +232,9 @@ public:
 		return this->m_Translation;
 	}
 
-	const cv::VideoCapture &GetVideo(void)
+	const FrameSource &GetSource(void) const
 	{
-		return this->m_Video;
+		return *this->m_Source;
 	}
 
 	long GetFrames(void)
@@ -130,11 +252,58 @@ public:
 		return this->m_ForegroundImage;
 	}
 
+	const cv::cuda::GpuMat &GetSilhouette(void)
+	{
+		return this->m_Silhouette;
+	}
+
+	const cv::Rect &GetRoi(void) const
+	{
+		return this->m_Roi;
+	}
+
+	const cv::cuda::GpuMat &GetMask(void) const
+	{
+		return this->m_Mask;
+	}
+
+	// Converts the frame to BGR first if it was decoded as YUV
 	const cv::cuda::GpuMat &GetFrame(void)
 	{
+		if (!this->m_IsFrameConverted)
+		{
+			this->ConvertFrame();
+		}
+
 		return this->m_Frame;
 	}
 
+	// Tiles the frame first if it wasn't tiled with the silhouette
+	const cv::cuda::GpuMat &GetTiledFrame(void)
+	{
+		if (!this->m_IsFrameTiled)
+		{
+			this->TileFrame();
+		}
+
+		return this->m_TiledFrame;
+	}
+
+	bool HasFrame(void) const
+	{
+		return !this->m_Frame.empty() || !this->m_YuvFrame.empty();
+	}
+
+	bool HasYuvFrame(void) const
+	{
+		return !this->m_YuvFrame.empty();
+	}
+
+	const cv::cuda::GpuMat &GetYuvFrame(void) const
+	{
+		return this->m_YuvFrame;
+	}
+
 	const std::vector<cv::Point3f> &GetCameraFloor(void)
 	{
 		return this->m_CameraFloor;
@@ -152,13 +321,24 @@ public:
 
 	void SetVideoFrame(int);
 
-	void SetVideo(const cv::VideoCapture &video)
+	void SetForegroundImage(const cv::cuda::GpuMat &foregroundImage)
 	{
-		this->m_Video = video;
+		this->m_ForegroundImage = foregroundImage;
+
+		this->PackSilhouette();
 	}
 
-	void SetForegroundImage(const cv::cuda::GpuMat &foregroundImage)
+	// Segmenters that produce a packed silhouette directly, there's no 8 bit matte afterwards
+	void SetSilhouette(const cv::cuda::GpuMat &silhouette)
 	{
-		this->m_ForegroundImage = foregroundImage;
+		this->m_ForegroundImage.release();
+
+		this->m_Silhouette = silhouette;
+
+		// The matte filter sets the silhouette again, the frame only needs tiling once
+		if (this->m_Settings.UseTiledImages && this->HasFrame() && !this->m_IsFrameTiled)
+		{
+			this->TileFrame();
+		}
 	}
 };
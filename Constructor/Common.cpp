@@ -12,6 +12,14 @@ const std::string Common::ConfigFile = "config.xml";
 const std::string Common::CalibrationImage = "calibration_%03d.png";
 const std::string Common::MatteStill = "matte.png";
 const std::string Common::MatteVideo = "matte.mp4";
+const std::string Common::VolumeFile = "volume.xml";
+const std::string Common::BackgroundVideoFile = "background.mkv";
+const std::string Common::MatteCacheFile = "matte.rle";
+const std::string Common::GarbageMaskFile = "garbage.png";
+const std::string Common::RoiFile = "roi.xml";
+const std::string Common::KeyColorsFile = "keycolors.xml";
+const std::string Common::TimestampsFile = "timestamps.xml";
+const std::string Common::FrameLogFile = ".frames.xml";
 
 void Common::MatToFloatArray(const cv::Mat &in, float *out)
 {
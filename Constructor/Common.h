@@ -34,6 +34,23 @@ public:
 
 	static const std::string MatteVideo;
 
+	static const std::string VolumeFile;
+
+	static const std::string BackgroundVideoFile;
+
+	static const std::string MatteCacheFile;
+
+	static const std::string GarbageMaskFile;
+
+	static const std::string RoiFile;
+
+	static const std::string KeyColorsFile;
+
+	static const std::string TimestampsFile;
+
+	// Appended to the output file name, lists the frame of every camera that went into each frame of the output
+	static const std::string FrameLogFile;
+
 	static void MatToFloatArray(const cv::Mat &in, float *out);
 
 	static void ProjectPoints(cv::Point3f point, const cv::Mat r_vec, const cv::Mat t_vec, const cv::Mat A, const cv::Mat distCoeffs, cv::Point &projectedPoint);
@@ -23,15 +23,93 @@ void Constructor::PrintUsage(void)
 	std::cout << "i			  : Flag indicating that calibration images should be used in stead of videos" << std::endl;
 	std::cout << "s			  : Flag indicating if a matte still should be used in stead of using the keyer" << std::endl;
 	std::cout << "m			  : Flag indicating if a matte video should be used in stead of using the keyer" << std::endl;
+	std::cout << "b			  : Flag indicating that carved voxels should be stored in a sparse brick map" << std::endl;
+	std::cout << "B			  : Flag indicating that only the hull surface of the brick map should be written, the interior is dropped (requires b)" << std::endl;
+	std::cout << "t			  : Out-of-core reconstruction, number of tiles per axis (numeric), tiles are spilled to the output location + .tiles" << std::endl;
+	std::cout << "V			  : Size of the voxel space (numeric), it spans 4 times this from the center along x and y and from the floor along z, 128 by default" << std::endl;
+	std::cout << "l			  : Real-time deadline mode, target latency per frame in milliseconds (numeric), the carving step and region adapt to meet it" << std::endl;
+	std::cout << "v			  : Flag indicating that the volume should be oriented to the capture area, read from volume.xml in the data path or derived from the camera floors" << std::endl;
+	std::cout << "c			  : Flag indicating that carving should emit the octree directly, blocks inside the hull become single full nodes" << std::endl;
+	std::cout << "x			  : Flag indicating that mattes and frames should be copied into a tiled layout of 8x8 pixel blocks before carving" << std::endl;
+	std::cout << "k			  : Flag indicating that the keyer should run on the host (AVX2 when available) in stead of on the GPU" << std::endl;
+	std::cout << "f			  : Flag indicating that keying should be fused into carving, no mattes are computed" << std::endl;
+	std::cout << "r			  : Re-estimate the key color every this many frames (numeric), by default only the first frame is used" << std::endl;
+	std::cout << "e			  : Flag indicating that a background model learned from an empty stage video (background.mkv per camera) should be used in stead of the keyer" << std::endl;
+	std::cout << "a			  : Flag indicating that silhouettes should be cached run-length encoded per camera (matte.rle), cached frames are not decoded or keyed again" << std::endl;
+	std::cout << "g			  : Clean up silhouettes with a morphological opening and closing, radius of the structuring element in pixels (numeric)" << std::endl;
+	std::cout << "u			  : Flag indicating that holes in the silhouettes should be filled" << std::endl;
+	std::cout << "p			  : Flag indicating that the keyer treshold should be found automatically per camera (Otsu) in stead of through the GUI" << std::endl;
+	std::cout << "w			  : Flag indicating that no windows should be opened and nothing should wait for input, for unattended runs" << std::endl;
+	std::cout << "y			  : Flag indicating that the keyer should look colors up in a table, also keys out the colors in keycolors.xml in the data path" << std::endl;
+	std::cout << "z			  : Flag indicating that frames should be decoded to YUV 4:2:0 and keyed on chroma, only the colors carving needs are converted" << std::endl;
+	std::cout << "j			  : Decode every camera on a thread of its own, number of frames decoded ahead (numeric)" << std::endl;
+	std::cout << "q			  : Frames to process as first[:last[:stride]] or first::stride (numeric), by default every frame of the videos" << std::endl;
+	std::cout << "R			  : Reduce frames and mattes by this factor as they're decoded (numeric), for previews and coarse carving steps" << std::endl;
 	std::cout << "h			  : This usage information" << std::endl;
 }
 
+bool Constructor::ParseFrameRange(const char *text, int &first, int &last, int &stride)
+{
+	char *end;
+
+	// Fields are parsed into copies, nothing is changed unless the whole range is valid
+	const long parsedFirst = strtol(text, &end, 10);
+	if (end == text || (*end != ':' && *end != '\0'))
+	{
+		return false;
+	}
+
+	long parsedLast = last, parsedStride = stride;
+	if (*end == ':')
+	{
+		text = end + 1;
+
+		// An empty last frame keeps the default, up to the end of the videos
+		if (*text != ':')
+		{
+			parsedLast = strtol(text, &end, 10);
+			if (end == text || (*end != ':' && *end != '\0'))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			end = (char*) text;
+		}
+
+		if (*end == ':')
+		{
+			text = end + 1;
+
+			parsedStride = strtol(text, &end, 10);
+			if (end == text || *end != '\0')
+			{
+				return false;
+			}
+		}
+	}
+
+	first = (int) parsedFirst;
+	last = (int) parsedLast;
+	stride = (int) parsedStride;
+
+	return true;
+}
+
 bool Constructor::ParseArguments(int argc, char **argv)
 {
 	bool hasNumCameras = false, hasDataPath = false, hasCompressedFileName = false;
 
+	// These are unsigned, they're assigned once validated
+	int decodeScale = this->m_Settings.DecodeScale;
+	int tileDivisions = this->m_Settings.TileDivisions;
+	int keyRefreshInterval = this->m_Settings.KeyRefreshInterval;
+	int cleanupRadius = this->m_Settings.CleanupRadius;
+	int prefetchDepth = this->m_Settings.PrefetchDepth;
+
 	int opt;
-	while ((opt = getopt(argc, argv, "n:d:o:hism")) != -1) 
+	while ((opt = getopt(argc, argv, "n:d:o:t:V:l:r:g:j:q:R:hismbBvcxkfeaupwyz")) != -1) 
 	{
 		switch (opt) 
 		{
@@ -66,6 +144,108 @@ bool Constructor::ParseArguments(int argc, char **argv)
 		case 'm':
 			this->m_Settings.UseMatteVideo = true;
 			break;
+		// Brick map?
+		case 'b':
+			this->m_Settings.UseBrickMap = true;
+			break;
+		// Brick map surface only?
+		case 'B':
+			this->m_Settings.BrickSurfaceOnly = true;
+			break;
+		// Out-of-core tiles
+		case 't':
+			tileDivisions = atoi(optarg);
+			if (tileDivisions < 1)
+			{
+				std::cout << "Parameter 't' should be at least 1!" << std::endl << std::endl;
+
+				Constructor::PrintUsage();
+				return false;
+			}
+			this->m_Settings.TileDivisions = tileDivisions;
+			break;
+		// Voxel space size
+		case 'V':
+			this->m_Settings.VolumeSize = atoi(optarg);
+			break;
+		// Key color refresh
+		case 'r':
+			keyRefreshInterval = atoi(optarg);
+			break;
+		// Deadline
+		case 'l':
+			this->m_Settings.TargetLatency = (float) atof(optarg);
+			break;
+		// Oriented volume?
+		case 'v':
+			this->m_Settings.UseOrientedVolume = true;
+			break;
+		// Hierarchical carving?
+		case 'c':
+			this->m_Settings.UseHierarchicalCarving = true;
+			break;
+		// Tiled images?
+		case 'x':
+			this->m_Settings.UseTiledImages = true;
+			break;
+		// Host keyer?
+		case 'k':
+			this->m_Settings.UseHostKeyer = true;
+			break;
+		// Fused keying?
+		case 'f':
+			this->m_Settings.UseFusedKeying = true;
+			break;
+		// Background model?
+		case 'e':
+			this->m_Settings.UseBackgroundModel = true;
+			break;
+		// Matte cache?
+		case 'a':
+			this->m_Settings.UseMatteCache = true;
+			break;
+		// Cleanup radius
+		case 'g':
+			cleanupRadius = atoi(optarg);
+			break;
+		// Fill holes?
+		case 'u':
+			this->m_Settings.FillHoles = true;
+			break;
+		// Automatic treshold?
+		case 'p':
+			this->m_Settings.UseAutoTreshold = true;
+			break;
+		// Headless?
+		case 'w':
+			this->m_Settings.Headless = true;
+			break;
+		// Key table?
+		case 'y':
+			this->m_Settings.UseKeyTable = true;
+			break;
+		// YUV frames?
+		case 'z':
+			this->m_Settings.UseYuvFrames = true;
+			break;
+		// Prefetch depth
+		case 'j':
+			prefetchDepth = atoi(optarg);
+			break;
+		// Frame range
+		case 'q':
+			if (!Constructor::ParseFrameRange(optarg, this->m_Settings.FirstFrame, this->m_Settings.LastFrame, this->m_Settings.FrameStride))
+			{
+				std::cout << "Parameter 'q' should be first[:last[:stride]] or first::stride!" << std::endl << std::endl;
+
+				Constructor::PrintUsage();
+				return false;
+			}
+			break;
+		// Decode scale
+		case 'R':
+			decodeScale = atoi(optarg);
+			break;
 		default:
 			std::cout << "Unknown option: " << (char) opt << std::endl << std::endl;
 
@@ -97,6 +277,142 @@ bool Constructor::ParseArguments(int argc, char **argv)
 		return false;
 	}
 
+	if (this->m_Settings.UseBrickMap && this->m_Settings.TileDivisions > 0)
+	{
+		std::cout << "Parameters 'b' and 't' can't be combined, the brick map keeps the whole voxel space in memory!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	if (this->m_Settings.VolumeSize < 1)
+	{
+		std::cout << "Parameter 'V' should be at least 1!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	if (this->m_Settings.BrickSurfaceOnly && !this->m_Settings.UseBrickMap)
+	{
+		std::cout << "Parameter 'B' requires 'b', only the brick map can tell the surface from the interior!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	if (this->m_Settings.UseHierarchicalCarving && (this->m_Settings.UseBrickMap || this->m_Settings.TileDivisions > 0))
+	{
+		std::cout << "Parameter 'c' can't be combined with 'b' or 't', hierarchical carving doesn't produce a voxel list!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	if (this->m_Settings.UseFusedKeying && (this->m_Settings.UseMatteStill || this->m_Settings.UseMatteVideo || this->m_Settings.UseHierarchicalCarving || this->m_Settings.UseHostKeyer))
+	{
+		std::cout << "Parameter 'f' can't be combined with 's', 'm', 'c' or 'k', these read or produce mattes!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	if (this->m_Settings.UseBackgroundModel && (this->m_Settings.UseMatteStill || this->m_Settings.UseMatteVideo || this->m_Settings.UseFusedKeying || this->m_Settings.UseHostKeyer))
+	{
+		std::cout << "Parameter 'e' can't be combined with 's', 'm', 'f' or 'k', the background model replaces the keyer!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	if (this->m_Settings.UseMatteCache && (this->m_Settings.UseMatteStill || this->m_Settings.UseFusedKeying))
+	{
+		std::cout << "Parameter 'a' can't be combined with 's' or 'f', there's no silhouette sequence to cache!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	if (cleanupRadius < 0 || cleanupRadius > MATTE_FILTER_MAX_RADIUS)
+	{
+		std::cout << "Parameter 'g' should be between 0 and " << MATTE_FILTER_MAX_RADIUS << "!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	this->m_Settings.CleanupRadius = cleanupRadius;
+
+	if (this->m_Settings.UseFusedKeying && (this->m_Settings.CleanupRadius > 0 || this->m_Settings.FillHoles))
+	{
+		std::cout << "Parameter 'f' can't be combined with 'g' or 'u', fused keying has no silhouettes to clean up!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	if (this->m_Settings.UseAutoTreshold && (this->m_Settings.UseMatteStill || this->m_Settings.UseMatteVideo || this->m_Settings.UseBackgroundModel))
+	{
+		std::cout << "Parameter 'p' can't be combined with 's', 'm' or 'e', these don't use the keyer!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	if (this->m_Settings.UseKeyTable && (this->m_Settings.UseMatteStill || this->m_Settings.UseMatteVideo || this->m_Settings.UseBackgroundModel || this->m_Settings.UseHostKeyer))
+	{
+		std::cout << "Parameter 'y' can't be combined with 's', 'm', 'e' or 'k', the key table is used by the GPU keyer only!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	if (this->m_Settings.UseYuvFrames && (this->m_Settings.UseTiledImages || this->m_Settings.UseHostKeyer || this->m_Settings.UseFusedKeying || this->m_Settings.UseKeyTable || this->m_Settings.UseAutoTreshold))
+	{
+		std::cout << "Parameter 'z' can't be combined with 'x', 'k', 'f', 'y' or 'p', these key or carve BGR frames!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	if (this->m_Settings.FirstFrame < 0 || this->m_Settings.FrameStride < 1 || (this->m_Settings.LastFrame >= 0 && this->m_Settings.LastFrame < this->m_Settings.FirstFrame))
+	{
+		std::cout << "Parameter 'q' needs a first frame of at least 0, a last frame after it and a stride of at least 1!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	if (decodeScale < 1)
+	{
+		std::cout << "Parameter 'R' should be at least 1!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	this->m_Settings.DecodeScale = decodeScale;
+
+	if (prefetchDepth < 0 || prefetchDepth > PREFETCH_MAX_DEPTH)
+	{
+		std::cout << "Parameter 'j' should be between 0 and " << PREFETCH_MAX_DEPTH << "!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	this->m_Settings.PrefetchDepth = prefetchDepth;
+
+	if (keyRefreshInterval < 0)
+	{
+		std::cout << "Parameter 'r' should be at least 0!" << std::endl << std::endl;
+
+		Constructor::PrintUsage();
+		return false;
+	}
+
+	this->m_Settings.KeyRefreshInterval = keyRefreshInterval;
+
 	// All OK, show settings
 	this->m_Settings.Print();
 
@@ -151,7 +467,7 @@ void Constructor::Run(int argc, char** argv)
 	}
 
 	// Create reconstructor
-	Reconstructor reconstructor(this->m_Cameras);
+	Reconstructor reconstructor(this->m_Settings, this->m_Cameras);
 	if (reconstructor.Initialize())
 	{
 		Processor processor(this->m_Settings, reconstructor, this->m_Cameras);
@@ -17,7 +17,15 @@ public:
 
 	static void PrintUsage(void);
 
+	// Parse first[:last[:stride]], the last frame may be left out as in first::stride. Returns false on malformed input
+	static bool ParseFrameRange(const char *text, int &first, int &last, int &stride);
+
 	bool ParseArguments(int argc, char **argv);
 
 	void Run(int argc, char **argv);
+
+	const Settings &GetSettings(void) const
+	{
+		return this->m_Settings;
+	}
 };
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "Stdafx.h"
+
+#include "DeadlineController.h"
+
+// Fraction of the budget we aim for, leaves room for jitter
+#define DEADLINE_HEADROOM 0.9f
+
+// Only refine when the prediction is well within budget, prevents toggling between two steps every frame
+#define DEADLINE_REFINE_HEADROOM 0.75f
+
+DeadlineController::DeadlineController(const float target, const int minStep, const int maxStep) : m_Target(target), m_MinStep(minStep), m_MaxStep(maxStep < minStep ? minStep : maxStep)
+{
+	for (int s = 0 ; s < NUM_STAGES ; ++s)
+	{
+		this->m_StageTimes[s] = 0;
+	}
+
+	this->m_FrameTime = 0;
+	this->m_CarveCost = 0;
+
+	// Start coarse, the first frame tells us how fast we actually are
+	this->m_Step = this->m_MaxStep;
+
+	this->m_NumFrames = 0;
+	this->m_NumMissed = 0;
+}
+
+DeadlineController::~DeadlineController(void)
+{
+}
+
+void DeadlineController::BeginFrame(void)
+{
+	this->m_Start = this->m_StageStart = std::chrono::high_resolution_clock::now();
+}
+
+void DeadlineController::EndStage(const Stage stage)
+{
+	std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<float, std::milli> diff = now - this->m_StageStart;
+
+	this->m_StageTimes[stage] = diff.count();
+	this->m_StageStart = now;
+}
+
+bool DeadlineController::EndFrame(const double carvedVoxels)
+{
+	std::chrono::duration<float, std::milli> diff = std::chrono::high_resolution_clock::now() - this->m_Start;
+	this->m_FrameTime = diff.count();
+
+	if (carvedVoxels > 0)
+	{
+		this->m_CarveCost = this->m_StageTimes[STAGE_CARVE] / carvedVoxels;
+	}
+
+	++this->m_NumFrames;
+
+	const bool met = this->m_FrameTime <= this->m_Target;
+	if (!met)
+	{
+		++this->m_NumMissed;
+	}
+
+	return met;
+}
+
+int DeadlineController::NextStep(const double regionVoxels)
+{
+	const float input = this->m_StageTimes[STAGE_INPUT];
+	const float output = this->m_StageTimes[STAGE_OUTPUT];
+
+	int step = this->m_MaxStep;
+	for (int s = this->m_MinStep ; s <= this->m_MaxStep ; ++s)
+	{
+		// Carving scales with the number of voxels in the region, the output with the surface of the hull
+		const double carve = this->m_CarveCost * regionVoxels / (double(s) * s * s);
+		const double scale = double(this->m_Step) / s;
+		const double predicted = input + carve + output * scale * scale;
+
+		const float headroom = s < this->m_Step ? DEADLINE_REFINE_HEADROOM : DEADLINE_HEADROOM;
+		if (predicted <= this->m_Target * headroom)
+		{
+			step = s;
+			break;
+		}
+	}
+
+	this->m_Step = step;
+
+	return step;
+}
+
+bool DeadlineController::NextRegion(const int hullMin[3], const int hullMax[3], const int region[6], const int step, int min[3], int max[3])
+{
+	for (int a = 0 ; a < 3 ; ++a)
+	{
+		if (hullMin[a] <= region[a * 2] || hullMax[a] + step >= region[a * 2 + 1])
+		{
+			return false;
+		}
+
+		min[a] = hullMin[a] - DEADLINE_REGION_MARGIN * step;
+		max[a] = hullMax[a] + DEADLINE_REGION_MARGIN * step;
+	}
+
+	return true;
+}
\ No newline at end of file
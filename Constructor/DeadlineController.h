@@ -0,0 +1,67 @@
+#pragma once
+
+// Maximum carving step the controller will fall back to
+#define DEADLINE_MAX_STEP 16
+
+// Margin (in carving steps) added around the hull of the previous frame when restricting the carved region
+#define DEADLINE_REGION_MARGIN 4
+
+class DeadlineController
+{
+public:
+	enum Stage
+	{
+		STAGE_INPUT = 0,	// Decoding and keying
+		STAGE_CARVE,		// Carving the voxel space
+		STAGE_OUTPUT,		// Octree building and compression
+		NUM_STAGES
+	};
+private:
+	// Target latency per frame in milliseconds
+	const float m_Target;
+
+	const int m_MinStep, m_MaxStep;
+
+	std::chrono::high_resolution_clock::time_point m_Start, m_StageStart;
+
+	float m_StageTimes[NUM_STAGES];
+
+	float m_FrameTime;
+
+	// Carving cost in milliseconds per carved voxel of the last frame
+	double m_CarveCost;
+
+	int m_Step;
+
+	unsigned long long int m_NumFrames, m_NumMissed;
+public:
+	DeadlineController(const float target, const int minStep, const int maxStep = DEADLINE_MAX_STEP);
+	~DeadlineController(void);
+
+	void BeginFrame(void);
+
+	// Stages are expected to be ended in order, the time of a stage is the time since the previous stage ended
+	void EndStage(const Stage stage);
+
+	// Returns true if the frame made the deadline
+	bool EndFrame(const double carvedVoxels);
+
+	// Pick the finest step for which the predicted frame time fits the budget, regionVoxels is the number of voxels the
+	// region to be carved holds at step 1
+	int NextStep(const double regionVoxels);
+
+	// Region to carve next around the hull of this frame, DEADLINE_REGION_MARGIN steps wider. Returns false if the hull
+	// touches the border of the carved region, it may have been cut off and the full voxel space should be carved
+	static bool NextRegion(const int hullMin[3], const int hullMax[3], const int region[6], const int step, int min[3], int max[3]);
+
+	float GetTarget(void) const { return this->m_Target; }
+
+	float GetFrameTime(void) const { return this->m_FrameTime; }
+
+	float GetStageTime(const Stage stage) const { return this->m_StageTimes[stage]; }
+
+	int GetStep(void) const { return this->m_Step; }
+
+	unsigned long long int GetNumFrames(void) const { return this->m_NumFrames; }
+	unsigned long long int GetNumMissed(void) const { return this->m_NumMissed; }
+};
\ No newline at end of file
@@ -4,45 +4,204 @@
 #include "DistanceKeyer.h"
 
 #include "compute_matte.cuh"
+#include "compute_matte_host.h"
+#include "silhouette.cuh"
+#include "key_table.cuh"
+#include "yuv.cuh"
 
 DistanceKeyer::DistanceKeyer()
 {
 	this->m_HasKeyColor = false;
+
+	this->m_RefreshInterval = 0;
+	this->m_FramesSinceKey = 0;
+
+	this->m_UseTable = false;
+	this->m_TableTreshold = this->m_TableTolerance = -1;
+	this->m_TableNumKeyColors = 0;
 }
 
 DistanceKeyer::~DistanceKeyer()
 {
 }
 
-void DistanceKeyer::FindKeyColor(const cv::cuda::GpuMat &in)
+void DistanceKeyer::NextFrame(void)
 {
-	cv::Mat frame;
-	in.download(frame);
+	if (this->m_RefreshInterval > 0 && this->m_HasKeyColor && ++this->m_FramesSinceKey >= this->m_RefreshInterval)
+	{
+		this->m_HasKeyColor = false;
+	}
+}
+
+static inline int KeyHistogramBin(const cv::Vec3b &pixel)
+{
+	const int shift = 8 - KEY_HISTOGRAM_BITS;
+
+	return ((pixel[0] >> shift) << (KEY_HISTOGRAM_BITS * 2)) | ((pixel[1] >> shift) << KEY_HISTOGRAM_BITS) | (pixel[2] >> shift);
+}
 
-	int size = frame.rows * frame.cols;
-	int r = 0, g = 0, b = 0;
+void DistanceKeyer::SampleFrame(const cv::cuda::GpuMat &in, const cv::Rect &roi, cv::Mat &samples)
+{
+	assert(in.type() == CV_8UC3);
 
+	// Only download every n-th row, a header with a larger step skips the rows in between
+	cv::Mat frame;
+	cv::cuda::GpuMat region = in(roi);
+	cv::cuda::GpuMat rows(region.rows / KEY_SUBSAMPLE, region.cols, region.type(), region.data, region.step * KEY_SUBSAMPLE);
+	rows.download(frame);
+
+	samples.create(frame.rows, (frame.cols + KEY_SUBSAMPLE - 1) / KEY_SUBSAMPLE, CV_8UC3);
 	for (int i = 0; i < frame.rows; ++i)
 	{
 		const cv::Vec3b* pixel = frame.ptr<cv::Vec3b>(i);
+		cv::Vec3b* sample = samples.ptr<cv::Vec3b>(i);
+
+		for (int j = 0; j < samples.cols; ++j)
+		{
+			sample[j] = pixel[j * KEY_SUBSAMPLE];
+		}
+	}
+}
+
+void DistanceKeyer::SampleYuvFrame(const cv::cuda::GpuMat &in, const cv::Rect &roi, cv::Mat &samples)
+{
+	assert(in.type() == CV_8UC1);
+
+	// Only the sampled pixels are converted
+	cv::cuda::GpuMat gpuSamples(roi.height / KEY_SUBSAMPLE, (roi.width + KEY_SUBSAMPLE - 1) / KEY_SUBSAMPLE, CV_8UC3);
+	if (!gpuSamples.empty())
+	{
+		convert_yuv_samples(in, roi.x, roi.y, KEY_SUBSAMPLE, gpuSamples);
+	}
+
+	gpuSamples.download(samples);
+}
+
+void DistanceKeyer::FindKeyColor(const cv::Mat &samples)
+{
+	assert(samples.type() == CV_8UC3);
 
-		for (int j = 0; j < frame.cols; ++j)
+	std::vector<int> histogram(KEY_HISTOGRAM_BINS, 0);
+
+	#pragma omp parallel
+	{
+		std::vector<int> local(KEY_HISTOGRAM_BINS, 0);
+
+		#pragma omp for
+		for (int i = 0; i < samples.rows; ++i)
+		{
+			const cv::Vec3b* pixel = samples.ptr<cv::Vec3b>(i);
+
+			for (int j = 0; j < samples.cols; ++j)
+			{
+				++local[KeyHistogramBin(pixel[j])];
+			}
+		}
+
+		#pragma omp critical(key_histogram)
 		{
-			r = r + pixel[j][0];
-			g = g + pixel[j][1];
-			b = b + pixel[j][2];
+			for (int h = 0; h < KEY_HISTOGRAM_BINS; ++h)
+			{
+				histogram[h] += local[h];
+			}
 		}
 	}
 
-	r /= size;
-	g /= size;
-	b /= size;
+	const int mode = (int)(std::max_element(histogram.begin(), histogram.end()) - histogram.begin());
+	if (histogram[mode] == 0)
+	{
+		return;
+	}
+
+	// Average of the pixels in the dominant bin, a bin is too coarse to be used as the key color directly
+	long long r = 0, g = 0, b = 0;
+
+	#pragma omp parallel for reduction(+:r, g, b)
+	for (int i = 0; i < samples.rows; ++i)
+	{
+		const cv::Vec3b* pixel = samples.ptr<cv::Vec3b>(i);
+
+		for (int j = 0; j < samples.cols; ++j)
+		{
+			if (KeyHistogramBin(pixel[j]) == mode)
+			{
+				r += pixel[j][0];
+				g += pixel[j][1];
+				b += pixel[j][2];
+			}
+		}
+	}
+
+	r /= histogram[mode];
+	g /= histogram[mode];
+	b /= histogram[mode];
 
 	this->m_KeyColor = cv::Vec3f(r, g, b);
 
-	std::cout << "Key color: (" << r << ", " << g << ", " << b << ")" << std::endl;
+	std::cout << "Key color: (" << r << ", " << g << ", " << b << "), " << (100 * histogram[mode]) / (samples.rows * samples.cols) << "% of the sampled pixels" << std::endl;
 
 	this->m_HasKeyColor = true;
+	this->m_FramesSinceKey = 0;
+}
+
+int DistanceKeyer::FindTreshold(const cv::Mat &samples)
+{
+	assert(samples.type() == CV_8UC3);
+
+	cv::Mat distance;
+	compute_key_distance_host(cv::Vec3i(this->m_KeyColor[0], this->m_KeyColor[1], this->m_KeyColor[2]), samples, distance);
+
+	long long histogram[256] = { 0 };
+	long long n = 0;
+	for (int i = 0; i < distance.rows; ++i)
+	{
+		const uchar *d = distance.ptr<uchar>(i);
+
+		for (int j = 0; j < distance.cols; ++j)
+		{
+			++histogram[d[j]];
+			++n;
+		}
+	}
+
+	if (n == 0)
+	{
+		return this->m_Treshold;
+	}
+
+	// Otsu, the treshold separating the key from the rest with the largest between class variance
+	double sum = 0;
+	for (int t = 0; t < 256; ++t)
+	{
+		sum += double(t) * histogram[t];
+	}
+
+	double sumBackground = 0, bestVariance = -1;
+	long long background = 0;
+	int treshold = this->m_Treshold;
+	for (int t = 0; t < 255; ++t)
+	{
+		background += histogram[t];
+		sumBackground += double(t) * histogram[t];
+
+		const long long foreground = n - background;
+		if (background == 0 || foreground == 0)
+		{
+			continue;
+		}
+
+		const double meanBackground = sumBackground / background;
+		const double meanForeground = (sum - sumBackground) / foreground;
+		const double variance = double(background) * double(foreground) * (meanBackground - meanForeground) * (meanBackground - meanForeground);
+
+		if (variance > bestVariance)
+		{
+			bestVariance = variance;
+			treshold = t;
+		}
+	}
+
+	return treshold;
 }
 
 void DistanceKeyer::ComputeMatte(const cv::cuda::GpuMat &in, cv::cuda::GpuMat &out)
@@ -52,10 +211,72 @@ void DistanceKeyer::ComputeMatte(const cv::cuda::GpuMat &in, cv::cuda::GpuMat &o
 	color.y = this->m_KeyColor[1];
 	color.z = this->m_KeyColor[2];
 
-	/*cv::Ptr<cv::cuda::Filter> filter = cv::cuda::createGaussianFilter(in.type(), in.type(), cv::Size(21, 21), 0);
-	filter->apply(in, in);*/
-
 	out.create(in.size(), CV_8UC1);
 
 	compute_matte(color, this->m_Treshold, this->m_Tolerance, in, out);
+}
+
+const cv::cuda::GpuMat &DistanceKeyer::GetTable(void)
+{
+	const size_t numKeyColors = this->GetNumKeyColors();
+	if (!this->m_Table.empty() && this->m_TableKeyColor == this->m_KeyColor && this->m_TableTreshold == this->m_Treshold && this->m_TableTolerance == this->m_Tolerance && this->m_TableNumKeyColors == numKeyColors)
+	{
+		return this->m_Table;
+	}
+
+	std::vector<uint3> colors;
+	colors.push_back(make_uint3(this->m_KeyColor[0], this->m_KeyColor[1], this->m_KeyColor[2]));
+
+	std::vector<cv::Vec3f>::const_iterator it;
+	for (it = this->m_ExtraKeyColors.begin() ; it != this->m_ExtraKeyColors.end() ; ++it)
+	{
+		colors.push_back(make_uint3((*it)[0], (*it)[1], (*it)[2]));
+	}
+
+	this->m_Table.create(1, KEY_TABLE_WORDS, CV_32SC1);
+	build_key_table(&colors[0], (unsigned int)colors.size(), this->m_Treshold, this->m_Tolerance, (uint*)this->m_Table.data);
+
+	this->m_TableKeyColor = this->m_KeyColor;
+	this->m_TableTreshold = this->m_Treshold;
+	this->m_TableTolerance = this->m_Tolerance;
+	this->m_TableNumKeyColors = numKeyColors;
+
+	return this->m_Table;
+}
+
+void DistanceKeyer::ComputeSilhouette(const cv::cuda::GpuMat &in, cv::cuda::GpuMat &out, const cv::cuda::GpuMat &mask, const cv::Rect &roi)
+{
+	uint3 color;
+	color.x = this->m_KeyColor[0];
+	color.y = this->m_KeyColor[1];
+	color.z = this->m_KeyColor[2];
+
+	out.create(in.rows, silhouette_words(in.cols), CV_32SC1);
+
+	if (this->m_UseTable)
+	{
+		compute_silhouette_table((const uint*)this->GetTable().data, in, mask, roi, out);
+	}
+	else
+	{
+		compute_silhouette(color, this->m_Treshold, this->m_Tolerance, in, mask, roi, out);
+	}
+}
+
+void DistanceKeyer::ComputeSilhouetteYuv(const cv::cuda::GpuMat &in, cv::cuda::GpuMat &out, const cv::cuda::GpuMat &mask, const cv::Rect &roi)
+{
+	assert(!this->m_UseTable);
+
+	const uint2 chroma = key_color_chroma(make_uint3(this->m_KeyColor[0], this->m_KeyColor[1], this->m_KeyColor[2]));
+
+	out.create(in.rows * 2 / 3, silhouette_words(in.cols), CV_32SC1);
+
+	compute_silhouette_yuv(chroma, this->m_Treshold, this->m_Tolerance, in, mask, roi, out);
+}
+
+void DistanceKeyer::ComputeMatte(const cv::Mat &in, cv::Mat &out)
+{
+	const cv::Vec3i color(this->m_KeyColor[0], this->m_KeyColor[1], this->m_KeyColor[2]);
+
+	compute_matte_host(color, this->m_Treshold, this->m_Tolerance, in, out);
 }
\ No newline at end of file
@@ -1,5 +1,12 @@
 #pragma once
 
+// Key color estimation bins colors with this many bits per channel
+#define KEY_HISTOGRAM_BITS 5
+#define KEY_HISTOGRAM_BINS (1 << (KEY_HISTOGRAM_BITS * 3))
+
+// Only every n-th row and column is considered when estimating the key color
+#define KEY_SUBSAMPLE 4
+
 class DistanceKeyer
 {
 private:
@@ -10,6 +17,20 @@ private:
 	int m_GarbageTreshold;
 
 	bool m_HasKeyColor;
+
+	// Re-estimate the key color every this many frames, 0 keeps the first estimate
+	int m_RefreshInterval;
+	int m_FramesSinceKey;
+
+	// Fixed key colors keyed out next to the estimated one, for instance the floor and the backdrop
+	std::vector<cv::Vec3f> m_ExtraKeyColors;
+
+	// Baked keyer decision per color, rebuilt when the parameters it was built with change
+	bool m_UseTable;
+	cv::cuda::GpuMat m_Table;
+	cv::Vec3f m_TableKeyColor;
+	int m_TableTreshold, m_TableTolerance;
+	size_t m_TableNumKeyColors;
 public:
 	DistanceKeyer();
 	~DistanceKeyer();
@@ -23,6 +44,11 @@ public:
 
 	bool HasKeyColor(void) { return this->m_HasKeyColor; }
 
+	void SetRefreshInterval(const int refreshInterval) { this->m_RefreshInterval = refreshInterval; }
+
+	// Called once per frame, drops the key color when it's due for a refresh
+	void NextFrame(void);
+
 	const int GetR(void) { return this->m_KeyColor[0]; }
 	const int GetG(void) { return this->m_KeyColor[1]; }
 	const int GetB(void) { return this->m_KeyColor[2]; }
@@ -35,7 +61,44 @@ public:
 
 	cv::Vec3f GetKeyColor() { return this->m_KeyColor; }
 
-	void FindKeyColor(const cv::cuda::GpuMat &in);
+	void AddKeyColor(const cv::Vec3f &color) { this->m_ExtraKeyColors.push_back(color); }
+
+	size_t GetNumKeyColors(void) const { return this->m_ExtraKeyColors.size() + 1; }
+
+	const std::vector<cv::Vec3f> &GetExtraKeyColors(void) const { return this->m_ExtraKeyColors; }
+
+	int GetRefreshInterval(void) const { return this->m_RefreshInterval; }
+
+	// Key through a table of all 8 bit colors in stead of computing distances, required for more than one key color
+	void SetUseTable(const bool useTable) { this->m_UseTable = useTable; }
+	bool IsUsingTable(void) const { return this->m_UseTable; }
+
+	// Packed table (see key_table.cuh), built for the current parameters
+	const cv::cuda::GpuMat &GetTable(void);
+
+	// Every n-th pixel of every n-th row of the region of interest, what the key color and treshold are estimated from
+	static void SampleFrame(const cv::cuda::GpuMat &in, const cv::Rect &roi, cv::Mat &samples);
+
+	// Same for an I420 frame (see yuv.cuh), only the sampled pixels are converted to BGR
+	static void SampleYuvFrame(const cv::cuda::GpuMat &in, const cv::Rect &roi, cv::Mat &samples);
+
+	// The key color is the dominant color of the sampled pixels, the mode of a color histogram
+	void FindKeyColor(const cv::Mat &samples);
+
+	// Treshold on the key distance that best separates the key from the rest of the sampled pixels (Otsu), pixels at or
+	// below it are background. Needs the key color, the current treshold is returned if there are no samples
+	int FindTreshold(const cv::Mat &samples);
 
 	void ComputeMatte(const cv::cuda::GpuMat &in, cv::cuda::GpuMat &out);
+
+	// Keys straight into a packed 1 bit per pixel silhouette, the 8 bit matte is never written. Only the region of interest
+	// is keyed and pixels cleared in the (packed) mask are skipped
+	void ComputeSilhouette(const cv::cuda::GpuMat &in, cv::cuda::GpuMat &out, const cv::cuda::GpuMat &mask, const cv::Rect &roi);
+
+	// Same, keying an I420 frame on chroma distance only, at chroma resolution. The distance is taken on the scale of the
+	// BGR keyer, the treshold and tolerance are shared. Doesn't support the key table
+	void ComputeSilhouetteYuv(const cv::cuda::GpuMat &in, cv::cuda::GpuMat &out, const cv::cuda::GpuMat &mask, const cv::Rect &roi);
+
+	// Host version, vectorized and multithreaded, produces the same matte as the kernel
+	void ComputeMatte(const cv::Mat &in, cv::Mat &out);
 };
\ No newline at end of file
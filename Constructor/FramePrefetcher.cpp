@@ -0,0 +1,237 @@
+#include "Stdafx.h"
+
+#include "FramePrefetcher.h"
+#include "Exception.h"
+
+FramePrefetcher::FramePrefetcher(FrameSource *source, FrameSource *matteSource, StagingPool *framePool, StagingPool *mattePool, const size_t depth) :
+	m_Source(source), m_MatteSource(matteSource), m_FramePool(framePool), m_MattePool(mattePool)
+{
+	if (depth == 0)
+	{
+		throw_line("Prefetching needs room for at least one frame");
+	}
+
+	this->m_Ring.resize(depth);
+	this->m_Head = this->m_Count = 0;
+
+	this->m_NextFrame = this->m_Source->GetPosition();
+	this->m_SeekFrame = -1;
+	this->m_Generation = 0;
+
+	this->m_EndOfVideo = false;
+	this->m_Stop = false;
+
+	this->m_Thread = std::thread(&FramePrefetcher::Run, this);
+}
+
+FramePrefetcher::~FramePrefetcher(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->m_Mutex);
+		this->m_Stop = true;
+	}
+
+	this->m_NotFull.notify_all();
+	this->m_Thread.join();
+
+	for ( ; this->m_Count > 0 ; --this->m_Count)
+	{
+		this->Release(this->m_Ring[this->m_Head]);
+		this->m_Head = (this->m_Head + 1) % this->m_Ring.size();
+	}
+}
+
+bool FramePrefetcher::ReadFrame(FrameSource *source, StagingPool *pool, cv::Mat &frame, int &staging)
+{
+	// Decoders write into the buffer when it has the right shape already, other sources are copied in
+	staging = pool->Acquire(frame);
+	if (!source->Read(frame))
+	{
+		pool->Release(staging);
+		staging = -1;
+		frame.release();
+
+		return false;
+	}
+
+	frame = pool->Stage(staging, frame);
+
+	return true;
+}
+
+bool FramePrefetcher::ReadMatte(FrameSource *source, StagingPool *pool, cv::Mat &matte, int &staging)
+{
+	cv::Mat decoded;
+	if (!source->Read(decoded))
+	{
+		staging = -1;
+		matte.release();
+
+		return false;
+	}
+
+	// Converted straight into the buffer
+	staging = pool->Acquire(matte);
+	if (decoded.channels() == 3)
+	{
+		cv::cvtColor(decoded, matte, CV_BGR2GRAY);
+	}
+	else
+	{
+		matte = decoded;
+	}
+
+	matte = pool->Stage(staging, matte);
+
+	return true;
+}
+
+void FramePrefetcher::Release(PrefetchedFrame &frame)
+{
+	if (frame.FrameStaging >= 0)
+	{
+		this->m_FramePool->Release(frame.FrameStaging);
+	}
+
+	if (frame.MatteStaging >= 0)
+	{
+		this->m_MattePool->Release(frame.MatteStaging);
+	}
+
+	frame.FrameStaging = frame.MatteStaging = -1;
+	frame.Frame.release();
+	frame.Matte.release();
+}
+
+void FramePrefetcher::Run(void)
+{
+	std::unique_lock<std::mutex> lock(this->m_Mutex);
+
+	while (!this->m_Stop)
+	{
+		if (this->m_Count == this->m_Ring.size() || (this->m_EndOfVideo && this->m_SeekFrame < 0))
+		{
+			this->m_NotFull.wait(lock);
+			continue;
+		}
+
+		// Seeks are applied here, only this thread touches the sources
+		const bool seek = this->m_SeekFrame >= 0;
+		if (seek)
+		{
+			this->m_NextFrame = this->m_SeekFrame;
+			this->m_SeekFrame = -1;
+			this->m_EndOfVideo = false;
+		}
+
+		const int number = this->m_NextFrame;
+		const unsigned int generation = this->m_Generation;
+
+		// Decode without holding the lock, the consumer keeps popping meanwhile
+		lock.unlock();
+
+		if (seek)
+		{
+			this->m_Source->Seek(number);
+		}
+
+		PrefetchedFrame decoded;
+		decoded.Number = number;
+		decoded.MatteStaging = -1;
+		FramePrefetcher::ReadFrame(this->m_Source, this->m_FramePool, decoded.Frame, decoded.FrameStaging);
+		decoded.Timestamp = this->m_Source->GetTimestamp();
+
+		if (this->m_MatteSource != 0 && !decoded.Frame.empty())
+		{
+			// The matte source may have been left behind by a seek
+			this->m_MatteSource->Seek(number);
+			FramePrefetcher::ReadMatte(this->m_MatteSource, this->m_MattePool, decoded.Matte, decoded.MatteStaging);
+		}
+
+		lock.lock();
+
+		// Seeked while decoding, this frame isn't wanted anymore
+		if (generation != this->m_Generation)
+		{
+			this->Release(decoded);
+			continue;
+		}
+
+		if (decoded.Frame.empty() || (this->m_MatteSource != 0 && decoded.Matte.empty()))
+		{
+			this->Release(decoded);
+			this->m_EndOfVideo = true;
+		}
+		else
+		{
+			this->m_Ring[(this->m_Head + this->m_Count) % this->m_Ring.size()] = decoded;
+			++this->m_Count;
+			++this->m_NextFrame;
+		}
+
+		this->m_NotEmpty.notify_all();
+	}
+}
+
+void FramePrefetcher::Seek(const int frame)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->m_Mutex);
+
+		// Nothing to do if the frame is up next
+		const int next = this->m_Count > 0 ? this->m_Ring[this->m_Head].Number : this->m_NextFrame;
+		if (this->m_SeekFrame < 0 && next == frame && !this->m_EndOfVideo)
+		{
+			return;
+		}
+
+		for ( ; this->m_Count > 0 ; --this->m_Count)
+		{
+			this->Release(this->m_Ring[this->m_Head]);
+			this->m_Head = (this->m_Head + 1) % this->m_Ring.size();
+		}
+
+		this->m_Head = 0;
+		this->m_SeekFrame = frame;
+		this->m_EndOfVideo = false;
+		++this->m_Generation;
+	}
+
+	this->m_NotFull.notify_all();
+}
+
+bool FramePrefetcher::Pop(PrefetchedFrame &frame)
+{
+	{
+		std::unique_lock<std::mutex> lock(this->m_Mutex);
+
+		while (this->m_Count == 0 && (!this->m_EndOfVideo || this->m_SeekFrame >= 0))
+		{
+			this->m_NotEmpty.wait(lock);
+		}
+
+		if (this->m_Count == 0)
+		{
+			return false;
+		}
+
+		// Hand over the buffers, the slot is written anew by the decode thread
+		PrefetchedFrame &slot = this->m_Ring[this->m_Head];
+		frame.Number = slot.Number;
+		frame.Timestamp = slot.Timestamp;
+		frame.Frame = slot.Frame;
+		frame.Matte = slot.Matte;
+		frame.FrameStaging = slot.FrameStaging;
+		frame.MatteStaging = slot.MatteStaging;
+		slot.Frame.release();
+		slot.Matte.release();
+		slot.FrameStaging = slot.MatteStaging = -1;
+
+		this->m_Head = (this->m_Head + 1) % this->m_Ring.size();
+		--this->m_Count;
+	}
+
+	this->m_NotFull.notify_all();
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "FrameSource.h"
+#include "StagingPool.h"
+
+// Most frames decoded ahead per camera, every frame takes a page-locked staging buffer of its own
+#define PREFETCH_MAX_DEPTH 64
+
+typedef struct PrefetchedFrame
+{
+	// Frame number in the camera video
+	int Number;
+
+	// Capture time in seconds as reported by the source, negative if it has no timing
+	double Timestamp;
+
+	// Decoded frame and, when a matte video is prefetched, its matte as greyscale
+	cv::Mat Frame;
+	cv::Mat Matte;
+
+	// Staging buffers holding the frame and matte, the consumer releases them (-1 if none)
+	int FrameStaging;
+	int MatteStaging;
+} PrefetchedFrame;
+
+// Decodes the frames of a single camera, and optionally its mattes, on a thread of its own. Decoded frames are kept in a
+// ring buffer of a fixed number of frames, the thread runs ahead of the consumer until the buffer is full. The sources
+// belong to the decode thread once the prefetcher is constructed. Frames are decoded straight into staging buffers, the
+// pools should have two buffers more than the ring holds frames
+class FramePrefetcher
+{
+private:
+	FrameSource *m_Source;
+
+	// Mattes are only prefetched when set
+	FrameSource *m_MatteSource;
+
+	StagingPool *m_FramePool;
+	StagingPool *m_MattePool;
+
+	// Ring buffer of decoded frames, m_Count frames starting at m_Head
+	std::vector<PrefetchedFrame> m_Ring;
+	size_t m_Head, m_Count;
+
+	// Frame the decode thread reads next, and the frame it should seek to first (-1 if none)
+	int m_NextFrame;
+	int m_SeekFrame;
+
+	// Bumped on every seek, frames decoded before the seek are dropped
+	unsigned int m_Generation;
+
+	bool m_EndOfVideo;
+	bool m_Stop;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_NotFull, m_NotEmpty;
+	std::thread m_Thread;
+
+	void Run(void);
+
+	void Release(PrefetchedFrame &frame);
+public:
+	FramePrefetcher(FrameSource *source, FrameSource *matteSource, StagingPool *framePool, StagingPool *mattePool, const size_t depth);
+	~FramePrefetcher(void);
+
+	// Drops the buffered frames and continues decoding at the given frame, unless that frame is next anyway
+	void Seek(const int frame);
+
+	// Blocks until the next frame is decoded, returns false at the end of the video
+	bool Pop(PrefetchedFrame &frame);
+
+	size_t GetDepth(void) const { return this->m_Ring.size(); }
+
+	// Read the next frame into a staging buffer, also used when decoding on demand. Returns false at the end of the video,
+	// the buffer is released then
+	static bool ReadFrame(FrameSource *source, StagingPool *pool, cv::Mat &frame, int &staging);
+
+	// Same for mattes, which are converted to greyscale
+	static bool ReadMatte(FrameSource *source, StagingPool *pool, cv::Mat &matte, int &staging);
+};
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "Stdafx.h"
+
+#include "FrameSource.h"
+#include "VideoFrameSource.h"
+#include "ImageSequenceFrameSource.h"
+#include "RawFrameSource.h"
+
+FrameSource *FrameSource::Open(const std::string &cameraPath, const std::string &videoFile, const bool yuv)
+{
+	const std::string stem = cameraPath + boost::filesystem::path(videoFile).stem().string();
+
+	if (boost::filesystem::is_regular_file(stem + ".raw"))
+	{
+		return new RawFrameSource(stem + ".raw");
+	}
+
+	if (boost::filesystem::is_directory(stem))
+	{
+		return new ImageSequenceFrameSource(stem);
+	}
+
+	if (boost::filesystem::is_regular_file(cameraPath + videoFile))
+	{
+		return new VideoFrameSource(cameraPath + videoFile, yuv);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+// Layout of the frames a source hands out
+enum FrameFormat
+{
+	// 8 bit BGR, greyscale for matte images. Video may hand out I420 (see yuv.cuh) when its native planes were asked for
+	FRAME_FORMAT_BGR = 0,
+
+	// Single channel Bayer mosaic, named after the colours of the top left 2x2 block in row order
+	FRAME_FORMAT_BAYER_RGGB,
+	FRAME_FORMAT_BAYER_BGGR,
+	FRAME_FORMAT_BAYER_GRBG,
+	FRAME_FORMAT_BAYER_GBRG,
+
+	// 4:2:2 as U Y0 V Y1, two channels per pixel
+	FRAME_FORMAT_UYVY
+};
+
+// Sequence of frames of a single camera. Frames are read one after the other, seeking moves the frame that is read next.
+// A source is used by one thread at a time
+class FrameSource
+{
+public:
+	virtual ~FrameSource(void)
+	{
+	}
+
+	virtual const cv::Size &GetSize(void) const = 0;
+
+	virtual long GetNumFrames(void) const = 0;
+
+	virtual FrameFormat GetFormat(void) const = 0;
+
+	// Frames per second, 0 if the source has no timing
+	virtual double GetFrameRate(void) const = 0;
+
+	// Frame that is read next
+	virtual int GetPosition(void) const = 0;
+
+	virtual void Seek(const int frame) = 0;
+
+	// Read the next frame, returns false past the end. The frame may share memory with the source, it's never to be written
+	virtual bool Read(cv::Mat &frame) = 0;
+
+	// Capture time in seconds of the frame that was read last, negative if the source has no timing
+	virtual double GetTimestamp(void) const = 0;
+
+	// Open the frames stored under the name of a video file in the camera path: a raw frame file (stem + ".raw") if there
+	// is one, a directory of images (stem) next, the video itself otherwise. Returns 0 if none exists
+	static FrameSource *Open(const std::string &cameraPath, const std::string &videoFile, const bool yuv);
+};
\ No newline at end of file
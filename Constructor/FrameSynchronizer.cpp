@@ -0,0 +1,142 @@
+#include "Stdafx.h"
+
+#include "FrameSynchronizer.h"
+#include "Exception.h"
+
+FrameSynchronizer::FrameSynchronizer(const std::vector<Camera*> &cameras, const std::string &logFile) : m_Cameras(cameras)
+{
+	if (this->m_Cameras.empty())
+	{
+		throw_line("Synchronizing frames needs at least one camera");
+	}
+
+	// Timestamps are only comparable when every camera has them, the slowest camera sets the period
+	this->m_UseTimestamps = true;
+	this->m_Period = 0;
+	for (size_t c = 0 ; c < this->m_Cameras.size() ; ++c)
+	{
+		const double rate = this->m_Cameras[c]->GetFrameRate();
+		if (rate <= 0)
+		{
+			this->m_UseTimestamps = false;
+			break;
+		}
+
+		this->m_Period = 1.0 / rate > this->m_Period ? 1.0 / rate : this->m_Period;
+	}
+
+	if (!this->m_UseTimestamps)
+	{
+		this->m_Period = 1;
+
+		std::cout << "Not every camera has timestamps, frames are matched on frame numbers" << std::endl;
+	}
+	else
+	{
+		for (size_t c = 0 ; c < this->m_Cameras.size() ; ++c)
+		{
+			if (!this->m_Cameras[c]->HasSyncTimestamps())
+			{
+				std::cout << "Camera " << this->m_Cameras[c]->GetId() + 1 << " has no sync file, its frames are timed from the start of its video" << std::endl;
+			}
+		}
+	}
+
+	this->m_Log.open(logFile, cv::FileStorage::WRITE);
+	if (!this->m_Log.isOpened())
+	{
+		throw_line("Could not open frame log for writing: " + logFile);
+	}
+
+	this->m_Log << "Bundles" << "[";
+
+	this->m_NumBundles = 0;
+	this->m_NumSkipped = 0;
+}
+
+FrameSynchronizer::~FrameSynchronizer(void)
+{
+	this->m_Log << "]";
+	this->m_Log.release();
+}
+
+void FrameSynchronizer::LogBundle(const int frame)
+{
+	std::vector<int> frames;
+	std::vector<double> timestamps;
+	for (size_t c = 0 ; c < this->m_Cameras.size() ; ++c)
+	{
+		frames.push_back(this->m_Cameras[c]->GetFrameNumber());
+		timestamps.push_back(this->m_Cameras[c]->GetTimestamp());
+	}
+
+	this->m_Log << "{" << "Frame" << frame << "CameraFrames" << frames << "Timestamps" << timestamps << "}";
+}
+
+bool FrameSynchronizer::Align(void)
+{
+	for (;;)
+	{
+		double latest = this->GetTime(this->m_Cameras.front());
+		for (size_t c = 1 ; c < this->m_Cameras.size() ; ++c)
+		{
+			const double time = this->GetTime(this->m_Cameras[c]);
+			latest = time > latest ? time : latest;
+		}
+
+		bool aligned = true;
+		for (size_t c = 0 ; c < this->m_Cameras.size() ; ++c)
+		{
+			Camera *camera = this->m_Cameras[c];
+			if (this->GetTime(camera) >= latest - this->m_Period * 0.5)
+			{
+				continue;
+			}
+
+			std::cout << "Frame " << camera->GetFrameNumber() << " of camera " << camera->GetId() + 1 << " has no match in the other cameras, skipped" << std::endl;
+
+			if (!camera->NextVideoFrame())
+			{
+				return false;
+			}
+
+			++this->m_NumSkipped;
+			aligned = false;
+		}
+
+		if (aligned)
+		{
+			return true;
+		}
+	}
+}
+
+bool FrameSynchronizer::Next(const int skip)
+{
+	for (size_t c = 0 ; c < this->m_Cameras.size() ; ++c)
+	{
+		if (!this->m_Cameras[c]->SkipVideoFrames(skip) || !this->m_Cameras[c]->NextVideoFrame())
+		{
+			return false;
+		}
+	}
+
+	if (!this->Align())
+	{
+		return false;
+	}
+
+	++this->m_NumBundles;
+
+	return true;
+}
+
+bool FrameSynchronizer::Seek(const int frame)
+{
+	for (size_t c = 0 ; c < this->m_Cameras.size() ; ++c)
+	{
+		this->m_Cameras[c]->SetVideoFrame(frame);
+	}
+
+	return this->Next(0);
+}
\ No newline at end of file
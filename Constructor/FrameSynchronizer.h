@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Camera.h"
+
+// Hands out bundles of frames, one per camera, that were captured at the same instant. Frames are matched on their
+// capture time, from the sync file of the camera or from the source, or on their frame numbers when a camera has no
+// timing. A camera that is more than half a frame period behind the others has a frame the others dropped, its frames
+// are skipped until all cameras agree again. Cameras keep decoding ahead independently, only the bundle waits for all.
+// Only sync files give the true capture times, times of the source count from the first frame of each video and so
+// assume the videos started together. The frame of every camera in every bundle is written to a log, frame numbers of
+// the cameras drift apart from the bundle numbers once frames are skipped
+class FrameSynchronizer
+{
+private:
+	const std::vector<Camera*> &m_Cameras;
+
+	cv::FileStorage m_Log;
+
+	// Frames are matched on frame numbers if not on timestamps, the period is 1 then
+	bool m_UseTimestamps;
+	double m_Period;
+
+	long m_NumBundles;
+	long m_NumSkipped;
+
+	double GetTime(const Camera *camera) const
+	{
+		return this->m_UseTimestamps ? camera->GetTimestamp() : camera->GetFrameNumber();
+	}
+
+	// Skip frames until the current frames of all cameras match, returns false at the end of a video
+	bool Align(void);
+public:
+	FrameSynchronizer(const std::vector<Camera*> &cameras, const std::string &logFile);
+	~FrameSynchronizer(void);
+
+	// Write the frame numbers and capture times of the current bundle to the log, under the given frame number
+	void LogBundle(const int frame);
+
+	// Read the next bundle after skipping the given number of frames of every camera, returns false at the end of any of
+	// the videos
+	bool Next(const int skip);
+
+	// Read the bundle at or after the given frame number of every camera
+	bool Seek(const int frame);
+
+	long GetNumBundles(void) const
+	{
+		return this->m_NumBundles;
+	}
+
+	// Frames that had no match in the other cameras
+	long GetNumSkipped(void) const
+	{
+		return this->m_NumSkipped;
+	}
+};
\ No newline at end of file
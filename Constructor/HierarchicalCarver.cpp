@@ -0,0 +1,392 @@
+#include "Stdafx.h"
+
+#include "HierarchicalCarver.h"
+#include "Exception.h"
+
+#include "cuda_common.cuh"
+#include "silhouette.cuh"
+
+HierarchicalCarver::HierarchicalCarver(const std::vector<Camera*> &cameras, const float *r, const float *t, const float *a, const float *k, const int *roi, const float *volume, const cv::Size &frustumSize) :
+	m_Cameras(cameras), m_FrustumSize(frustumSize)
+{
+	const size_t n = this->m_Cameras.size();
+
+	this->m_R.assign(r, r + n * 9);
+	this->m_T.assign(t, t + n * 3);
+	this->m_A.assign(a, a + n * 9);
+	this->m_K.assign(k, k + n * 12);
+	this->m_Roi.assign(roi, roi + n * 4);
+
+	memcpy(this->m_Volume, volume, sizeof(float) * 12);
+
+	this->m_Silhouettes.resize(n);
+	this->m_Integrals.resize(n);
+	this->m_Frames.resize(n);
+
+	this->m_Step = 1;
+	for (int i = 0 ; i < 3 ; ++i)
+	{
+		this->m_Region[i * 2] = this->m_Region[i * 2 + 1] = 0;
+		this->m_NumVoxels[i] = 0;
+		this->m_HullMin[i] = this->m_HullMax[i] = 0;
+	}
+
+	this->m_HasHull = false;
+}
+
+HierarchicalCarver::~HierarchicalCarver(void)
+{
+}
+
+void HierarchicalCarver::Update(void)
+{
+	for (size_t c = 0 ; c < this->m_Cameras.size() ; ++c)
+	{
+		// Packed silhouettes are an eighth of the size of a matte to download
+		this->m_Cameras[c]->GetSilhouette().download(this->m_Silhouettes[c]);
+		this->m_Cameras[c]->GetFrame().download(this->m_Frames[c]);
+
+		// Summed area table straight from the bits
+		const cv::Mat &silhouette = this->m_Silhouettes[c];
+		cv::Mat &integral = this->m_Integrals[c];
+		integral.create(this->m_FrustumSize.height + 1, this->m_FrustumSize.width + 1, CV_32S);
+		integral.row(0).setTo(cv::Scalar::all(0));
+
+		for (int y = 0 ; y < this->m_FrustumSize.height ; ++y)
+		{
+			const unsigned int *bits = silhouette.ptr<unsigned int>(y);
+			const int *above = integral.ptr<int>(y);
+			int *row = integral.ptr<int>(y + 1);
+
+			int sum = 0;
+			row[0] = 0;
+			for (int x = 0 ; x < this->m_FrustumSize.width ; ++x)
+			{
+				sum += (bits[x >> SILHOUETTE_WORD_SHIFT] >> (x & SILHOUETTE_WORD_MASK)) & 1;
+				row[x + 1] = above[x + 1] + sum;
+			}
+		}
+	}
+}
+
+cv::Point3f HierarchicalCarver::IndexToWorld(const int x, const int y, const int z) const
+{
+	const float *v = this->m_Volume;
+
+	const float px = float(this->m_Region[0] + x * this->m_Step);
+	const float py = float(this->m_Region[2] + y * this->m_Step);
+	const float pz = float(this->m_Region[4] + z * this->m_Step);
+
+	return cv::Point3f(
+		v[0] * px + v[1] * py + v[2] * pz + v[9],
+		v[3] * px + v[4] * py + v[5] * pz + v[10],
+		v[6] * px + v[7] * py + v[8] * pz + v[11]
+	);
+}
+
+bool HierarchicalCarver::Project(const int camera, const cv::Point3f &p, float &u, float &v) const
+{
+	const float *R = &this->m_R[camera * 9];
+	const float *t = &this->m_T[camera * 3];
+	const float *a = &this->m_A[camera * 9];
+	const float *k = &this->m_K[camera * 12];
+
+	float x = R[0] * p.x + R[1] * p.y + R[2] * p.z + t[0];
+	float y = R[3] * p.x + R[4] * p.y + R[5] * p.z + t[1];
+	float z = R[6] * p.x + R[7] * p.y + R[8] * p.z + t[2];
+
+	const bool inFront = z > 0;
+
+	z = z ? 1.0f / z : 1;
+	x *= z; y *= z;
+
+	const float r2 = x * x + y * y;
+	const float r4 = r2 * r2;
+	const float r6 = r4 * r2;
+	const float a1 = 2 * x * y;
+	const float a2 = r2 + 2 * x * x;
+	const float a3 = r2 + 2 * y * y;
+	const float cdist = 1 + k[0] * r2 + k[1] * r4 + k[4] * r6;
+	const float icdist2 = 1.0f / (1.0f + k[5] * r2 + k[6] * r4 + k[7] * r6);
+	const float xd = x * cdist * icdist2 + k[2] * a1 + k[3] * a2 + k[8] * r2 + k[9] * r4;
+	const float yd = y * cdist * icdist2 + k[2] * a3 + k[3] * a1 + k[10] * r2 + k[11] * r4;
+
+	u = xd * a[0] + a[2];
+	v = yd * a[4] + a[5];
+
+	return inFront;
+}
+
+HierarchicalCarver::Coverage HierarchicalCarver::Classify(const int min[3], const int edge) const
+{
+	// Blocks are clipped to the region, a clipped block can't be full as a whole
+	int max[3];
+	bool clipped = false;
+	for (int a = 0 ; a < 3 ; ++a)
+	{
+		if (min[a] >= this->m_NumVoxels[a])
+		{
+			return COVERAGE_EMPTY;
+		}
+
+		max[a] = min[a] + edge - 1;
+		if (max[a] >= this->m_NumVoxels[a])
+		{
+			max[a] = this->m_NumVoxels[a] - 1;
+			clipped = true;
+		}
+	}
+
+	Coverage coverage = clipped ? COVERAGE_MIXED : COVERAGE_FULL;
+	for (size_t c = 0 ; c < this->m_Cameras.size() ; ++c)
+	{
+		// Bounding rectangle of the projected corners, pixels are rounded up like the kernel does. Under a pinhole projection
+		// the projection of the block lies within this rectangle, lens distortion is assumed to be mild enough not to bend it out
+		float uMin = FLT_MAX, uMax = -FLT_MAX, vMin = FLT_MAX, vMax = -FLT_MAX;
+		bool inFront = true;
+		for (int i = 0 ; i < 8 && inFront ; ++i)
+		{
+			float u, v;
+			inFront = this->Project((int)c, this->IndexToWorld(i & 4 ? max[0] : min[0], i & 2 ? max[1] : min[1], i & 1 ? max[2] : min[2]), u, v);
+
+			uMin = u < uMin ? u : uMin; uMax = u > uMax ? u : uMax;
+			vMin = v < vMin ? v : vMin; vMax = v > vMax ? v : vMax;
+		}
+
+		if (!inFront)
+		{
+			coverage = COVERAGE_MIXED;
+			continue;
+		}
+
+		const int u0 = (int)ceil(uMin), u1 = (int)ceil(uMax);
+		const int v0 = (int)ceil(vMin), v1 = (int)ceil(vMax);
+
+		// Voxels projecting outside the region of interest are not seen by this camera and are carved away
+		const int *roi = &this->m_Roi[c * 4];
+		if (u1 < roi[0] || v1 < roi[1] || u0 >= roi[2] || v0 >= roi[3])
+		{
+			return COVERAGE_EMPTY;
+		}
+
+		if (u0 < roi[0] || v0 < roi[1] || u1 >= roi[2] || v1 >= roi[3])
+		{
+			coverage = COVERAGE_MIXED;
+			continue;
+		}
+
+		const cv::Mat &integral = this->m_Integrals[c];
+		const int sum = integral.at<int>(v1 + 1, u1 + 1) - integral.at<int>(v0, u1 + 1) - integral.at<int>(v1 + 1, u0) + integral.at<int>(v0, u0);
+
+		if (sum == 0)
+		{
+			return COVERAGE_EMPTY;
+		}
+
+		if (sum < (u1 - u0 + 1) * (v1 - v0 + 1))
+		{
+			coverage = COVERAGE_MIXED;
+		}
+	}
+
+	return coverage;
+}
+
+bool HierarchicalCarver::CarveVoxel(const int x, const int y, const int z, VisibleVoxel &voxel) const
+{
+	const cv::Point3f p = this->IndexToWorld(x, y, z);
+
+	int t_r = 0, t_g = 0, t_b = 0;
+	for (size_t c = 0 ; c < this->m_Cameras.size() ; ++c)
+	{
+		float u, v;
+		this->Project((int)c, p, u, v);
+
+		const int px = (int)ceil(u), py = (int)ceil(v);
+		const int *roi = &this->m_Roi[c * 4];
+		if (px < roi[0] || px >= roi[2] || py < roi[1] || py >= roi[3] || ((this->m_Silhouettes[c].ptr<unsigned int>(py)[px >> SILHOUETTE_WORD_SHIFT] >> (px & SILHOUETTE_WORD_MASK)) & 1) == 0)
+		{
+			return false;
+		}
+
+		const cv::Vec3b &color = this->m_Frames[c].at<cv::Vec3b>(py, px);
+		t_r += color[0];
+		t_g += color[1];
+		t_b += color[2];
+	}
+
+	const int n = (int)this->m_Cameras.size();
+
+	voxel.X = this->m_Region[0] + x * this->m_Step;
+	voxel.Y = this->m_Region[2] + y * this->m_Step;
+	voxel.Z = this->m_Region[4] + z * this->m_Step;
+
+	voxel.R = t_r / n;
+	voxel.G = t_g / n;
+	voxel.B = t_b / n;
+
+	return true;
+}
+
+void HierarchicalCarver::Carve(Octree *octree, OctreeNode *node, const int min[3], const int edge) const
+{
+	const Coverage coverage = this->Classify(min, edge);
+	if (coverage == COVERAGE_EMPTY)
+	{
+		return;
+	}
+
+	if (coverage == COVERAGE_FULL)
+	{
+		// The colour of a full node is the colour of its center voxel, only the surface of the hull is really seen anyway
+		VisibleVoxel center;
+		if (!this->CarveVoxel(min[0] + edge / 2, min[1] + edge / 2, min[2] + edge / 2, center))
+		{
+			center.R = center.G = center.B = 255;
+		}
+
+		octree->SetFull(node, center.R, center.G, center.B);
+
+		// Full blocks are never clipped, the whole block is inside the region
+		int lower[3], upper[3];
+		for (int a = 0 ; a < 3 ; ++a)
+		{
+			lower[a] = this->m_Region[a * 2] + min[a] * this->m_Step;
+			upper[a] = this->m_Region[a * 2] + (min[a] + edge - 1) * this->m_Step;
+		}
+		this->ExtendHull(lower, upper);
+		return;
+	}
+
+	// Small mixed blocks, test every voxel. Voxels are visited in Morton order, like the blocks above them, such that
+	// consecutive voxels project to nearby pixels
+	if (edge <= HIERARCHICAL_LEAF_EDGE)
+	{
+		// Collected per leaf, such that tasks only meet when the leaf is handed to the octree
+		std::vector<VisibleVoxel> voxels;
+		for (unsigned int i = 0 ; i < (unsigned int)(edge * edge * edge) ; ++i)
+		{
+			const int x = min[0] + morton_compact(i);
+			const int y = min[1] + morton_compact(i >> 1);
+			const int z = min[2] + morton_compact(i >> 2);
+
+			if (x >= this->m_NumVoxels[0] || y >= this->m_NumVoxels[1] || z >= this->m_NumVoxels[2])
+			{
+				continue;
+			}
+
+			VisibleVoxel voxel;
+			if (this->CarveVoxel(x, y, z, voxel))
+			{
+				voxels.push_back(voxel);
+			}
+		}
+
+		if (!voxels.empty())
+		{
+			int lower[3] = { voxels[0].X, voxels[0].Y, voxels[0].Z };
+			int upper[3] = { voxels[0].X, voxels[0].Y, voxels[0].Z };
+			for (size_t v = 1 ; v < voxels.size() ; ++v)
+			{
+				const int c[3] = { voxels[v].X, voxels[v].Y, voxels[v].Z };
+				for (int a = 0 ; a < 3 ; ++a)
+				{
+					lower[a] = c[a] < lower[a] ? c[a] : lower[a];
+					upper[a] = c[a] > upper[a] ? c[a] : upper[a];
+				}
+			}
+			this->ExtendHull(lower, upper);
+		}
+
+		octree->AddVoxels(node, voxels);
+		return;
+	}
+
+	octree->Split(node);
+
+	// Children are ordered as in OctreeNode::Subdivide, x is the most significant bit of the index
+	const int half = edge / 2;
+	for (unsigned int i = 0 ; i < 8 ; ++i)
+	{
+		OctreeNode *child = node->IdxToNodePointer(i);
+		const int childMin[3] = { min[0] + (i & 4 ? half : 0), min[1] + (i & 2 ? half : 0), min[2] + (i & 1 ? half : 0) };
+
+		#pragma omp task firstprivate(child, childMin)
+		{
+			this->Carve(octree, child, childMin, half);
+		}
+	}
+}
+
+Octree *HierarchicalCarver::Carve(const int region[6], const int step)
+{
+	if (step <= 0)
+	{
+		throw_line("Carving step should be positive");
+	}
+
+	memcpy(this->m_Region, region, sizeof(int) * 6);
+	this->m_Step = step;
+
+	// The root is the smallest power of two cube of voxels holding the region, such that blocks split evenly down to single voxels
+	int edge = 1;
+	for (int a = 0 ; a < 3 ; ++a)
+	{
+		this->m_NumVoxels[a] = (region[a * 2 + 1] - region[a * 2]) / step;
+		while (edge < this->m_NumVoxels[a])
+		{
+			edge <<= 1;
+		}
+	}
+
+	const float halfsize = edge * step * 0.5f;
+	const glm::vec3 center(region[0] + halfsize, region[2] + halfsize, region[4] + halfsize);
+
+	Octree *octree = new Octree(center, glm::vec3(halfsize, halfsize, halfsize));
+
+	const int min[3] = { 0, 0, 0 };
+
+	this->m_HasHull = false;
+
+	omp_set_num_threads(omp_get_max_threads());
+
+	#pragma omp parallel
+	{
+		#pragma omp single
+		{
+			this->Carve(octree, octree->GetRoot(), min, edge);
+		}
+	}
+
+	return octree;
+}
+
+void HierarchicalCarver::ExtendHull(const int min[3], const int max[3])
+{
+	#pragma omp critical(hierarchical_hull)
+	{
+		for (int a = 0 ; a < 3 ; ++a)
+		{
+			this->m_HullMin[a] = !this->m_HasHull || min[a] < this->m_HullMin[a] ? min[a] : this->m_HullMin[a];
+			this->m_HullMax[a] = !this->m_HasHull || max[a] > this->m_HullMax[a] ? max[a] : this->m_HullMax[a];
+		}
+
+		this->m_HasHull = true;
+	}
+}
+
+bool HierarchicalCarver::GetHullBounds(int min[3], int max[3]) const
+{
+	if (!this->m_HasHull)
+	{
+		return false;
+	}
+
+	for (int a = 0 ; a < 3 ; ++a)
+	{
+		min[a] = this->m_HullMin[a];
+		max[a] = this->m_HullMax[a];
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Camera.h"
+#include "Octree.h"
+
+// Blocks with at most this many voxels along an edge are no longer classified as a whole, their voxels are tested one by one
+#define HIERARCHICAL_LEAF_EDGE 4
+
+// Carves the voxel space top down and emits the octree directly. A block of voxels is projected into every camera, if the
+// bounding rectangle of its projection is foreground in every matte the block becomes a single full node, if it is
+// background in any matte the block is dropped, otherwise it is split. Mattes are tested through summed area tables, so
+// classifying a block costs the same regardless of its size
+class HierarchicalCarver
+{
+private:
+	enum Coverage
+	{
+		COVERAGE_EMPTY = 0,
+		COVERAGE_MIXED,
+		COVERAGE_FULL
+	};
+
+	const std::vector<Camera*> &m_Cameras;
+
+	// Rotation, translation, camera matrix and distortion per camera, laid out as for the carving kernel
+	std::vector<float> m_R, m_T, m_A, m_K;
+
+	// Region of interest per camera as x0, y0, x1, y1 (exclusive)
+	std::vector<int> m_Roi;
+
+	float m_Volume[12];
+
+	cv::Size m_FrustumSize;
+
+	// Host copies of the current frame, silhouettes are packed 1 bit per pixel, the integrals are their summed area tables
+	std::vector<cv::Mat> m_Silhouettes;
+	std::vector<cv::Mat> m_Integrals;
+	std::vector<cv::Mat> m_Frames;
+
+	// Region being carved and its size in voxels
+	int m_Region[6];
+	int m_Step;
+	int m_NumVoxels[3];
+
+	// Bounds of the carved hull in volume coordinates, kept while carving
+	int m_HullMin[3], m_HullMax[3];
+	bool m_HasHull;
+
+	// Grow the hull bounds by a block of voxels, safe to call from concurrent OpenMP tasks
+	void ExtendHull(const int min[3], const int max[3]);
+
+	cv::Point3f IndexToWorld(const int x, const int y, const int z) const;
+
+	// Returns false if the point is behind the camera
+	bool Project(const int camera, const cv::Point3f &p, float &u, float &v) const;
+
+	Coverage Classify(const int min[3], const int edge) const;
+
+	// Same test and colouring as the carving kernel
+	bool CarveVoxel(const int x, const int y, const int z, VisibleVoxel &voxel) const;
+
+	void Carve(Octree *octree, OctreeNode *node, const int min[3], const int edge) const;
+public:
+	HierarchicalCarver(const std::vector<Camera*> &cameras, const float *r, const float *t, const float *a, const float *k, const int *roi, const float *volume, const cv::Size &frustumSize);
+	~HierarchicalCarver(void);
+
+	// Fetch the mattes and frames of the current frame from the cameras
+	void Update(void);
+
+	// Carve the region (xL, xR, yL, yR, zL, zR) at the given step, the caller owns the returned octree
+	Octree *Carve(const int region[6], const int step);
+
+	// Bounds of the hull of the last carve in volume coordinates, returns false if nothing was carved
+	bool GetHullBounds(int min[3], int max[3]) const;
+};
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "Stdafx.h"
+
+#include "ImageSequenceFrameSource.h"
+#include "Exception.h"
+
+ImageSequenceFrameSource::ImageSequenceFrameSource(const std::string &directory)
+{
+	const char *extensions[] = { ".png", ".exr", ".tif", ".tiff", ".bmp", ".jpg", ".jpeg" };
+
+	boost::filesystem::directory_iterator end;
+	for (boost::filesystem::directory_iterator it(directory) ; it != end ; ++it)
+	{
+		if (!boost::filesystem::is_regular_file(it->status()))
+		{
+			continue;
+		}
+
+		std::string extension = it->path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+		for (size_t e = 0 ; e < sizeof(extensions) / sizeof(extensions[0]) ; ++e)
+		{
+			if (extension == extensions[e])
+			{
+				this->m_Files.push_back(it->path().string());
+				break;
+			}
+		}
+	}
+
+	if (this->m_Files.empty())
+	{
+		throw_line("No images in: " + directory);
+	}
+
+	// Frame numbers are expected to be zero padded
+	std::sort(this->m_Files.begin(), this->m_Files.end());
+
+	cv::Mat first;
+	this->m_Position = 0;
+	if (!this->Read(first))
+	{
+		throw_line("Unable to read: " + this->m_Files.front());
+	}
+
+	this->m_Size = first.size();
+	this->m_Position = 0;
+}
+
+ImageSequenceFrameSource::~ImageSequenceFrameSource(void)
+{
+}
+
+bool ImageSequenceFrameSource::Read(cv::Mat &frame)
+{
+	if (this->m_Position < 0 || this->m_Position >= (int)this->m_Files.size())
+	{
+		return false;
+	}
+
+	cv::Mat image = cv::imread(this->m_Files[this->m_Position], CV_LOAD_IMAGE_ANYDEPTH | CV_LOAD_IMAGE_ANYCOLOR);
+	if (image.empty())
+	{
+		return false;
+	}
+
+	if (image.depth() == CV_16U)
+	{
+		image.convertTo(image, CV_8U, 1.0 / 257.0);
+	}
+	else if (image.depth() == CV_32F)
+	{
+		image.convertTo(image, CV_8U, 255.0);
+	}
+
+	if (image.channels() == 4)
+	{
+		cv::cvtColor(image, image, CV_BGRA2BGR);
+	}
+
+	frame = image;
+	++this->m_Position;
+
+	return true;
+}
\ No newline at end of file
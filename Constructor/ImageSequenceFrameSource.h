@@ -0,0 +1,55 @@
+#pragma once
+
+#include "FrameSource.h"
+
+// Frames stored as numbered images in a directory (PNG, EXR, TIFF, ...), in order of their file names. Deep images are
+// scaled to 8 bit, floating point images are taken to be 0 - 1. Images carry no timing, see Common::TimestampsFile
+class ImageSequenceFrameSource : public FrameSource
+{
+private:
+	std::vector<std::string> m_Files;
+
+	cv::Size m_Size;
+
+	int m_Position;
+public:
+	ImageSequenceFrameSource(const std::string &directory);
+	~ImageSequenceFrameSource(void);
+
+	const cv::Size &GetSize(void) const
+	{
+		return this->m_Size;
+	}
+
+	long GetNumFrames(void) const
+	{
+		return (long)this->m_Files.size();
+	}
+
+	FrameFormat GetFormat(void) const
+	{
+		return FRAME_FORMAT_BGR;
+	}
+
+	double GetFrameRate(void) const
+	{
+		return 0;
+	}
+
+	int GetPosition(void) const
+	{
+		return this->m_Position;
+	}
+
+	void Seek(const int frame)
+	{
+		this->m_Position = frame;
+	}
+
+	bool Read(cv::Mat &frame);
+
+	double GetTimestamp(void) const
+	{
+		return -1;
+	}
+};
\ No newline at end of file
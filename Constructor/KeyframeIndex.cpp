@@ -0,0 +1,712 @@
+#include "Stdafx.h"
+
+#include "KeyframeIndex.h"
+#include "Exception.h"
+
+// Matroska element ids, with their length marker
+#define EBML_SEGMENT 0x18538067
+#define EBML_INFO 0x1549A966
+#define EBML_TIMECODE_SCALE 0x2AD7B1
+#define EBML_TRACKS 0x1654AE6B
+#define EBML_TRACK_ENTRY 0xAE
+#define EBML_TRACK_NUMBER 0xD7
+#define EBML_TRACK_TYPE 0x83
+#define EBML_CLUSTER 0x1F43B675
+#define EBML_CLUSTER_TIMECODE 0xE7
+#define EBML_SIMPLE_BLOCK 0xA3
+#define EBML_BLOCK_GROUP 0xA0
+#define EBML_BLOCK 0xA1
+#define EBML_CUES 0x1C53BB6B
+#define EBML_CUE_POINT 0xBB
+#define EBML_CUE_TIME 0xB3
+#define EBML_CUE_TRACK_POSITIONS 0xB7
+#define EBML_CUE_TRACK 0xF7
+
+// Track type of video tracks
+#define MATROSKA_TRACK_VIDEO 1
+
+// Bump when the frame numbers of the index change meaning, cached indices of another version are rebuilt
+#define KEYFRAME_INDEX_VERSION 2
+
+// Element sizes with all value bits set are unknown, the element runs until its parent ends
+#define EBML_UNKNOWN_SIZE ~0ull
+
+// Read a variable length integer, ids keep their length marker and sizes lose it
+static bool read_vint(std::ifstream &in, unsigned long long int &value, const bool keepMarker)
+{
+	const int first = in.get();
+	if (first == EOF || first == 0)
+	{
+		return false;
+	}
+
+	int length = 1;
+	while ((first & (0x80 >> (length - 1))) == 0)
+	{
+		++length;
+	}
+
+	value = keepMarker ? first : first & (0xFF >> length);
+	bool allOnes = value == (unsigned long long int)(0xFF >> length);
+	for (int i = 1 ; i < length ; ++i)
+	{
+		const int b = in.get();
+		if (b == EOF)
+		{
+			return false;
+		}
+
+		value = (value << 8) | b;
+		allOnes &= b == 0xFF;
+	}
+
+	if (!keepMarker && allOnes)
+	{
+		value = EBML_UNKNOWN_SIZE;
+	}
+
+	return true;
+}
+
+static bool read_element(std::ifstream &in, unsigned long long int &id, unsigned long long int &size)
+{
+	return read_vint(in, id, true) && read_vint(in, size, false);
+}
+
+static unsigned long long int read_uint(std::ifstream &in, const unsigned long long int size)
+{
+	unsigned long long int value = 0;
+	for (unsigned long long int i = 0 ; i < size ; ++i)
+	{
+		value = (value << 8) | (unsigned char)in.get();
+	}
+
+	return value;
+}
+
+// Big endian integers of the MP4 boxes
+static unsigned long long int read_be(std::ifstream &in, const int bytes)
+{
+	return read_uint(in, bytes);
+}
+
+// Find the first child box of the given type in [begin, end), returns the range of its contents
+static bool find_box(std::ifstream &in, const unsigned long long int begin, const unsigned long long int end, const char *type, unsigned long long int &contentBegin, unsigned long long int &contentEnd)
+{
+	unsigned long long int position = begin;
+	while (position + 8 <= end)
+	{
+		in.clear();
+		in.seekg(position);
+
+		unsigned long long int size = read_be(in, 4);
+		char name[4];
+		in.read(name, 4);
+		if (!in)
+		{
+			return false;
+		}
+
+		unsigned long long int header = 8;
+		if (size == 1)
+		{
+			size = read_be(in, 8);
+			header = 16;
+		}
+		else if (size == 0)
+		{
+			size = end - position;
+		}
+
+		if (size < header || position + size > end)
+		{
+			return false;
+		}
+
+		if (memcmp(name, type, 4) == 0)
+		{
+			contentBegin = position + header;
+			contentEnd = position + size;
+			return true;
+		}
+
+		position += size;
+	}
+
+	return false;
+}
+
+// Frame numbers count frames in presentation order, the order of their timestamps. Seeks by frame number assume a
+// constant frame rate, frames that don't follow one can't be sought to reliably
+static bool is_constant_rate(const std::vector<long long int> &timestamps)
+{
+	if (timestamps.size() < 2)
+	{
+		return true;
+	}
+
+	const double duration = double(timestamps.back() - timestamps.front()) / (timestamps.size() - 1);
+	for (size_t i = 1 ; i < timestamps.size() ; ++i)
+	{
+		if (fabs(double(timestamps[i] - timestamps[i - 1]) - duration) > duration / 2)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Presentation time of the frame in a (simple) block, false if the block belongs to another track
+static bool read_block(std::ifstream &in, const unsigned long long int track, const long long int clusterTimecode, long long int &timestamp)
+{
+	unsigned long long int blockTrack;
+	if (!read_vint(in, blockTrack, false) || blockTrack != track)
+	{
+		return false;
+	}
+
+	const short relative = (short)read_uint(in, 2);
+	timestamp = clusterTimecode + relative;
+
+	return !!in;
+}
+
+KeyframeIndex::KeyframeIndex(const std::string &file) : m_File(file)
+{
+	const boost::filesystem::path path(file);
+	if (!boost::filesystem::exists(path))
+	{
+		return;
+	}
+
+	const unsigned long long int size = boost::filesystem::file_size(path);
+	const long long int modified = (long long int)boost::filesystem::last_write_time(path);
+
+	if (this->Load(size, modified))
+	{
+		return;
+	}
+
+	if (!this->ParseMatroska() && !this->ParseMp4())
+	{
+		this->m_Keyframes.clear();
+	}
+
+	std::sort(this->m_Keyframes.begin(), this->m_Keyframes.end());
+	this->m_Keyframes.erase(std::unique(this->m_Keyframes.begin(), this->m_Keyframes.end()), this->m_Keyframes.end());
+
+	// The first frame can always be sought to
+	if (!this->m_Keyframes.empty() && this->m_Keyframes.front() != 0)
+	{
+		this->m_Keyframes.insert(this->m_Keyframes.begin(), 0);
+	}
+
+	this->Save(size, modified);
+}
+
+KeyframeIndex::~KeyframeIndex(void)
+{
+}
+
+bool KeyframeIndex::Load(const unsigned long long int size, const long long int modified)
+{
+	cv::FileStorage fs;
+	fs.open(this->m_File + ".keyframes.xml", cv::FileStorage::READ);
+	if (!fs.isOpened())
+	{
+		return false;
+	}
+
+	// Sizes and times are stored as text, integers in the file storage are only 32 bit
+	int version = 0;
+	std::string cachedSize, cachedModified;
+	fs["Version"] >> version;
+	fs["Size"] >> cachedSize;
+	fs["Modified"] >> cachedModified;
+
+	std::ostringstream s, m;
+	s << size;
+	m << modified;
+	if (version != KEYFRAME_INDEX_VERSION || cachedSize != s.str() || cachedModified != m.str())
+	{
+		return false;
+	}
+
+	fs["Keyframes"] >> this->m_Keyframes;
+
+	return true;
+}
+
+void KeyframeIndex::Save(const unsigned long long int size, const long long int modified) const
+{
+	cv::FileStorage fs;
+	fs.open(this->m_File + ".keyframes.xml", cv::FileStorage::WRITE);
+	if (!fs.isOpened())
+	{
+		return;
+	}
+
+	std::ostringstream s, m;
+	s << size;
+	m << modified;
+
+	fs << "Version" << KEYFRAME_INDEX_VERSION;
+	fs << "Size" << s.str();
+	fs << "Modified" << m.str();
+	fs << "Keyframes" << this->m_Keyframes;
+}
+
+bool KeyframeIndex::ParseMatroska(void)
+{
+	std::ifstream in(this->m_File.c_str(), std::ios::binary);
+	if (!in.is_open())
+	{
+		return false;
+	}
+
+	in.seekg(0, std::ios::end);
+	const unsigned long long int fileSize = in.tellg();
+	in.seekg(0);
+
+	// EBML header
+	unsigned long long int id, size;
+	if (!read_element(in, id, size) || id != 0x1A45DFA3 || size == EBML_UNKNOWN_SIZE)
+	{
+		return false;
+	}
+	in.seekg(size, std::ios::cur);
+
+	if (!read_element(in, id, size) || id != EBML_SEGMENT)
+	{
+		return false;
+	}
+
+	const unsigned long long int segment = in.tellg();
+	const unsigned long long int segmentEnd = size == EBML_UNKNOWN_SIZE || segment + size > fileSize ? fileSize : segment + size;
+
+	// Walk the top level elements for the timecode scale, the video track, the cues and the timestamps of the frames of
+	// the video track in every cluster. Clusters of unknown size can't be skipped, their frames can't be counted
+	unsigned long long int timecodeScale = 1000000, videoTrack = 0, cues = 0, cuesSize = 0;
+	std::vector<long long int> timestamps;
+	unsigned long long int position = segment;
+	while (position < segmentEnd)
+	{
+		in.clear();
+		in.seekg(position);
+		if (!read_element(in, id, size))
+		{
+			break;
+		}
+
+		const unsigned long long int content = in.tellg();
+		if (size == EBML_UNKNOWN_SIZE)
+		{
+			return false;
+		}
+
+		const unsigned long long int end = content + size;
+
+		if (id == EBML_INFO)
+		{
+			while ((unsigned long long int)in.tellg() < end)
+			{
+				unsigned long long int childId, childSize;
+				if (!read_element(in, childId, childSize))
+				{
+					break;
+				}
+
+				const unsigned long long int childEnd = (unsigned long long int)in.tellg() + childSize;
+				if (childId == EBML_TIMECODE_SCALE)
+				{
+					timecodeScale = read_uint(in, childSize);
+				}
+
+				in.clear();
+				in.seekg(childEnd);
+			}
+		}
+		else if (id == EBML_TRACKS)
+		{
+			// The first video track
+			while ((unsigned long long int)in.tellg() < end && videoTrack == 0)
+			{
+				unsigned long long int entryId, entrySize;
+				if (!read_element(in, entryId, entrySize))
+				{
+					break;
+				}
+
+				const unsigned long long int entryEnd = (unsigned long long int)in.tellg() + entrySize;
+				if (entryId == EBML_TRACK_ENTRY)
+				{
+					unsigned long long int number = 0, type = 0;
+					while ((unsigned long long int)in.tellg() < entryEnd)
+					{
+						unsigned long long int childId, childSize;
+						if (!read_element(in, childId, childSize))
+						{
+							break;
+						}
+
+						if (childId == EBML_TRACK_NUMBER)
+						{
+							number = read_uint(in, childSize);
+						}
+						else if (childId == EBML_TRACK_TYPE)
+						{
+							type = read_uint(in, childSize);
+						}
+						else
+						{
+							in.seekg(childSize, std::ios::cur);
+						}
+					}
+
+					if (type == MATROSKA_TRACK_VIDEO)
+					{
+						videoTrack = number;
+					}
+				}
+
+				in.clear();
+				in.seekg(entryEnd);
+			}
+		}
+		else if (id == EBML_CLUSTER)
+		{
+			// Blocks are stored in decode order, their timestamps are presentation times
+			long long int clusterTimecode = 0;
+			while ((unsigned long long int)in.tellg() < end)
+			{
+				unsigned long long int childId, childSize;
+				if (!read_element(in, childId, childSize) || childSize == EBML_UNKNOWN_SIZE)
+				{
+					break;
+				}
+
+				const unsigned long long int childEnd = (unsigned long long int)in.tellg() + childSize;
+
+				long long int timestamp;
+				if (childId == EBML_CLUSTER_TIMECODE)
+				{
+					clusterTimecode = (long long int)read_uint(in, childSize);
+				}
+				else if (childId == EBML_SIMPLE_BLOCK)
+				{
+					if (read_block(in, videoTrack, clusterTimecode, timestamp))
+					{
+						timestamps.push_back(timestamp);
+					}
+				}
+				else if (childId == EBML_BLOCK_GROUP)
+				{
+					while ((unsigned long long int)in.tellg() < childEnd)
+					{
+						unsigned long long int blockId, blockSize;
+						if (!read_element(in, blockId, blockSize))
+						{
+							break;
+						}
+
+						const unsigned long long int blockEnd = (unsigned long long int)in.tellg() + blockSize;
+						if (blockId == EBML_BLOCK && read_block(in, videoTrack, clusterTimecode, timestamp))
+						{
+							timestamps.push_back(timestamp);
+						}
+
+						in.clear();
+						in.seekg(blockEnd);
+					}
+				}
+
+				in.clear();
+				in.seekg(childEnd);
+			}
+		}
+		else if (id == EBML_CUES)
+		{
+			cues = content;
+			cuesSize = size;
+		}
+
+		position = end;
+	}
+
+	// Tracks come before the clusters, blocks seen without a video track weren't counted
+	if (cues == 0 || videoTrack == 0 || timestamps.empty())
+	{
+		return false;
+	}
+
+	std::sort(timestamps.begin(), timestamps.end());
+	if (!is_constant_rate(timestamps))
+	{
+		std::cout << "Frames of " << this->m_File << " don't follow a constant frame rate, seeks are left to the capture" << std::endl;
+
+		return false;
+	}
+
+	// Cue points of the video track, cue times are in timecode scale units like the block timestamps. The frame number is
+	// the position of the cue time among the timestamps
+	const unsigned long long int cuesEnd = cues + cuesSize;
+	in.clear();
+	in.seekg(cues);
+	while ((unsigned long long int)in.tellg() < cuesEnd)
+	{
+		if (!read_element(in, id, size))
+		{
+			break;
+		}
+
+		const unsigned long long int end = (unsigned long long int)in.tellg() + size;
+		if (id == EBML_CUE_POINT)
+		{
+			long long int time = -1;
+			bool isVideo = false;
+			while ((unsigned long long int)in.tellg() < end)
+			{
+				unsigned long long int childId, childSize;
+				if (!read_element(in, childId, childSize))
+				{
+					break;
+				}
+
+				const unsigned long long int childEnd = (unsigned long long int)in.tellg() + childSize;
+				if (childId == EBML_CUE_TIME)
+				{
+					time = (long long int)read_uint(in, childSize);
+				}
+				else if (childId == EBML_CUE_TRACK_POSITIONS)
+				{
+					while ((unsigned long long int)in.tellg() < childEnd)
+					{
+						unsigned long long int positionId, positionSize;
+						if (!read_element(in, positionId, positionSize))
+						{
+							break;
+						}
+
+						if (positionId == EBML_CUE_TRACK)
+						{
+							isVideo |= read_uint(in, positionSize) == videoTrack;
+						}
+						else
+						{
+							in.seekg(positionSize, std::ios::cur);
+						}
+					}
+				}
+
+				in.clear();
+				in.seekg(childEnd);
+			}
+
+			std::vector<long long int>::const_iterator frame = std::lower_bound(timestamps.begin(), timestamps.end(), time);
+			if (isVideo && frame != timestamps.end() && *frame == time)
+			{
+				this->m_Keyframes.push_back((int)(frame - timestamps.begin()));
+			}
+		}
+
+		in.clear();
+		in.seekg(end);
+	}
+
+	return !this->m_Keyframes.empty();
+}
+
+bool KeyframeIndex::ParseMp4(void)
+{
+	std::ifstream in(this->m_File.c_str(), std::ios::binary);
+	if (!in.is_open())
+	{
+		return false;
+	}
+
+	in.seekg(0, std::ios::end);
+	const unsigned long long int fileSize = in.tellg();
+
+	unsigned long long int moov, moovEnd;
+	if (!find_box(in, 0, fileSize, "moov", moov, moovEnd))
+	{
+		return false;
+	}
+
+	// The sample tables of the first video track, sample numbers start at 1
+	unsigned long long int trak = moov, trakEnd;
+	while (find_box(in, trak, moovEnd, "trak", trak, trakEnd))
+	{
+		unsigned long long int mdia, mdiaEnd, hdlr, hdlrEnd, minf, minfEnd, stbl, stblEnd, stss, stssEnd, stts, sttsEnd, ctts, cttsEnd;
+		if (find_box(in, trak, trakEnd, "mdia", mdia, mdiaEnd) && find_box(in, mdia, mdiaEnd, "hdlr", hdlr, hdlrEnd))
+		{
+			// Version and flags, pre defined, then the handler type
+			char handler[4];
+			in.clear();
+			in.seekg(hdlr + 8);
+			in.read(handler, 4);
+
+			if (in && memcmp(handler, "vide", 4) == 0 && find_box(in, mdia, mdiaEnd, "minf", minf, minfEnd) && find_box(in, minf, minfEnd, "stbl", stbl, stblEnd))
+			{
+				// Without a sync sample table every sample is a keyframe, there's nothing to gain from an index
+				if (!find_box(in, stbl, stblEnd, "stss", stss, stssEnd) || !find_box(in, stbl, stblEnd, "stts", stts, sttsEnd))
+				{
+					return false;
+				}
+
+				// Decode times of the samples, runs of samples with the same duration. Every sample takes a byte at least, a
+				// corrupt table can't run past the size of the file
+				std::vector<long long int> timestamps;
+				in.clear();
+				in.seekg(stts + 4);
+				unsigned long long int entries = read_be(in, 4);
+				long long int time = 0;
+				for (unsigned long long int i = 0 ; i < entries && in ; ++i)
+				{
+					const unsigned long long int count = read_be(in, 4);
+					const long long int duration = (long long int)read_be(in, 4);
+					for (unsigned long long int j = 0 ; j < count && timestamps.size() < fileSize ; ++j)
+					{
+						timestamps.push_back(time);
+						time += duration;
+					}
+				}
+
+				// Samples are stored in decode order, the composition offsets give the presentation times. Offsets of version 0
+				// are unsigned but written signed by many muxers, both versions are read signed
+				if (find_box(in, stbl, stblEnd, "ctts", ctts, cttsEnd))
+				{
+					in.clear();
+					in.seekg(ctts + 4);
+					entries = read_be(in, 4);
+
+					size_t sample = 0;
+					for (unsigned long long int i = 0 ; i < entries && in ; ++i)
+					{
+						const unsigned long long int count = read_be(in, 4);
+						const long long int offset = (int)(unsigned int)read_be(in, 4);
+						for (unsigned long long int j = 0 ; j < count && sample < timestamps.size() ; ++j)
+						{
+							timestamps[sample++] += offset;
+						}
+					}
+				}
+
+				if (!in || timestamps.empty())
+				{
+					return false;
+				}
+
+				// Frame number of every sample, its position in presentation order
+				std::vector<std::pair<long long int, int> > order(timestamps.size());
+				for (size_t i = 0 ; i < order.size() ; ++i)
+				{
+					order[i] = std::make_pair(timestamps[i], (int)i);
+				}
+
+				std::sort(order.begin(), order.end());
+
+				std::vector<int> frames(order.size());
+				std::vector<long long int> sorted(order.size());
+				for (size_t i = 0 ; i < order.size() ; ++i)
+				{
+					frames[order[i].second] = (int)i;
+					sorted[i] = order[i].first;
+				}
+
+				if (!is_constant_rate(sorted))
+				{
+					std::cout << "Frames of " << this->m_File << " don't follow a constant frame rate, seeks are left to the capture" << std::endl;
+
+					return false;
+				}
+
+				// An edit list that starts the video after its first frame makes the decoder drop the frames before, depending on
+				// its version. The frames can't be counted reliably
+				unsigned long long int edts, edtsEnd, elst, elstEnd;
+				if (find_box(in, trak, trakEnd, "edts", edts, edtsEnd) && find_box(in, edts, edtsEnd, "elst", elst, elstEnd))
+				{
+					in.clear();
+					in.seekg(elst);
+					const int version = in.get();
+					in.seekg(3, std::ios::cur);
+					entries = read_be(in, 4);
+
+					for (unsigned long long int i = 0 ; i < entries && in ; ++i)
+					{
+						read_be(in, version == 1 ? 8 : 4);
+						const long long int mediaTime = version == 1 ? (long long int)read_be(in, 8) : (int)(unsigned int)read_be(in, 4);
+						read_be(in, 4);
+
+						// Empty edits only delay the video
+						if (mediaTime == -1)
+						{
+							continue;
+						}
+
+						if (mediaTime > sorted.front())
+						{
+							std::cout << "The edit list of " << this->m_File << " skips frames, seeks are left to the capture" << std::endl;
+
+							return false;
+						}
+
+						break;
+					}
+				}
+
+				in.clear();
+				in.seekg(stss + 4);
+				entries = read_be(in, 4);
+				for (unsigned long long int i = 0 ; i < entries && in ; ++i)
+				{
+					const unsigned long long int sample = read_be(in, 4);
+					if (sample >= 1 && sample <= frames.size())
+					{
+						this->m_Keyframes.push_back(frames[(size_t)sample - 1]);
+					}
+				}
+
+				return in && !this->m_Keyframes.empty();
+			}
+		}
+
+		trak = trakEnd;
+	}
+
+	return false;
+}
+
+int KeyframeIndex::GetKeyframe(const int frame) const
+{
+	std::vector<int>::const_iterator it = std::upper_bound(this->m_Keyframes.begin(), this->m_Keyframes.end(), frame);
+
+	return it == this->m_Keyframes.begin() ? 0 : *(it - 1);
+}
+
+void KeyframeIndex::Seek(cv::VideoCapture &video, const int current, const int frame) const
+{
+	if (frame == current)
+	{
+		return;
+	}
+
+	if (this->m_Keyframes.empty())
+	{
+		video.set(CV_CAP_PROP_POS_FRAMES, frame);
+		return;
+	}
+
+	int position = current;
+
+	const int keyframe = this->GetKeyframe(frame);
+	if (frame < current || keyframe > current)
+	{
+		video.set(CV_CAP_PROP_POS_FRAMES, keyframe);
+		position = keyframe;
+	}
+
+	// Frames up to the one we want are decoded but not converted
+	for ( ; position < frame && video.grab() ; ++position);
+}
\ No newline at end of file
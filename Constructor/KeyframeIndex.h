@@ -0,0 +1,42 @@
+#pragma once
+
+// Frame numbers of the keyframes of a video, read from the container: the cues of the video track of a Matroska file or
+// the sync sample table of the video track of an MP4 file. Frames are numbered in presentation order, through the block
+// timestamps of the track or the decode times and composition offsets of the samples, B-frames included. The index is
+// cached next to the video (file + ".keyframes.xml") and rebuilt when the video changes. Without an index seeks are left
+// to the capture, which is also the case for videos without a constant frame rate
+class KeyframeIndex
+{
+private:
+	const std::string m_File;
+
+	// Sorted keyframe numbers
+	std::vector<int> m_Keyframes;
+
+	bool Load(const unsigned long long int size, const long long int modified);
+	void Save(const unsigned long long int size, const long long int modified) const;
+
+	bool ParseMatroska(void);
+	bool ParseMp4(void);
+public:
+	KeyframeIndex(const std::string &file);
+	~KeyframeIndex(void);
+
+	bool IsEmpty(void) const
+	{
+		return this->m_Keyframes.empty();
+	}
+
+	size_t GetNumKeyframes(void) const
+	{
+		return this->m_Keyframes.size();
+	}
+
+	// Last keyframe at or before the frame
+	int GetKeyframe(const int frame) const;
+
+	// Position the capture such that it reads the given frame next, current is the frame it would read next now. When no
+	// keyframe lies in between the capture decodes forward from where it is, otherwise it seeks to the keyframe before the
+	// frame and decodes forward from there. Nothing happens if the frame is next anyway
+	void Seek(cv::VideoCapture &video, const int current, const int frame) const;
+};
\ No newline at end of file
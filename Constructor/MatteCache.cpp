@@ -0,0 +1,333 @@
+#include "Stdafx.h"
+
+#include "MatteCache.h"
+#include "Exception.h"
+
+#include "silhouette.cuh"
+
+// Set bits [from, to) of a packed silhouette row
+static inline void set_bits(unsigned int *row, int from, const int to)
+{
+	while (from < to)
+	{
+		const int bit = from & SILHOUETTE_WORD_MASK;
+		const int n = to - from < SILHOUETTE_WORD_BITS - bit ? to - from : SILHOUETTE_WORD_BITS - bit;
+
+		row[from >> SILHOUETTE_WORD_SHIFT] |= (n == SILHOUETTE_WORD_BITS ? 0xffffffffu : ((1u << n) - 1)) << bit;
+
+		from += n;
+	}
+}
+
+MatteCache::MatteCache(const std::string &file, const cv::Size &size, const unsigned long long int signature) : m_File(file), m_Size(size), m_Signature(signature)
+{
+	// Run lengths are 16 bit, a run never spans more than a row
+	if (size.width <= 0 || size.width > USHRT_MAX)
+	{
+		throw_line("Matte cache can't hold frames of this width");
+	}
+
+	this->m_DataSize = 0;
+	this->m_KeySignature = 0;
+	this->m_IsDirty = false;
+
+	// Continue a previous cache, a cache without a valid index or made with other settings is started over
+	if (this->Load())
+	{
+		this->m_Writer.open(this->m_File.c_str(), std::ios::out | std::ios::app | std::ios::binary);
+	}
+	else
+	{
+		this->m_Index.clear();
+		this->m_DataSize = 0;
+		this->m_KeySignature = 0;
+
+		this->m_Writer.open(this->m_File.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+	}
+
+	if (!this->m_Writer.good())
+	{
+		throw_line("Could not open matte cache for writing");
+	}
+}
+
+MatteCache::~MatteCache(void)
+{
+	if (this->m_IsDirty)
+	{
+		this->Flush();
+	}
+
+	if (this->m_Reader.is_open())
+	{
+		this->m_Reader.close();
+	}
+
+	if (this->m_Writer.is_open())
+	{
+		this->m_Writer.close();
+	}
+}
+
+bool MatteCache::Load(void)
+{
+	std::ifstream index((this->m_File + ".idx").c_str(), std::ios::in | std::ios::binary);
+	if (!index.good() || !boost::filesystem::exists(this->m_File))
+	{
+		return false;
+	}
+
+	int width = 0, height = 0;
+	unsigned long long int signature = 0;
+	unsigned int numFrames = 0;
+	index.read((char*)&width, sizeof(int));
+	index.read((char*)&height, sizeof(int));
+	index.read((char*)&signature, sizeof(unsigned long long int));
+	index.read((char*)&this->m_KeySignature, sizeof(unsigned long long int));
+	index.read((char*)&numFrames, sizeof(unsigned int));
+
+	// Cached for another resolution or with other settings
+	if (!index.good() || width != this->m_Size.width || height != this->m_Size.height)
+	{
+		return false;
+	}
+
+	if (signature != this->m_Signature)
+	{
+		std::cout << "Matte cache " << this->m_File << " was made with other settings, starting over" << std::endl;
+
+		return false;
+	}
+
+	std::vector<MatteCacheEntry> entries(numFrames);
+	if (numFrames > 0)
+	{
+		index.read((char*)&entries[0], sizeof(MatteCacheEntry) * numFrames);
+	}
+
+	if (!index.good())
+	{
+		return false;
+	}
+
+	std::vector<MatteCacheEntry>::const_iterator it;
+	for (it = entries.begin() ; it != entries.end() ; ++it)
+	{
+		this->m_Index[it->Frame] = *it;
+		this->m_DataSize = it->Offset + it->Size > this->m_DataSize ? it->Offset + it->Size : this->m_DataSize;
+	}
+
+	// Frames appended after the index was last written are lost, cut them off such that new frames land where the index
+	// expects them
+	const unsigned long long int fileSize = boost::filesystem::file_size(this->m_File);
+	if (fileSize < this->m_DataSize)
+	{
+		return false;
+	}
+	else if (fileSize > this->m_DataSize)
+	{
+		boost::filesystem::resize_file(this->m_File, this->m_DataSize);
+	}
+
+	return true;
+}
+
+void MatteCache::WriteIndex(void)
+{
+	std::ofstream index((this->m_File + ".idx").c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!index.good())
+	{
+		throw_line("Could not open matte cache index for writing");
+	}
+
+	const unsigned int numFrames = (unsigned int)this->m_Index.size();
+	index.write((const char*)&this->m_Size.width, sizeof(int));
+	index.write((const char*)&this->m_Size.height, sizeof(int));
+	index.write((const char*)&this->m_Signature, sizeof(unsigned long long int));
+	index.write((const char*)&this->m_KeySignature, sizeof(unsigned long long int));
+	index.write((const char*)&numFrames, sizeof(unsigned int));
+
+	std::map<int, MatteCacheEntry>::const_iterator it;
+	for (it = this->m_Index.begin() ; it != this->m_Index.end() ; ++it)
+	{
+		index.write((const char*)&it->second, sizeof(MatteCacheEntry));
+	}
+
+	index.close();
+}
+
+void MatteCache::Clear(void)
+{
+	this->m_Index.clear();
+	this->m_DataSize = 0;
+
+	if (this->m_Reader.is_open())
+	{
+		this->m_Reader.close();
+	}
+
+	this->m_Writer.close();
+	this->m_Writer.open(this->m_File.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!this->m_Writer.good())
+	{
+		throw_line("Could not open matte cache for writing");
+	}
+
+	this->m_IsDirty = true;
+}
+
+void MatteCache::SetKeySignature(const unsigned long long int signature)
+{
+	if (signature == this->m_KeySignature)
+	{
+		return;
+	}
+
+	if (!this->m_Index.empty())
+	{
+		std::cout << "Matte cache " << this->m_File << " was keyed with other parameters, starting over" << std::endl;
+
+		this->Clear();
+	}
+
+	this->m_KeySignature = signature;
+	this->m_IsDirty = true;
+}
+
+void MatteCache::Flush(void)
+{
+	this->m_Writer.flush();
+
+	this->WriteIndex();
+
+	this->m_IsDirty = false;
+}
+
+void MatteCache::AddFrame(const int frame, const cv::Mat &silhouette)
+{
+	assert(silhouette.type() == CV_32SC1);
+	assert(silhouette.rows == this->m_Size.height && silhouette.cols == silhouette_words(this->m_Size.width));
+
+	if (this->HasFrame(frame))
+	{
+		return;
+	}
+
+	const int width = this->m_Size.width;
+
+	this->m_Runs.clear();
+	for (int y = 0 ; y < silhouette.rows ; ++y)
+	{
+		const unsigned int *bits = silhouette.ptr<unsigned int>(y);
+
+		bool value = false;
+		unsigned int run = 0;
+		for (int x = 0 ; x < width ; )
+		{
+			const unsigned int word = bits[x >> SILHOUETTE_WORD_SHIFT];
+
+			// Whole words of the current value extend the run at once
+			if ((x & SILHOUETTE_WORD_MASK) == 0 && x + SILHOUETTE_WORD_BITS <= width && word == (value ? 0xffffffffu : 0u))
+			{
+				run += SILHOUETTE_WORD_BITS;
+				x += SILHOUETTE_WORD_BITS;
+				continue;
+			}
+
+			const bool bit = ((word >> (x & SILHOUETTE_WORD_MASK)) & 1) != 0;
+			if (bit != value)
+			{
+				this->m_Runs.push_back((unsigned short)run);
+
+				run = 0;
+				value = bit;
+			}
+
+			++run;
+			++x;
+		}
+
+		this->m_Runs.push_back((unsigned short)run);
+	}
+
+	MatteCacheEntry entry;
+	entry.Frame = frame;
+	entry.Offset = this->m_DataSize;
+	entry.Size = (unsigned int)(this->m_Runs.size() * sizeof(unsigned short));
+
+	this->m_Writer.write((const char*)&this->m_Runs[0], entry.Size);
+	this->m_Writer.flush();
+	if (!this->m_Writer.good())
+	{
+		throw_line("Failed to write frame to matte cache");
+	}
+
+	this->m_Index[frame] = entry;
+	this->m_DataSize += entry.Size;
+	this->m_IsDirty = true;
+}
+
+bool MatteCache::GetFrame(const int frame, cv::Mat &silhouette)
+{
+	std::map<int, MatteCacheEntry>::const_iterator it = this->m_Index.find(frame);
+	if (it == this->m_Index.end())
+	{
+		return false;
+	}
+
+	const MatteCacheEntry &entry = it->second;
+
+	if (!this->m_Reader.is_open())
+	{
+		this->m_Reader.open(this->m_File.c_str(), std::ios::in | std::ios::binary);
+	}
+
+	// A previous read may have hit the end of the file before more frames were appended
+	this->m_Reader.clear();
+	this->m_Reader.seekg(entry.Offset);
+
+	this->m_Runs.resize(entry.Size / sizeof(unsigned short));
+	this->m_Reader.read((char*)&this->m_Runs[0], entry.Size);
+	if (!this->m_Reader.good())
+	{
+		throw_line("Failed to read frame from matte cache");
+	}
+
+	const int width = this->m_Size.width;
+
+	silhouette.create(this->m_Size.height, silhouette_words(width), CV_32SC1);
+
+	const unsigned short *run = &this->m_Runs[0];
+	const unsigned short *end = run + this->m_Runs.size();
+	for (int y = 0 ; y < silhouette.rows ; ++y)
+	{
+		unsigned int *bits = silhouette.ptr<unsigned int>(y);
+		memset(bits, 0, sizeof(unsigned int) * silhouette.cols);
+
+		bool value = false;
+		int x = 0;
+		while (x < width && run != end)
+		{
+			const int n = *run++;
+			if (x + n > width)
+			{
+				break;
+			}
+
+			if (value)
+			{
+				set_bits(bits, x, x + n);
+			}
+
+			x += n;
+			value = !value;
+		}
+
+		if (x != width)
+		{
+			throw_line("Corrupt frame in matte cache");
+		}
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+typedef struct MatteCacheEntry
+{
+	// Frame number in the camera video
+	int Frame;
+
+	// Byte offset and size of the encoded frame in the data file
+	unsigned long long int Offset;
+	unsigned int Size;
+} MatteCacheEntry;
+
+// Signature of the settings silhouettes are made with (FNV-1a), cached silhouettes made with other settings are stale
+class MatteSignature
+{
+private:
+	unsigned long long int m_Hash;
+public:
+	MatteSignature(void) : m_Hash(14695981039346656037ull) {}
+
+	void Add(const void *data, const size_t size)
+	{
+		const unsigned char *bytes = (const unsigned char*)data;
+		for (size_t i = 0 ; i < size ; ++i)
+		{
+			this->m_Hash = (this->m_Hash ^ bytes[i]) * 1099511628211ull;
+		}
+	}
+
+	template <typename T>
+	void Add(const T &value)
+	{
+		this->Add(&value, sizeof(T));
+	}
+
+	unsigned long long int Get(void) const { return this->m_Hash; }
+};
+
+// Run-length encoded sequence of silhouettes of a single camera. Every row is stored as 16 bit run lengths alternating
+// between background and foreground, starting with background. Frames are appended to a data file as they are computed,
+// in any order, and a frame index is written next to it (file + ".idx") such that later runs decode cached frames in stead
+// of decoding or keying them again. The index holds the signature of the settings the frames were made with, a cache made
+// with other settings is started over
+class MatteCache
+{
+private:
+	const std::string m_File;
+
+	const cv::Size m_Size;
+
+	// Signature of the settings known up front (mode, region of interest, mask, cleanup) and of the keyer parameters,
+	// which are only final once the first frame is keyed
+	const unsigned long long int m_Signature;
+	unsigned long long int m_KeySignature;
+
+	std::ofstream m_Writer;
+	std::ifstream m_Reader;
+
+	std::map<int, MatteCacheEntry> m_Index;
+
+	unsigned long long int m_DataSize;
+
+	bool m_IsDirty;
+
+	// Run lengths of the frame being encoded or decoded, reused every frame
+	std::vector<unsigned short> m_Runs;
+
+	bool Load(void);
+	void WriteIndex(void);
+
+	// Drop every cached frame and start the data file over
+	void Clear(void);
+public:
+	MatteCache(const std::string &file, const cv::Size &size, const unsigned long long int signature);
+	~MatteCache(void);
+
+	bool HasFrame(const int frame) const
+	{
+		return this->m_Index.find(frame) != this->m_Index.end();
+	}
+
+	// Encode a packed silhouette (see silhouette.cuh), frames already in the cache are left alone
+	void AddFrame(const int frame, const cv::Mat &silhouette);
+
+	// Decode a frame straight into a packed silhouette, returns false if the frame isn't cached
+	bool GetFrame(const int frame, cv::Mat &silhouette);
+
+	// Set the signature of the keyer parameters frames are keyed with from now on, frames keyed with other parameters are
+	// dropped
+	void SetKeySignature(const unsigned long long int signature);
+
+	// Write the frame index, also done on destruction
+	void Flush(void);
+
+	unsigned int GetNumFrames(void) const { return (unsigned int)this->m_Index.size(); }
+
+	unsigned long long int GetSize(void) const { return this->m_DataSize; }
+};
\ No newline at end of file
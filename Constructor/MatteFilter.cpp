@@ -0,0 +1,96 @@
+#include "Stdafx.h"
+
+#include "MatteFilter.h"
+#include "Exception.h"
+
+#include "morphology_host.h"
+#include "silhouette.cuh"
+
+MatteFilter::MatteFilter(const int radius, const bool fillHoles) : m_Radius(radius), m_FillHoles(fillHoles)
+{
+}
+
+MatteFilter::~MatteFilter(void)
+{
+}
+
+void MatteFilter::Unpack(const int width)
+{
+	this->m_Matte.create(this->m_Packed.rows, width, CV_8UC1);
+
+	#pragma omp parallel for
+	for (int y = 0 ; y < this->m_Packed.rows ; ++y)
+	{
+		const unsigned int *bits = this->m_Packed.ptr<unsigned int>(y);
+		uchar *dst = this->m_Matte.ptr<uchar>(y);
+
+		for (int x = 0 ; x < width ; ++x)
+		{
+			dst[x] = (bits[x >> SILHOUETTE_WORD_SHIFT] >> (x & SILHOUETTE_WORD_MASK)) & 1 ? 255 : 0;
+		}
+	}
+}
+
+void MatteFilter::Pack(void)
+{
+	const bool masked = !this->m_Mask.empty();
+
+	#pragma omp parallel for
+	for (int y = 0 ; y < this->m_Matte.rows ; ++y)
+	{
+		const uchar *src = this->m_Matte.ptr<uchar>(y);
+		unsigned int *bits = this->m_Packed.ptr<unsigned int>(y);
+
+		memset(bits, 0, sizeof(unsigned int) * this->m_Packed.cols);
+		for (int x = 0 ; x < this->m_Matte.cols ; ++x)
+		{
+			if (src[x] == 255)
+			{
+				bits[x >> SILHOUETTE_WORD_SHIFT] |= 1u << (x & SILHOUETTE_WORD_MASK);
+			}
+		}
+
+		// Closing and hole filling may grow into masked pixels
+		if (masked)
+		{
+			const unsigned int *mask = this->m_Mask.ptr<unsigned int>(y);
+			for (int w = 0 ; w < this->m_Packed.cols ; ++w)
+			{
+				bits[w] &= mask[w];
+			}
+		}
+	}
+}
+
+void MatteFilter::Apply(const cv::cuda::GpuMat &in, cv::cuda::GpuMat &out, const int width, const cv::cuda::GpuMat &mask)
+{
+	assert(in.type() == CV_32SC1 && in.cols == silhouette_words(width));
+
+	in.download(this->m_Packed);
+	if (mask.empty())
+	{
+		this->m_Mask.release();
+	}
+	else
+	{
+		mask.download(this->m_Mask);
+	}
+
+	this->Unpack(width);
+
+	if (this->m_Radius > 0)
+	{
+		open_host(this->m_Matte, this->m_Filtered, this->m_Radius);
+		close_host(this->m_Filtered, this->m_Matte, this->m_Radius);
+	}
+
+	if (this->m_FillHoles)
+	{
+		fill_holes_host(this->m_Matte, this->m_Filtered);
+		cv::swap(this->m_Matte, this->m_Filtered);
+	}
+
+	this->Pack();
+
+	out.upload(this->m_Packed);
+}
\ No newline at end of file
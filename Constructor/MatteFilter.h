@@ -0,0 +1,32 @@
+#pragma once
+
+// Largest radius of the opening and closing, silhouette specks are a few pixels. The radius can also be at most a
+// quarter of the smallest side of the frame, larger windows only erode the whole silhouette
+#define MATTE_FILTER_MAX_RADIUS 64
+
+// Cleans up packed silhouettes on the host: an opening removes foreground specks, a closing removes background specks
+// and optionally holes in the foreground are filled. Every stage costs the same regardless of the radius
+class MatteFilter
+{
+private:
+	int m_Radius;
+
+	bool m_FillHoles;
+
+	// Host buffers, reused every frame
+	cv::Mat m_Packed, m_Mask;
+	cv::Mat m_Matte, m_Filtered;
+
+	void Unpack(const int width);
+	void Pack(void);
+public:
+	MatteFilter(const int radius, const bool fillHoles);
+	~MatteFilter(void);
+
+	// Filter a packed silhouette of the given width, pixels cleared in the (packed) mask stay background
+	void Apply(const cv::cuda::GpuMat &in, cv::cuda::GpuMat &out, const int width, const cv::cuda::GpuMat &mask);
+
+	int GetRadius(void) const { return this->m_Radius; }
+
+	bool GetFillHoles(void) const { return this->m_FillHoles; }
+};
\ No newline at end of file
@@ -6,10 +6,91 @@
 
 Processor::Processor(Settings &settings, Reconstructor &r, const std::vector<Camera*> &cs) : m_Reconstructor(r), m_Cameras(cs), m_Settings(settings)
 {
-	// Initialize distance keyer, properties are adjustable through GUI
-	this->m_DistanceKeyer = new DistanceKeyer();
-	this->m_DistanceKeyer->SetTreshold(44);
-	this->m_DistanceKeyer->SetTolerance(7);
+	// Fixed key colors (in frame channel order) are keyed out next to the estimated one when keying through a table
+	std::vector<cv::Vec3f> keyColors;
+	if (settings.UseKeyTable)
+	{
+		cv::FileStorage fs;
+		fs.open(settings.DataPath + Common::KeyColorsFile, cv::FileStorage::READ);
+		if (fs.isOpened())
+		{
+			cv::Mat colors;
+			fs["KeyColors"] >> colors;
+			fs.release();
+
+			if (colors.cols != 3)
+			{
+				throw_line("Key colors should be given as a matrix with a row of 3 channels per color");
+			}
+
+			colors.convertTo(colors, CV_32F);
+			for (int c = 0 ; c < colors.rows ; ++c)
+			{
+				keyColors.push_back(cv::Vec3f(colors.at<float>(c, 0), colors.at<float>(c, 1), colors.at<float>(c, 2)));
+			}
+		}
+
+		std::cout << "Keying " << keyColors.size() + 1 << " key color(s) through a key table" << std::endl;
+	}
+
+	// Initialize a distance keyer per camera, properties are adjustable through GUI. Every camera sees the key under its own
+	// lighting, so each estimates its own key color
+	std::vector<Camera*>::const_iterator it;
+	for (it = this->m_Cameras.begin() ; it != this->m_Cameras.end() ; ++it)
+	{
+		DistanceKeyer *keyer = new DistanceKeyer();
+		keyer->SetTreshold(44);
+		keyer->SetTolerance(7);
+		keyer->SetRefreshInterval(settings.KeyRefreshInterval);
+		keyer->SetUseTable(settings.UseKeyTable);
+
+		std::vector<cv::Vec3f>::const_iterator c;
+		for (c = keyColors.begin() ; c != keyColors.end() ; ++c)
+		{
+			keyer->AddKeyColor(*c);
+		}
+
+		this->m_DistanceKeyers[(*it)->GetId()] = keyer;
+	}
+
+	// Carving applies the keyers itself
+	if (settings.UseFusedKeying)
+	{
+		r.SetFusedKeyers(this->m_DistanceKeyers);
+	}
+
+	// Learn the empty stage of every camera
+	if (settings.UseBackgroundModel)
+	{
+		for (it = this->m_Cameras.begin() ; it != this->m_Cameras.end() ; ++it)
+		{
+			BackgroundModel *model = new BackgroundModel();
+			this->m_BackgroundModels[(*it)->GetId()] = model;
+
+			const std::string videoFile = (*it)->GetCameraPath() + Common::BackgroundVideoFile;
+			if (!model->Learn(videoFile, (*it)->GetFrustumSize()))
+			{
+				throw_line("Unable to learn background model, expecting an empty stage video per camera");
+			}
+
+			std::cout << "Learned background of camera " << (*it)->GetId() + 1 << " from " << model->GetNumFrames() << " frames" << std::endl;
+		}
+	}
+
+	// Optional cleanup of the silhouettes, filters keep buffers so every camera has its own
+	for (it = this->m_Cameras.begin() ; it != this->m_Cameras.end() && (settings.CleanupRadius > 0 || settings.FillHoles) ; ++it)
+	{
+		const cv::Size &size = (*it)->GetFrustumSize();
+		if (4 * (int)settings.CleanupRadius > (size.width < size.height ? size.width : size.height))
+		{
+			throw_line("Cleanup radius is too large for the frames, it can be at most a quarter of the smallest side");
+		}
+
+		this->m_MatteFilters[(*it)->GetId()] = new MatteFilter(settings.CleanupRadius, settings.FillHoles);
+	}
+
+	this->m_UiCamera = 0;
+	this->m_IsUpdatingTrackbars = false;
 
 	// Start frame
 	this->m_NumFrames = m_Cameras.front()->GetFrames();
@@ -17,57 +98,159 @@ Processor::Processor(Settings &settings, Reconstructor &r, const std::vector<Cam
 	this->m_PreviousFrame = -1;
 
 	this->m_Compressor = new OctreeCompressor(settings.CompressedFileName);
+
+	this->m_Synchronizer = new FrameSynchronizer(this->m_Cameras, settings.CompressedFileName + Common::FrameLogFile);
+
+	// In deadline mode the controller picks the carving step, it starts coarse and refines while there's time left
+	this->m_Deadline = 0;
+	if (settings.TargetLatency > 0)
+	{
+		this->m_Deadline = new DeadlineController(settings.TargetLatency, r.GetStep());
+		this->m_Reconstructor.SetCarveStep(this->m_Deadline->GetStep());
+	}
 }
 
 Processor::~Processor()
 {
-	delete this->m_DistanceKeyer;
+	std::map<int, DistanceKeyer*>::iterator k;
+	for (k = this->m_DistanceKeyers.begin() ; k != this->m_DistanceKeyers.end() ; ++k)
+	{
+		delete k->second;
+	}
+
+	std::map<int, MatteFilter*>::iterator f;
+	for (f = this->m_MatteFilters.begin() ; f != this->m_MatteFilters.end() ; ++f)
+	{
+		delete f->second;
+	}
+
+	std::map<int, BackgroundModel*>::iterator it;
+	for (it = this->m_BackgroundModels.begin() ; it != this->m_BackgroundModels.end() ; ++it)
+	{
+		delete it->second;
+	}
 
 	delete this->m_Compressor;
+
+	delete this->m_Synchronizer;
+
+	delete this->m_Deadline;
 }
 
 void Processor::OnActualFramesTrackerbarChange(int v)
 {
-	this->m_DistanceKeyer->SetTolerance(cv::getTrackbarPos("Tolerance", "Actual frames"));
-	this->m_DistanceKeyer->SetTreshold(cv::getTrackbarPos("Treshold", "Actual frames"));
-	this->m_DistanceKeyer->SetGarbageTreshold(cv::getTrackbarPos("Garbage Treshold", "Actual frames"));
-	this->m_DistanceKeyer->SetR(cv::getTrackbarPos("R", "Actual frames"));
-	this->m_DistanceKeyer->SetG(cv::getTrackbarPos("G", "Actual frames"));
-	this->m_DistanceKeyer->SetB(cv::getTrackbarPos("B", "Actual frames"));
+	// Setting the trackbar positions calls back in here
+	if (this->m_IsUpdatingTrackbars)
+	{
+		return;
+	}
+
+	// The other trackbars edit the keyer of the selected camera, show its settings when the selection changes
+	const int camera = cv::getTrackbarPos("Camera", "Actual frames");
+	if (camera != this->m_UiCamera)
+	{
+		this->m_UiCamera = camera;
+		this->UpdateTrackbars();
+	}
+
+	DistanceKeyer *keyer = this->m_DistanceKeyers.at(this->m_Cameras[this->m_UiCamera]->GetId());
+	keyer->SetTolerance(cv::getTrackbarPos("Tolerance", "Actual frames"));
+	keyer->SetTreshold(cv::getTrackbarPos("Treshold", "Actual frames"));
+	keyer->SetGarbageTreshold(cv::getTrackbarPos("Garbage Treshold", "Actual frames"));
+	keyer->SetR(cv::getTrackbarPos("R", "Actual frames"));
+	keyer->SetG(cv::getTrackbarPos("G", "Actual frames"));
+	keyer->SetB(cv::getTrackbarPos("B", "Actual frames"));
 
 	this->DisplayFrameForegroundMatrix();
 }
 
+void Processor::UpdateTrackbars(void)
+{
+	DistanceKeyer *keyer = this->m_DistanceKeyers.at(this->m_Cameras[this->m_UiCamera]->GetId());
+
+	this->m_IsUpdatingTrackbars = true;
+
+	cv::setTrackbarPos("Camera", "Actual frames", this->m_UiCamera);
+	cv::setTrackbarPos("Tolerance", "Actual frames", keyer->GetTolerance());
+	cv::setTrackbarPos("Treshold", "Actual frames", keyer->GetTreshold());
+	cv::setTrackbarPos("Garbage Treshold", "Actual frames", keyer->GetGarbageTreshold());
+	cv::setTrackbarPos("R", "Actual frames", keyer->GetR());
+	cv::setTrackbarPos("G", "Actual frames", keyer->GetG());
+	cv::setTrackbarPos("B", "Actual frames", keyer->GetB());
+
+	this->m_IsUpdatingTrackbars = false;
+}
+
 bool Processor::ProcessFrame(void)
 {
 	static bool first = true;
 
+	if (this->m_CurrentFrame == this->m_PreviousFrame)
+	{
+		return false;
+	}
+
+	std::map<int, DistanceKeyer*>::iterator k;
+	for (k = this->m_DistanceKeyers.begin() ; k != this->m_DistanceKeyers.end() ; ++k)
+	{
+		k->second->NextFrame();
+	}
+
+	// Frames ahead are read as they come, frames in between are skipped, only going back seeks. Either way the frames are
+	// matched on the time they were captured
+	const int skip = this->m_CurrentFrame - this->m_PreviousFrame - 1;
+	const bool read = skip >= 0 ? this->m_Synchronizer->Next(skip) : this->m_Synchronizer->Seek(this->m_CurrentFrame);
+	if (!read)
+	{
+		return false;
+	}
+
+	this->m_Synchronizer->LogBundle(this->m_CurrentFrame);
+
+	bool cached = true;
 	for (size_t c = 0; c < this->m_Cameras.size(); ++c)
 	{
-		if (this->m_CurrentFrame == this->m_PreviousFrame + 1)
-		{
-			this->m_Cameras[c]->SetVideoFrame(100);
+		cached &= this->m_Cameras[c]->IsSilhouetteCached();
+	}
 
-			this->m_Cameras[c]->NextVideoFrame();
-		}
-		else if (this->m_CurrentFrame != this->m_PreviousFrame)
+	// Every camera has its own keyer, key them all at once. Cached silhouettes were approved before, don't segment them
+	// again. Exceptions can't leave the parallel region, the first one is thrown again afterwards
+	std::string error;
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int c = 0; c < (int)this->m_Cameras.size(); ++c)
+	{
+		try
 		{
-			this->m_Cameras[c]->GetVideoFrame(this->m_CurrentFrame);
+			if (!this->m_Cameras[c]->IsSilhouetteCached())
+			{
+				this->ProcessForeground(this->m_Cameras[c]);
+			}
 		}
-		else
+		catch (const std::exception &e)
 		{
-			return false;
+			#pragma omp critical(process_foreground_error)
+			{
+				if (error.empty())
+				{
+					error = e.what();
+				}
+			}
 		}
+	}
 
-		assert(this->m_Cameras[c] != nullptr);
-		this->ProcessForeground(this->m_Cameras[c]);
+	if (!error.empty())
+	{
+		throw_line(error);
 	}
 
-	// If this is the first frame we want to adjust the keyer settings if we're using the keyer
-	if (first && !(this->m_Settings.UseMatteStill || this->m_Settings.UseMatteVideo))
+	// If this is the first frame we want to adjust the keyer settings if we're using the keyer, unless they're found
+	// automatically or no one is watching
+	if (first && !cached && !(this->m_Settings.UseMatteStill || this->m_Settings.UseMatteVideo || this->m_Settings.UseBackgroundModel || this->m_Settings.UseAutoTreshold || this->m_Settings.Headless))
 	{
 		cv::namedWindow("Actual frames");
 
+		cv::createTrackbar("Camera", "Actual frames", 0, (int)this->m_Cameras.size() - 1, Processor::OnActualFramesTrackerbarChangeWrapper, this);
 		cv::createTrackbar("Tolerance", "Actual frames", 0, 255, Processor::OnActualFramesTrackerbarChangeWrapper, this);
 		cv::createTrackbar("Treshold", "Actual frames", 0, 255, Processor::OnActualFramesTrackerbarChangeWrapper, this);
 		cv::createTrackbar("Garbage Treshold", "Actual frames", 0, 255, Processor::OnActualFramesTrackerbarChangeWrapper, this);
@@ -75,12 +258,7 @@ bool Processor::ProcessFrame(void)
 		cv::createTrackbar("G", "Actual frames", 0, 255, Processor::OnActualFramesTrackerbarChangeWrapper, this);
 		cv::createTrackbar("B", "Actual frames", 0, 255, Processor::OnActualFramesTrackerbarChangeWrapper, this);
 
-		cv::setTrackbarPos("Tolerance", "Actual frames", this->m_DistanceKeyer->GetTolerance());
-		cv::setTrackbarPos("Treshold", "Actual frames", this->m_DistanceKeyer->GetTreshold());
-		cv::setTrackbarPos("Garbage Treshold", "Actual frames", this->m_DistanceKeyer->GetGarbageTreshold());
-		cv::setTrackbarPos("R", "Actual frames", this->m_DistanceKeyer->GetR());
-		cv::setTrackbarPos("G", "Actual frames", this->m_DistanceKeyer->GetG());
-		cv::setTrackbarPos("B", "Actual frames", this->m_DistanceKeyer->GetB());
+		this->UpdateTrackbars();
 
 		this->DisplayFrameForegroundMatrix();
 		cv::waitKey(0);
@@ -88,9 +266,50 @@ bool Processor::ProcessFrame(void)
 		first = false;
 	}
 
+	// Silhouettes are cached once the keyer settings are final, cached silhouettes keyed with other parameters are dropped
+	for (size_t c = 0; c < this->m_Cameras.size(); ++c)
+	{
+		Camera *camera = this->m_Cameras[c];
+		if (this->m_Settings.UseMatteCache && !camera->IsSilhouetteCached() && !(this->m_Settings.UseMatteVideo || this->m_Settings.UseBackgroundModel))
+		{
+			camera->SetKeySignature(this->ComputeKeySignature(this->m_DistanceKeyers.at(camera->GetId())));
+		}
+
+		camera->CacheSilhouette();
+	}
+
+	this->m_PreviousFrame = this->m_CurrentFrame;
+
 	return true;
 }
 
+unsigned long long int Processor::ComputeKeySignature(DistanceKeyer *keyer) const
+{
+	MatteSignature signature;
+
+	// Key colors estimated again every so often and tresholds found automatically follow from the frames, the settings
+	// that say so are in the signature of the camera
+	if (keyer->GetRefreshInterval() == 0)
+	{
+		signature.Add(keyer->GetKeyColor());
+	}
+
+	if (!this->m_Settings.UseAutoTreshold)
+	{
+		signature.Add(keyer->GetTreshold());
+		signature.Add(keyer->GetTolerance());
+	}
+
+	const std::vector<cv::Vec3f> &colors = keyer->GetExtraKeyColors();
+	std::vector<cv::Vec3f>::const_iterator it;
+	for (it = colors.begin() ; it != colors.end() ; ++it)
+	{
+		signature.Add(*it);
+	}
+
+	return signature.Get();
+}
+
 void Processor::DisplayFrameForegroundMatrix(void)
 {
 	// Display frames
@@ -104,6 +323,12 @@ void Processor::DisplayFrameForegroundMatrix(void)
 		this->ProcessForeground(*it);
 
 		cv::cuda::GpuMat mat = (*it)->GetFrame(), foreground = (*it)->GetForegroundImage();
+
+		// Fused keying and the packed silhouette of the keyer leave no 8 bit matte, key one just for display
+		if (foreground.empty())
+		{
+			this->m_DistanceKeyers.at((*it)->GetId())->ComputeMatte(mat, foreground);
+		}
 		cv::Mat hostMat, hostForeground;
 		mat.download(hostMat);
 		foreground.download(hostForeground);
@@ -125,6 +350,9 @@ void Processor::DisplayFrameForegroundMatrix(void)
 
 void Processor::ProcessForeground(Camera *camera)
 {
+	// Keying runs on the stream of this thread, after the frame is uploaded
+	camera->WaitForUpload();
+
 	if (this->m_Settings.UseMatteStill)
 	{
 		camera->LoadForegroundFromMatteStill();
@@ -133,41 +361,293 @@ void Processor::ProcessForeground(Camera *camera)
 	{
 		camera->LoadForegroundFromMatteVideo();
 	}
-	else
+	else if (this->m_Settings.UseBackgroundModel)
 	{
 		assert(!camera->GetFrame().empty());
 
-		cv::cuda::GpuMat frame = camera->GetFrame();
+		camera->SetForegroundImage(this->m_BackgroundModels.at(camera->GetId())->ComputeMatte(camera->GetFrame()));
+	}
+	else
+	{
+		assert(camera->HasFrame());
+
+		DistanceKeyer *keyer = this->m_DistanceKeyers.at(camera->GetId());
+		const cv::Rect &roi = camera->GetRoi();
 
-		// Check if we should determine the key color
-		if (!this->m_DistanceKeyer->HasKeyColor())
+		// Check if we should determine the key color, rigging and walls outside the region of interest don't count. The
+		// treshold depends on the key color, it's found again along with it. Frames decoded as YUV are only converted where
+		// they're sampled
+		if (!keyer->HasKeyColor())
 		{
-			this->m_DistanceKeyer->FindKeyColor(frame);
+			cv::Mat samples;
+			if (camera->HasYuvFrame())
+			{
+				DistanceKeyer::SampleYuvFrame(camera->GetYuvFrame(), roi, samples);
+			}
+			else
+			{
+				DistanceKeyer::SampleFrame(camera->GetFrame(), roi, samples);
+			}
+
+			keyer->FindKeyColor(samples);
+
+			if (this->m_Settings.UseAutoTreshold)
+			{
+				const int treshold = keyer->FindTreshold(samples);
+
+				// Hard cut at the treshold, the matte has no ramp
+				keyer->SetTreshold(treshold);
+				keyer->SetTolerance(treshold + 1);
+
+				std::cout << "Key treshold of camera " << camera->GetId() + 1 << ": " << treshold << std::endl;
+			}
 		}
 
-		cv::cuda::GpuMat gpuMatte;
-		this->m_DistanceKeyer->ComputeMatte(frame, gpuMatte);
+		// Carving keys the frame, no matte is materialized
+		if (this->m_Settings.UseFusedKeying)
+		{
+			camera->SetForegroundImage(cv::cuda::GpuMat());
+			return;
+		}
+
+		if (this->m_Settings.UseHostKeyer)
+		{
+			// Only the region of interest is keyed, the garbage mask is applied when packing. The frame is still in its staging
+			// buffer unless it was converted on the device, then it's downloaded
+			const cv::cuda::GpuMat &frame = camera->GetFrame();
+			cv::Mat hostFrame, hostMatte(frame.size(), CV_8UC1, cv::Scalar(0));
+			if (camera->GetHostFrame(hostFrame))
+			{
+				hostFrame = hostFrame(roi);
+			}
+			else
+			{
+				frame(roi).download(hostFrame);
+			}
+
+			cv::Mat hostRoiMatte = hostMatte(roi);
+			keyer->ComputeMatte(hostFrame, hostRoiMatte);
+
+			cv::cuda::GpuMat gpuMatte;
+			gpuMatte.upload(hostMatte);
+
+			camera->SetForegroundImage(gpuMatte);
+		}
+		else if (camera->HasYuvFrame())
+		{
+			// Keyed on the decoded planes, the frame is never converted as a whole
+			cv::cuda::GpuMat silhouette;
+			keyer->ComputeSilhouetteYuv(camera->GetYuvFrame(), silhouette, camera->GetMask(), roi);
+
+			camera->SetSilhouette(silhouette);
+		}
+		else
+		{
+			cv::cuda::GpuMat silhouette;
+			keyer->ComputeSilhouette(camera->GetFrame(), silhouette, camera->GetMask(), roi);
+
+			camera->SetSilhouette(silhouette);
+		}
+	}
+
+	// Remove specks and holes before carving
+	std::map<int, MatteFilter*>::const_iterator filter = this->m_MatteFilters.find(camera->GetId());
+	if (filter != this->m_MatteFilters.end() && !camera->GetSilhouette().empty())
+	{
+		cv::cuda::GpuMat silhouette;
+		filter->second->Apply(camera->GetSilhouette(), silhouette, camera->GetFrustumSize().width, camera->GetMask());
+
+		camera->SetSilhouette(silhouette);
+	}
+}
+
+void Processor::SetVolumeTransform(Octree *octree)
+{
+	// Voxels are in volume coordinates, store how the volume maps to the world
+	const float *v = this->m_Reconstructor.GetVolume();
+	octree->SetVolumeTransform(glm::vec3(v[0], v[3], v[6]), glm::vec3(v[1], v[4], v[7]), glm::vec3(v[2], v[5], v[8]), glm::vec3(v[9], v[10], v[11]));
+}
+
+void Processor::ProcessTiles(TileStore *tileStore)
+{
+	std::cout << "Streaming " << tileStore->GetNumTiles() << " tiles, " << tileStore->GetNumVoxels() << " visible voxels, " << tileStore->GetSize() / 1000000 << "MB on disk" << std::endl;
+
+	// Every tile becomes a separate octree record, only the tile being processed is mapped into memory
+	for (unsigned int t = 0 ; t < tileStore->GetNumTiles() ; ++t)
+	{
+		const TileHeader &tile = tileStore->GetTile(t);
+		if (tile.NumVoxels == 0)
+		{
+			continue;
+		}
+
+		VisibleVoxel *voxels = const_cast<VisibleVoxel*>(tileStore->MapTile(t));
+
+		// Voxel coordinates are relative to the tile origin
+		glm::vec3 max = {0.0f, 0.0f, 0.0f};
+		for (unsigned long long int i = 0 ; i < tile.NumVoxels ; ++i)
+		{
+			max = glm::max(max, glm::vec3(voxels[i].X, voxels[i].Y, voxels[i].Z));
+		}
+
+		Octree *octree = new Octree(glm::vec3(0, 0, 0), max);
+		octree->SetOrigin(glm::vec3(tile.OriginX, tile.OriginY, tile.OriginZ));
+		this->SetVolumeTransform(octree);
+		octree->SetVoxels(voxels);
+		octree->SetNumVoxels((unsigned int)tile.NumVoxels);
+		octree->Build();
+
+		std::cout << "Tile " << t << " at (" << tile.OriginX << ", " << tile.OriginY << ", " << tile.OriginZ << "): " << tile.NumVoxels << " voxels, " << octree->GetNumNodes() << " nodes" << std::endl;
+
+		this->m_Compressor->Compress(octree, this->m_CurrentFrame);
+
+		delete octree;
+	}
+
+	tileStore->Unmap();
+}
+
+void Processor::AdaptToDeadline(void)
+{
+	if (this->m_Deadline == 0)
+	{
+		return;
+	}
+
+	this->m_Deadline->EndStage(DeadlineController::STAGE_OUTPUT);
+
+	const int step = this->m_Reconstructor.GetCarveStep();
+	const int *region = this->m_Reconstructor.GetRegion();
+	const bool met = this->m_Deadline->EndFrame(this->m_Reconstructor.GetRegionVoxels());
+
+	std::cout << "Frame " << this->m_CurrentFrame << ": step " << step << ", region (" << region[0] << ", " << region[2] << ", " << region[4] << ") -> (" << region[1] << ", " << region[3] << ", " << region[5] << "), ";
+	std::cout << this->m_Deadline->GetFrameTime() << " ms (input " << this->m_Deadline->GetStageTime(DeadlineController::STAGE_INPUT) << ", carve " << this->m_Deadline->GetStageTime(DeadlineController::STAGE_CARVE) << ", output " << this->m_Deadline->GetStageTime(DeadlineController::STAGE_OUTPUT) << ")";
+	std::cout << (met ? "" : " MISSED") << std::endl;
+
+	// Next frame we only carve around the hull of this frame, if the hull touches the border of the region it may have been
+	// cut off so we go back to the full voxel space
+	int hullMin[3], hullMax[3], min[3], max[3];
+	const bool clipped = !this->m_Reconstructor.GetHullBounds(hullMin, hullMax) || !DeadlineController::NextRegion(hullMin, hullMax, region, step, min, max);
+
+	if (clipped)
+	{
+		this->m_Reconstructor.ResetRegion();
+	}
+	else
+	{
+		this->m_Reconstructor.SetRegion(min, max);
+	}
+
+	// Predict with the size of the next region
+	const double regionVoxels = double(region[1] - region[0]) * (region[3] - region[2]) * (region[5] - region[4]);
+	this->m_Reconstructor.SetCarveStep(this->m_Deadline->NextStep(regionVoxels));
 
-		camera->SetForegroundImage(gpuMatte);
+	this->m_Deadline->BeginFrame();
+}
+
+void Processor::ReportProgress(const int processed, const int total, const std::chrono::high_resolution_clock::time_point &start) const
+{
+	const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+	const double rate = elapsed.count() > 0 ? processed / elapsed.count() : 0;
+
+	std::cout << "Frame " << this->m_CurrentFrame << " done (" << processed << " of " << total << ", " << 100 * processed / total << "%), ";
+	std::cout << rate << " frames per second";
+	if (rate > 0)
+	{
+		std::cout << ", " << int((total - processed) / rate) << " seconds left";
 	}
+	std::cout << std::endl;
 }
 
 void Processor::Process(void)
 {
-	for (int n = 0 ; n < 1 && this->ProcessFrame() ; ++n)
+	// Frames past the end of the shortest video are never reached, the synchronizer stops there
+	const int first = this->m_Settings.FirstFrame;
+	const int last = this->m_Settings.LastFrame < 0 || this->m_Settings.LastFrame >= this->m_NumFrames ? (int)this->m_NumFrames - 1 : this->m_Settings.LastFrame;
+	const int stride = this->m_Settings.FrameStride;
+	const int total = first <= last ? (last - first) / stride + 1 : 0;
+
+	std::cout << "Processing " << total << " frames, " << first << " to " << last << " every " << stride << std::endl;
+
+	const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	int processed = 0;
+
+	if (this->m_Deadline != 0)
+	{
+		this->m_Deadline->BeginFrame();
+	}
+
+	// Every frame is appended to the output as a record of its own
+	for (this->m_CurrentFrame = first ; this->m_CurrentFrame <= last && this->ProcessFrame() ; this->m_CurrentFrame += stride)
 	{
+		if (this->m_Deadline != 0)
+		{
+			this->m_Deadline->EndStage(DeadlineController::STAGE_INPUT);
+		}
+
+		// Carving emits the octree directly, there's no voxel list to build it from
+		if (this->m_Settings.UseHierarchicalCarving)
+		{
+			std::cout << "Carving octree..." << std::endl;
+
+			Octree *octree = this->m_Reconstructor.CarveOctree();
+			this->SetVolumeTransform(octree);
+
+			if (this->m_Deadline != 0)
+			{
+				this->m_Deadline->EndStage(DeadlineController::STAGE_CARVE);
+			}
+
+			std::cout << "Number of nodes: " << octree->GetNumNodes() << ", of which full: " << octree->GetNumFullNodes() << std::endl;
+			std::cout << "Memory usage: " << float(octree->GetNumNodes() * sizeof(OctreeNode)) / 1000000 << "MB" << std::endl;
+
+			std::cout << "Compressing..." << std::endl;
+			this->m_Compressor->Compress(octree, this->m_CurrentFrame);
+
+			delete octree;
+
+			this->AdaptToDeadline();
+
+			this->ReportProgress(++processed, total, start);
+			continue;
+		}
+
 		std::cout << "Computing visible voxels..." << std::endl;
 
 		// Update the visible voxels
 		this->m_Reconstructor.Update();
 
+		if (this->m_Deadline != 0)
+		{
+			this->m_Deadline->EndStage(DeadlineController::STAGE_CARVE);
+		}
+
 		std::cout << "Computed visible voxels" << std::endl;
 
+		// Out-of-core, the carved tiles live on disk
+		TileStore *tileStore = this->m_Reconstructor.GetTileStore();
+		if (tileStore != 0)
+		{
+			this->ProcessTiles(tileStore);
+			this->AdaptToDeadline();
+
+			this->ReportProgress(++processed, total, start);
+			continue;
+		}
+
 		const unsigned int numVisibleVoxels = this->m_Reconstructor.GetNumVisibleVoxels();
 		VisibleVoxel* visibleVoxels = this->m_Reconstructor.GetVisibleVoxels();
+		BrickMap *brickMap = this->m_Reconstructor.GetBrickMap();
 
 		std::cout << "Number of visible voxels: " << numVisibleVoxels << std::endl;
-		std::cout << "Memory usage: " << (numVisibleVoxels * sizeof(VisibleVoxel)) / 1000000 << "MB" << std::endl;
+		if (brickMap != 0)
+		{
+			std::cout << "Memory usage: " << brickMap->GetMemoryUsage() / 1000000 << "MB in " << brickMap->GetNumBricks() << " bricks" << std::endl;
+		}
+		else
+		{
+			std::cout << "Memory usage: " << (numVisibleVoxels * sizeof(VisibleVoxel)) / 1000000 << "MB" << std::endl;
+		}
 
 		std::cout << "Determining boundaries..." << std::endl;
 
@@ -175,13 +655,19 @@ void Processor::Process(void)
 		glm::vec3 min = {0.0f, 0.0f, 0.0f};
 		glm::vec3 max = {0.0f, 0.0f, 0.0f};
 		glm::vec3 cellSize = {1.0f, 1.0f, 1.0f};
-		for (int i = 0 ; i < numVisibleVoxels ; ++i)
+		int brickMin[3], brickMax[3];
+		if (brickMap != 0 && brickMap->GetBounds(brickMin, brickMax))
+		{
+			min = glm::vec3(brickMin[0], brickMin[1], brickMin[2]);
+			max = glm::vec3(brickMax[0], brickMax[1], brickMax[2]);
+		}
+		for (int i = 0 ; brickMap == 0 && i < numVisibleVoxels ; ++i)
 		{
 			VisibleVoxel &v = visibleVoxels[i];
 
 			min[0] = v.X < min[0] ? v.X : min[0]; max[0] = v.X > max[0] ? v.X : max[0];
-			min[1] = v.X < min[1] ? v.X : min[1]; max[1] = v.X > max[1] ? v.X : max[1];
-			min[2] = v.X < min[2] ? v.X : min[2]; max[2] = v.X > max[2] ? v.X : max[2];
+			min[1] = v.Y < min[1] ? v.Y : min[1]; max[1] = v.Y > max[1] ? v.Y : max[1];
+			min[2] = v.Z < min[2] ? v.Z : min[2]; max[2] = v.Z > max[2] ? v.Z : max[2];
 		}
 
 		std::cout << "Boundaries are: (" << min[0] << ", " << min[1] << ", " << min[2] << ") -> (" << max[0] << ", " << max[1] << ", " << max[2] << ")" << std::endl;
@@ -189,28 +675,49 @@ void Processor::Process(void)
 		std::cout << "Adding voxels to octree..." << std::endl;
 
 		Octree *octree = new Octree(glm::vec3(0, 0, 0), max);
-		octree->SetVoxels(visibleVoxels);
-		octree->SetNumVoxels(numVisibleVoxels);
+		this->SetVolumeTransform(octree);
 
 		std::cout << "Building octree..." << std::endl;
 
-		std::chrono::system_clock::time_point start = std::chrono::high_resolution_clock::now();
-		octree->Build();
-		std::chrono::duration<float> b = std::chrono::system_clock::now().time_since_epoch();
+		std::chrono::system_clock::time_point buildStart = std::chrono::high_resolution_clock::now();
+		if (brickMap != 0)
+		{
+			// Read the voxels straight from the bricks, the interior of the hull is dropped on request only
+			if (this->m_Settings.BrickSurfaceOnly)
+			{
+				std::cout << "Writing the hull surface only, interior voxels are dropped" << std::endl;
+			}
+			octree->Build(*brickMap, this->m_Settings.BrickSurfaceOnly);
+		}
+		else
+		{
+			octree->SetVoxels(visibleVoxels);
+			octree->SetNumVoxels(numVisibleVoxels);
+			octree->Build();
+		}
 		std::chrono::system_clock::time_point end = std::chrono::high_resolution_clock::now();
-		std::chrono::duration<double> diff = end - start;
+		std::chrono::duration<double> diff = end - buildStart;
 		std::cout << "Spent " << diff.count() * 1000 << " milliseconds" << std::endl;
 
 		std::cout << "Number of nodes: " << octree->GetNumNodes() << std::endl;
 		std::cout << "Memory usage: " << float(octree->GetNumNodes() * sizeof(OctreeNode)) / 1000000 << "MB" << std::endl;
 
 		std::cout << "Compressing..." << std::endl;
-		this->m_Compressor->Compress(octree);
+		this->m_Compressor->Compress(octree, this->m_CurrentFrame);
 
 		delete octree;
+
+		this->AdaptToDeadline();
 		
-		std::cout << "Done, next frame!" << std::endl;
+		this->ReportProgress(++processed, total, start);
 	}
 
-	std::cout << "Done processing!" << std::endl;
+	const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	std::cout << "Done processing! " << processed << " frames in " << elapsed.count() << " seconds";
+	if (elapsed.count() > 0)
+	{
+		std::cout << " (" << processed / elapsed.count() << " frames per second)";
+	}
+	std::cout << ", " << this->m_Compressor->GetNumRecords() << " records written, " << this->m_Synchronizer->GetNumSkipped() << " frames skipped to stay in sync" << std::endl;
 }
\ No newline at end of file
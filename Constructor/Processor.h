@@ -4,8 +4,12 @@
 #include "Reconstructor.h"
 #include "Camera.h"
 #include "DistanceKeyer.h"
+#include "BackgroundModel.h"
+#include "MatteFilter.h"
+#include "DeadlineController.h"
 #include "Settings.h"
 #include "OctreeCompressor.h"
+#include "FrameSynchronizer.h"
 
 class Processor
 {
@@ -17,7 +21,23 @@ class Processor
 
 	const std::vector<Camera*> &m_Cameras;
 
-	DistanceKeyer *m_DistanceKeyer;
+	// Reads the frames of all cameras that were captured at the same instant
+	FrameSynchronizer *m_Synchronizer;
+
+	// Keyers per camera id, every camera has its own key color and tresholds
+	std::map<int, DistanceKeyer*> m_DistanceKeyers;
+
+	// Background models per camera id, in stead of the keyer
+	std::map<int, BackgroundModel*> m_BackgroundModels;
+
+	// Silhouette cleanup per camera id, empty when silhouettes aren't cleaned up
+	std::map<int, MatteFilter*> m_MatteFilters;
+
+	// Index of the camera whose keyer the GUI edits
+	int m_UiCamera;
+	bool m_IsUpdatingTrackbars;
+
+	DeadlineController *m_Deadline;
 
 	long m_NumFrames;
 	int m_CurrentFrame;
@@ -31,7 +51,21 @@ class Processor
 
 	void OnActualFramesTrackerbarChange(int v);
 
+	void UpdateTrackbars(void);
+
 	void DisplayFrameForegroundMatrix(void);
+
+	// Signature of the keyer parameters silhouettes are keyed with, for the matte cache
+	unsigned long long int ComputeKeySignature(DistanceKeyer *keyer) const;
+
+	void ProcessTiles(TileStore *tileStore);
+
+	void SetVolumeTransform(Octree *octree);
+
+	void AdaptToDeadline(void);
+
+	void ReportProgress(const int processed, const int total, const std::chrono::high_resolution_clock::time_point &start) const;
+
 public:
 	Processor(Settings &settings, Reconstructor &, const std::vector<Camera*> &);
 	virtual ~Processor(void);
@@ -0,0 +1,114 @@
+#include "Stdafx.h"
+
+#include "RawFrameSource.h"
+#include "Exception.h"
+
+RawFrameSource::RawFrameSource(const std::string &file)
+{
+	cv::FileStorage fs;
+	fs.open(file + ".xml", cv::FileStorage::READ);
+	if (!fs.isOpened())
+	{
+		throw_line("Unable to locate: " + file + ".xml");
+	}
+
+	std::string format;
+	int headerSize = 0, frameHeaderSize = 0, rowStride = 0;
+	fs["Width"] >> this->m_Size.width;
+	fs["Height"] >> this->m_Size.height;
+	fs["Format"] >> format;
+	if (!fs["HeaderSize"].empty())
+	{
+		fs["HeaderSize"] >> headerSize;
+	}
+	if (!fs["FrameHeaderSize"].empty())
+	{
+		fs["FrameHeaderSize"] >> frameHeaderSize;
+	}
+	if (!fs["RowStride"].empty())
+	{
+		fs["RowStride"] >> rowStride;
+	}
+
+	this->m_FrameRate = 0;
+	if (!fs["FrameRate"].empty())
+	{
+		fs["FrameRate"] >> this->m_FrameRate;
+	}
+	fs.release();
+
+	int bytesPerPixel = 1;
+	if (format == "RGGB")
+	{
+		this->m_Format = FRAME_FORMAT_BAYER_RGGB;
+	}
+	else if (format == "BGGR")
+	{
+		this->m_Format = FRAME_FORMAT_BAYER_BGGR;
+	}
+	else if (format == "GRBG")
+	{
+		this->m_Format = FRAME_FORMAT_BAYER_GRBG;
+	}
+	else if (format == "GBRG")
+	{
+		this->m_Format = FRAME_FORMAT_BAYER_GBRG;
+	}
+	else if (format == "UYVY")
+	{
+		this->m_Format = FRAME_FORMAT_UYVY;
+		bytesPerPixel = 2;
+	}
+	else
+	{
+		throw_line("Unknown raw frame format: " + format);
+	}
+
+	// Bayer mosaics and UYVY pairs come in blocks of 2 pixels
+	if (this->m_Size.width <= 0 || this->m_Size.height <= 0 || (this->m_Size.width & 1) != 0 || (this->m_Format != FRAME_FORMAT_UYVY && (this->m_Size.height & 1) != 0))
+	{
+		throw_line("Raw frames should have an even size");
+	}
+
+	this->m_HeaderSize = headerSize;
+	this->m_FrameHeaderSize = frameHeaderSize;
+	this->m_RowStride = rowStride > 0 ? rowStride : this->m_Size.width * bytesPerPixel;
+	this->m_FrameStride = this->m_FrameHeaderSize + this->m_RowStride * this->m_Size.height;
+
+	if (this->m_RowStride < (size_t)(this->m_Size.width * bytesPerPixel))
+	{
+		throw_line("Raw frame rows are longer than their stride");
+	}
+
+	this->m_File = boost::interprocess::file_mapping(file.c_str(), boost::interprocess::read_only);
+	this->m_Region = boost::interprocess::mapped_region(this->m_File, boost::interprocess::read_only);
+
+	const size_t size = this->m_Region.get_size();
+	this->m_NumFrames = size > this->m_HeaderSize ? (long)((size - this->m_HeaderSize) / this->m_FrameStride) : 0;
+	if (this->m_NumFrames == 0)
+	{
+		throw_line("No raw frames in: " + file);
+	}
+
+	this->m_Position = 0;
+}
+
+RawFrameSource::~RawFrameSource(void)
+{
+}
+
+bool RawFrameSource::Read(cv::Mat &frame)
+{
+	if (this->m_Position < 0 || this->m_Position >= this->m_NumFrames)
+	{
+		return false;
+	}
+
+	uchar *data = (uchar*)this->m_Region.get_address() + this->m_HeaderSize + this->m_Position * this->m_FrameStride + this->m_FrameHeaderSize;
+
+	// The mapping is read only, the header only points into it
+	frame = cv::Mat(this->m_Size, this->m_Format == FRAME_FORMAT_UYVY ? CV_8UC2 : CV_8UC1, data, this->m_RowStride);
+	++this->m_Position;
+
+	return true;
+}
\ No newline at end of file
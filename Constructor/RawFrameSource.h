@@ -0,0 +1,66 @@
+#pragma once
+
+#include "FrameSource.h"
+
+// Uncompressed frames as dumped by the capture cards, memory mapped. The layout is described next to the frames
+// (file + ".xml"): Width, Height and Format (RGGB, BGGR, GRBG or GBRG for Bayer mosaics, UYVY), optionally the HeaderSize
+// in bytes before the first frame, the FrameHeaderSize in bytes before every frame, the RowStride in bytes and the
+// FrameRate the frames were captured at, which times them from the first frame on. Frames are views into the mapping,
+// nothing is copied or decoded until they're uploaded, and they stay valid as long as the source
+class RawFrameSource : public FrameSource
+{
+private:
+	boost::interprocess::file_mapping m_File;
+	boost::interprocess::mapped_region m_Region;
+
+	cv::Size m_Size;
+	FrameFormat m_Format;
+
+	size_t m_HeaderSize, m_FrameHeaderSize, m_RowStride, m_FrameStride;
+
+	long m_NumFrames;
+	double m_FrameRate;
+
+	int m_Position;
+public:
+	RawFrameSource(const std::string &file);
+	~RawFrameSource(void);
+
+	const cv::Size &GetSize(void) const
+	{
+		return this->m_Size;
+	}
+
+	long GetNumFrames(void) const
+	{
+		return this->m_NumFrames;
+	}
+
+	FrameFormat GetFormat(void) const
+	{
+		return this->m_Format;
+	}
+
+	double GetFrameRate(void) const
+	{
+		return this->m_FrameRate;
+	}
+
+	int GetPosition(void) const
+	{
+		return this->m_Position;
+	}
+
+	void Seek(const int frame)
+	{
+		this->m_Position = frame;
+	}
+
+	bool Read(cv::Mat &frame);
+
+	// Frame read last at the nominal frame rate
+	double GetTimestamp(void) const
+	{
+		return this->m_FrameRate > 0 && this->m_Position > 0 ? (this->m_Position - 1) / this->m_FrameRate : -1;
+	}
+};
\ No newline at end of file
@@ -2,11 +2,12 @@
 
 #include "Common.h"
 #include "Reconstructor.h"
+#include "Exception.h"
 
 #include "reconstructor.cuh"
 #include "VisibleVoxel.h"
 
-Reconstructor::Reconstructor(const std::vector<Camera*> &cs) : m_Cameras(cs)
+Reconstructor::Reconstructor(Settings &settings, const std::vector<Camera*> &cs) : m_Settings(settings), m_Cameras(cs)
 {
 	// Define the size of the frustum
 	for (size_t c = 0; c < this->m_Cameras.size(); ++c)
@@ -24,8 +25,25 @@ Reconstructor::Reconstructor(const std::vector<Camera*> &cs) : m_Cameras(cs)
 	this->m_VisibleVoxels = 0;
 	this->m_NumVisibleVoxels = 0;
 
+	this->m_BrickMap = 0;
+	this->m_TileStore = 0;
+
+	this->m_HierarchicalCarver = 0;
+
 	this->m_Step = 1;
-	this->m_Size = 128;
+	this->m_Size = this->m_Settings.VolumeSize;
+
+	this->m_CarveStep = this->m_Step;
+	this->m_VoxelSpaceChanged = false;
+
+	// Identity transformation, the volume is axis aligned with the checkerboard
+	for (int v = 0 ; v < 12 ; ++v)
+	{
+		this->m_Volume[v] = (v == 0 || v == 4 || v == 8) ? 1.0f : 0.0f;
+	}
+
+	// Out-of-core reconstruction carves every division as a separate tile
+	this->m_Divisions = this->m_Settings.TileDivisions > 0 ? this->m_Settings.TileDivisions : DEFAULT_DIVISIONS;
 }
 
 Reconstructor::~Reconstructor()
@@ -43,35 +61,67 @@ Reconstructor::~Reconstructor()
 		this->m_NumVisibleVoxels = 0;
 	}
 
+	delete this->m_BrickMap;
+	delete this->m_TileStore;
+
+	delete this->m_HierarchicalCarver;
+
 	destroy_voxels();
 }
 
 bool Reconstructor::Initialize(void)
 {
-	// Define the bounds of the voxel space
+	// Define the bounds of the voxel space, in volume coordinates
 	const int halfEdge = this->m_Size * 4;
-	const int xL = -halfEdge;
-	const int xR = halfEdge;
-	const int yL = -halfEdge;
-	const int yR = halfEdge;
+	int extents[3] = { halfEdge, halfEdge, halfEdge };
+	if (this->m_Settings.UseOrientedVolume && !this->DefineOrientedVolume(extents))
+	{
+		std::cout << "Unable to define an oriented volume, falling back to an axis aligned volume" << std::endl;
+	}
+
+	const int xL = -extents[0];
+	const int xR = extents[0];
+	const int yL = -extents[1];
+	const int yR = extents[1];
 	const int zL = 0;
-	const int zR = halfEdge;
-
-	// Store the corners of the voxel volume
-	this->m_Corners.push_back(new cv::Point3f((float)xL, (float)yL, (float)zL));
-	this->m_Corners.push_back(new cv::Point3f((float)xL, (float)yR, (float)zL));
-	this->m_Corners.push_back(new cv::Point3f((float)xR, (float)yR, (float)zL));
-	this->m_Corners.push_back(new cv::Point3f((float)xR, (float)yL, (float)zL));
-	this->m_Corners.push_back(new cv::Point3f((float)xL, (float)yL, (float)zR));
-	this->m_Corners.push_back(new cv::Point3f((float)xL, (float)yR, (float)zR));
-	this->m_Corners.push_back(new cv::Point3f((float)xR, (float)yR, (float)zR));
-	this->m_Corners.push_back(new cv::Point3f((float)xR, (float)yL, (float)zR));
+	const int zR = extents[2];
+
+	// Voxel coordinates are stored in 16 bits, relative to the origin of their division when spilling tiles
+	const int lower[3] = { xL, yL, zL };
+	const int upper[3] = { xR, yR, zR };
+	for (int a = 0 ; a < 3 ; ++a)
+	{
+		const int voxels = (upper[a] - lower[a]) / this->m_Step;
+		const int range = this->m_Settings.TileDivisions > 0 ? ((voxels + this->m_Divisions - 1) / this->m_Divisions - 1) * this->m_Step : (-lower[a] > upper[a] ? -lower[a] : upper[a]);
+		if (range > SHRT_MAX)
+		{
+			throw_line(this->m_Settings.TileDivisions > 0 ? "Voxel space too large for 16 bit voxel coordinates, use more tiles" : "Voxel space too large for 16 bit voxel coordinates, use out-of-core tiles");
+		}
+	}
+
+	this->m_Bounds[0] = this->m_Region[0] = xL;
+	this->m_Bounds[1] = this->m_Region[1] = xR;
+	this->m_Bounds[2] = this->m_Region[2] = yL;
+	this->m_Bounds[3] = this->m_Region[3] = yR;
+	this->m_Bounds[4] = this->m_Region[4] = zL;
+	this->m_Bounds[5] = this->m_Region[5] = zR;
+
+	// Store the corners of the voxel volume (world)
+	this->m_Corners.push_back(new cv::Point3f(this->VolumeToWorld(cv::Point3f((float)xL, (float)yL, (float)zL))));
+	this->m_Corners.push_back(new cv::Point3f(this->VolumeToWorld(cv::Point3f((float)xL, (float)yR, (float)zL))));
+	this->m_Corners.push_back(new cv::Point3f(this->VolumeToWorld(cv::Point3f((float)xR, (float)yR, (float)zL))));
+	this->m_Corners.push_back(new cv::Point3f(this->VolumeToWorld(cv::Point3f((float)xR, (float)yL, (float)zL))));
+	this->m_Corners.push_back(new cv::Point3f(this->VolumeToWorld(cv::Point3f((float)xL, (float)yL, (float)zR))));
+	this->m_Corners.push_back(new cv::Point3f(this->VolumeToWorld(cv::Point3f((float)xL, (float)yR, (float)zR))));
+	this->m_Corners.push_back(new cv::Point3f(this->VolumeToWorld(cv::Point3f((float)xR, (float)yR, (float)zR))));
+	this->m_Corners.push_back(new cv::Point3f(this->VolumeToWorld(cv::Point3f((float)xR, (float)yL, (float)zR))));
 
 	// Create some storage for the Rotation, Translation, cAmera matrix and distortion (c)koefficients
 	float *R = new float[this->m_Cameras.size() * 9];
 	float *T = new float[this->m_Cameras.size() * 3];
 	float *A = new float[this->m_Cameras.size() * 9];
 	float *K = new float[this->m_Cameras.size() * 12];
+	int *Roi = new int[this->m_Cameras.size() * 4];
 
 	memset(R, 0, sizeof(float)* this->m_Cameras.size() * 9);
 	memset(T, 0, sizeof(float)* this->m_Cameras.size() * 3);
@@ -94,30 +144,71 @@ bool Reconstructor::Initialize(void)
 		Common::MatToFloatArray(a, A + (i * 9));
 		Common::MatToFloatArray(k, K + (i * 12));
 
+		const cv::Rect &roi = (*it)->GetRoi();
+		Roi[i * 4] = roi.x;
+		Roi[i * 4 + 1] = roi.y;
+		Roi[i * 4 + 2] = roi.x + roi.width;
+		Roi[i * 4 + 3] = roi.y + roi.height;
+
 		++i;
 	}
 
-	bool success = initialize_voxels(R, T, A, K, this->m_Cameras.size(), xL, xR, yL, yR, zL, zR, this->m_Step, this->m_FrustumSize.width, this->m_FrustumSize.height, &this->m_TotalVoxels) == EXIT_SUCCESS;
+	// Sparse storage for the carved voxels, bricks are only allocated where the hull exists
+	if (this->m_Settings.UseBrickMap)
+	{
+		this->m_BrickMap = new BrickMap((xR - xL) / this->m_Step, (yR - yL) / this->m_Step, (zR - zL) / this->m_Step, xL, yL, zL, this->m_Step);
+	}
+
+	// Disk backed storage for out-of-core reconstruction
+	if (this->m_Settings.TileDivisions > 0)
+	{
+		this->m_TileStore = new TileStore(this->m_Settings.CompressedFileName + ".tiles");
+	}
+
+	// The hierarchical carver works on the host, it keeps its own copy of the camera parameters
+	if (this->m_Settings.UseHierarchicalCarving)
+	{
+		this->m_HierarchicalCarver = new HierarchicalCarver(this->m_Cameras, R, T, A, K, Roi, this->m_Volume, this->m_FrustumSize);
+	}
+
+	bool success = initialize_voxels(R, T, A, K, Roi, this->m_Volume, this->m_Cameras.size(), xL, xR, yL, yR, zL, zR, this->m_Step, this->m_Divisions, this->m_BrickMap != 0, &this->m_TotalVoxels) == EXIT_SUCCESS;
 
 	delete[] R;
 	delete[] T;
 	delete[] A;
 	delete[] K;
+	delete[] Roi;
 
 	return success;
 }
 
 void Reconstructor::Update()
 {
-	// Fetch set of foregrounds from cameras
+	// Fetch set of foregrounds from cameras, as packed silhouettes. Fused keying has no silhouettes, it only needs the
+	// garbage masks
 	cv::cuda::GpuMat *foregrounds = new cv::cuda::GpuMat[this->m_Cameras.size()];
 	cv::cuda::GpuMat *frames = new cv::cuda::GpuMat[this->m_Cameras.size()];
-	int i = 0;
+	cv::cuda::GpuMat *tiledFrames = this->m_Settings.UseTiledImages ? new cv::cuda::GpuMat[this->m_Cameras.size()] : 0;
+
+	// Carving converts the colours it needs from YUV frames, as long as every camera has them
+	bool yuv = !this->m_Settings.UseTiledImages;
 	std::vector<Camera*>::const_iterator it;
 	for (it = this->m_Cameras.begin() ; it != this->m_Cameras.end() ; ++it)
 	{
-		foregrounds[i] = cv::cuda::GpuMat((*it)->GetForegroundImage());
-		frames[i] = cv::cuda::GpuMat((*it)->GetFrame());
+		yuv &= (*it)->HasYuvFrame();
+	}
+
+	int i = 0;
+	for (it = this->m_Cameras.begin() ; it != this->m_Cameras.end() ; ++it)
+	{
+		foregrounds[i] = cv::cuda::GpuMat(!this->m_FusedKeyers.empty() ? (*it)->GetMask() : (*it)->GetSilhouette());
+		frames[i] = cv::cuda::GpuMat(yuv ? (*it)->GetYuvFrame() : (*it)->GetFrame());
+
+		// Tiled along with the silhouette, or now when there is none
+		if (tiledFrames != 0)
+		{
+			tiledFrames[i] = (*it)->GetTiledFrame();
+		}
 
 		/*cv::Mat fg, f;
 		foregrounds[i].download(fg);
@@ -137,9 +228,273 @@ void Reconstructor::Update()
 		this->m_NumVisibleVoxels = 0;
 	}
 
+	// Voxels of the previous frame are released, the brick pool is kept
+	if (this->m_BrickMap != 0)
+	{
+		this->m_BrickMap->Clear();
+	}
+
+	if (this->m_TileStore != 0)
+	{
+		this->m_TileStore->Clear();
+	}
+
+	// Carve a different region or resolution than the previous frame, the device storage was allocated for the full
+	// voxel space at the finest step so any region and coarser step fits
+	if (this->m_VoxelSpaceChanged)
+	{
+		if (configure_voxels(this->m_Region[0], this->m_Region[1], this->m_Region[2], this->m_Region[3], this->m_Region[4], this->m_Region[5], this->m_CarveStep) != EXIT_SUCCESS)
+		{
+			throw_line("Carving region does not fit in the voxel storage");
+		}
+
+		this->m_VoxelSpaceChanged = false;
+	}
+
+	// Every camera is keyed with the settings of its own keyer
+	std::vector<fused_key> keys;
+	for (it = this->m_Cameras.begin() ; it != this->m_Cameras.end() && !this->m_FusedKeyers.empty() ; ++it)
+	{
+		DistanceKeyer *keyer = this->m_FusedKeyers.at((*it)->GetId());
+
+		fused_key key;
+		key.color = make_uint3(keyer->GetR(), keyer->GetG(), keyer->GetB());
+		key.treshold = keyer->GetTreshold();
+		key.tolerance = keyer->GetTolerance();
+		key.table = keyer->IsUsingTable() ? (const unsigned int*)keyer->GetTable().data : 0;
+
+		keys.push_back(key);
+	}
+
 	// Update voxels, call CUDA kernel
-	update_voxels(foregrounds, frames, &this->m_NumVisibleVoxels, &this->m_VisibleVoxels);
+	update_voxels(foregrounds, frames, &this->m_NumVisibleVoxels, &this->m_VisibleVoxels, this->m_BrickMap, this->m_TileStore, tiledFrames, yuv, keys.empty() ? 0 : &keys[0]);
 
 	delete[] foregrounds;
 	delete[] frames;
+	delete[] tiledFrames;
+}
+
+Octree *Reconstructor::CarveOctree(void)
+{
+	if (this->m_HierarchicalCarver == 0)
+	{
+		throw_line("Hierarchical carving is not enabled");
+	}
+
+	this->m_HierarchicalCarver->Update();
+
+	return this->m_HierarchicalCarver->Carve(this->m_Region, this->m_CarveStep);
+}
+
+bool Reconstructor::DefineOrientedVolume(int extents[3])
+{
+	cv::Mat rotation, origin, size;
+
+	// Explicit volume definition, extents are the half sizes along x and y and the height along z
+	cv::FileStorage fs;
+	fs.open(this->m_Settings.DataPath + Common::VolumeFile, cv::FileStorage::READ);
+	if (fs.isOpened())
+	{
+		cv::Mat r, o, e;
+		fs["Rotation"] >> r;
+		fs["Origin"] >> o;
+		fs["Extents"] >> e;
+		fs.release();
+
+		r.convertTo(rotation, CV_32F);
+		o.convertTo(origin, CV_32F);
+		e.convertTo(size, CV_32F);
+
+		if (rotation.total() != 3 || origin.total() != 3 || size.total() != 3)
+		{
+			throw_line("Invalid volume definition, expecting Rotation, Origin and Extents as 3 vectors");
+		}
+
+		std::cout << "Using volume from: " << this->m_Settings.DataPath << Common::VolumeFile << std::endl;
+	}
+	else
+	{
+		// Only floor area seen by every camera can hold voxels, intersect the floor footprints of all cameras
+		std::vector<cv::Point2f> stage;
+		std::vector<Camera*>::const_iterator it;
+		for (it = this->m_Cameras.begin() ; it != this->m_Cameras.end() ; ++it)
+		{
+			// A camera looking over the horizon has an unbounded footprint, it doesn't constrain the stage
+			const std::vector<cv::Point3f> &floor = (*it)->GetCameraFloor();
+			if (floor.size() < 4)
+			{
+				continue;
+			}
+
+			std::vector<cv::Point2f> footprint, hull;
+			for (size_t p = 0 ; p < floor.size() ; ++p)
+			{
+				footprint.push_back(cv::Point2f(floor[p].x, floor[p].y));
+			}
+			cv::convexHull(footprint, hull);
+
+			if (stage.empty())
+			{
+				stage = hull;
+			}
+			else
+			{
+				std::vector<cv::Point2f> intersection;
+				if (cv::intersectConvexConvex(stage, hull, intersection) <= 0)
+				{
+					return false;
+				}
+
+				stage = intersection;
+			}
+		}
+
+		if (stage.size() < 3)
+		{
+			return false;
+		}
+
+		// The smallest rotated rectangle around the stage defines the box, height stays as is
+		cv::RotatedRect rect = cv::minAreaRect(stage);
+
+		rotation = (cv::Mat_<float>(3, 1) << 0.0f, 0.0f, float(rect.angle * CV_PI / 180.0));
+		origin = (cv::Mat_<float>(3, 1) << rect.center.x, rect.center.y, 0.0f);
+		size = (cv::Mat_<float>(3, 1) << rect.size.width * 0.5f, rect.size.height * 0.5f, (float)extents[2]);
+
+		std::cout << "Derived volume from camera floors: center (" << rect.center.x << ", " << rect.center.y << "), size " << rect.size << ", angle " << rect.angle << std::endl;
+	}
+
+	// Rodrigues vector to rotation matrix, stored row major followed by the origin
+	cv::Mat r(3, 3, CV_32F, this->m_Volume);
+	cv::Rodrigues(rotation, r);
+
+	this->m_Volume[9] = origin.at<float>(0);
+	this->m_Volume[10] = origin.at<float>(1);
+	this->m_Volume[11] = origin.at<float>(2);
+
+	// The voxel storage is sized from these extents, a volume larger than the default voxel space costs more memory
+	for (int a = 0 ; a < 3 ; ++a)
+	{
+		const int e = (int)ceil(size.at<float>(a));
+		if (e > extents[a])
+		{
+			std::cout << "Volume extends " << e << " along axis " << a << ", beyond the default voxel space of " << extents[a] << std::endl;
+		}
+
+		extents[a] = e < 1 ? 1 : e;
+	}
+
+	return true;
+}
+
+cv::Point3f Reconstructor::VolumeToWorld(const cv::Point3f &p) const
+{
+	const float *v = this->m_Volume;
+
+	return cv::Point3f(
+		v[0] * p.x + v[1] * p.y + v[2] * p.z + v[9],
+		v[3] * p.x + v[4] * p.y + v[5] * p.z + v[10],
+		v[6] * p.x + v[7] * p.y + v[8] * p.z + v[11]
+	);
+}
+
+void Reconstructor::SetCarveStep(int step)
+{
+	// We can't go finer than the storage was allocated for
+	step = step < this->m_Step ? this->m_Step : step;
+
+	if (step != this->m_CarveStep)
+	{
+		this->m_CarveStep = step;
+
+		// Re-snap the region to the new step
+		const int min[3] = { this->m_Region[0], this->m_Region[2], this->m_Region[4] };
+		const int max[3] = { this->m_Region[1], this->m_Region[3], this->m_Region[5] };
+		this->SetRegion(min, max);
+	}
+}
+
+void Reconstructor::SetRegion(const int min[3], const int max[3])
+{
+	const int step = this->m_CarveStep;
+
+	for (int a = 0 ; a < 3 ; ++a)
+	{
+		const int l = this->m_Bounds[a * 2], r = this->m_Bounds[a * 2 + 1];
+
+		// Snap outwards to the voxel grid of the full voxel space, such that voxels land on the same positions as in a full carve
+		int rl = min[a] < l ? l : (min[a] > r ? r : min[a]);
+		int rr = max[a] > r ? r : (max[a] < l ? l : max[a]);
+		rl = l + ((rl - l) / step) * step;
+		rr = l + ((rr - l + step - 1) / step) * step;
+
+		// Every division should at least hold one voxel
+		while ((rr - rl) / step < this->m_Divisions)
+		{
+			if (rr + step <= r)
+			{
+				rr += step;
+			}
+			else if (rl - step >= l)
+			{
+				rl -= step;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		this->m_Region[a * 2] = rl;
+		this->m_Region[a * 2 + 1] = rr > r ? r : rr;
+	}
+
+	this->m_VoxelSpaceChanged = true;
+}
+
+void Reconstructor::ResetRegion(void)
+{
+	const int min[3] = { this->m_Bounds[0], this->m_Bounds[2], this->m_Bounds[4] };
+	const int max[3] = { this->m_Bounds[1], this->m_Bounds[3], this->m_Bounds[5] };
+
+	this->SetRegion(min, max);
+}
+
+bool Reconstructor::GetHullBounds(int min[3], int max[3])
+{
+	if (this->m_BrickMap != 0)
+	{
+		return this->m_BrickMap->GetBounds(min, max);
+	}
+
+	// Tiles are on disk, their bounds are kept in the tile index
+	if (this->m_TileStore != 0)
+	{
+		return this->m_TileStore->GetBounds(min, max);
+	}
+
+	// Carving emits the octree, the carver keeps the bounds of what it carved
+	if (this->m_HierarchicalCarver != 0)
+	{
+		return this->m_HierarchicalCarver->GetHullBounds(min, max);
+	}
+
+	if (this->m_NumVisibleVoxels == 0)
+	{
+		return false;
+	}
+
+	for (unsigned long long int i = 0 ; i < this->m_NumVisibleVoxels ; ++i)
+	{
+		const VisibleVoxel &v = this->m_VisibleVoxels[i];
+		const int c[3] = { v.X, v.Y, v.Z };
+
+		for (int a = 0 ; a < 3 ; ++a)
+		{
+			min[a] = i == 0 || c[a] < min[a] ? c[a] : min[a];
+			max[a] = i == 0 || c[a] > max[a] ? c[a] : max[a];
+		}
+	}
+
+	return true;
 }
\ No newline at end of file
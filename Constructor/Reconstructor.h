@@ -1,16 +1,43 @@
 #pragma once
 
 #include "Camera.h"
+#include "Settings.h"
 #include "VisibleVoxel.h"
+#include "BrickMap.h"
+#include "TileStore.h"
+#include "HierarchicalCarver.h"
+#include "DistanceKeyer.h"
+
+// Number of divisions per axis of the voxel space when reconstructing in-core
+#define DEFAULT_DIVISIONS 2
 
 class Reconstructor
 {
 private:
+	Settings &m_Settings;
+
 	const std::vector<Camera*> &m_Cameras;
 
 	int m_Step;
 	int m_Size;
 
+	int m_Divisions;
+
+	// Bounds of the full voxel space and of the region that is actually carved as (xL, xR, yL, yR, zL, zR)
+	int m_Bounds[6];
+	int m_Region[6];
+
+	// Step used for carving, can be coarser than the step the voxel storage was allocated for
+	int m_CarveStep;
+
+	bool m_VoxelSpaceChanged;
+
+	// Transformation from volume to world coordinates, row major rotation followed by the origin. Carving iterates in
+	// volume coordinates, such that the voxel grid can be aligned with the capture area in stead of the checkerboard
+	float m_Volume[12];
+
+	bool DefineOrientedVolume(int extents[3]);
+
 	int m_TotalVoxels;
 
 	std::vector<cv::Point3f*> m_Corners;
@@ -19,15 +46,43 @@ private:
 
 	unsigned long long int m_NumVisibleVoxels;
 
+	BrickMap *m_BrickMap;
+
+	TileStore *m_TileStore;
+
+	HierarchicalCarver *m_HierarchicalCarver;
+
+	// Keyers per camera id, when set carving keys the frames itself and the foregrounds of the cameras are not used
+	std::map<int, DistanceKeyer*> m_FusedKeyers;
+
 	cv::Size m_FrustumSize;
 public:
-	Reconstructor(const std::vector<Camera*> &cameras);
+	Reconstructor(Settings &settings, const std::vector<Camera*> &cameras);
 	virtual ~Reconstructor(void);
 
 	bool Initialize(void);
 
 	void Update(void);
 
+	// Carve the current region straight into an octree, the caller owns the octree
+	Octree *CarveOctree(void);
+
+	void SetCarveStep(int step);
+
+	void SetFusedKeyers(const std::map<int, DistanceKeyer*> &keyers)
+	{
+		this->m_FusedKeyers = keyers;
+	}
+
+	void SetRegion(const int min[3], const int max[3]);
+	void ResetRegion(void);
+
+	// Bounds of the hull carved last in volume coordinates, from the brick map, the tile index, the hierarchical carver or
+	// the visible voxels. Returns false if nothing was carved
+	bool GetHullBounds(int min[3], int max[3]);
+
+	cv::Point3f VolumeToWorld(const cv::Point3f &p) const;
+
 	VisibleVoxel *GetVisibleVoxels(void)
 	{
 		return this->m_VisibleVoxels;
@@ -38,6 +93,16 @@ public:
 		return this->m_NumVisibleVoxels;
 	}
 
+	BrickMap *GetBrickMap(void)
+	{
+		return this->m_BrickMap;
+	}
+
+	TileStore *GetTileStore(void)
+	{
+		return this->m_TileStore;
+	}
+
 	const std::vector<cv::Point3f*> &GetCorners(void) const
 	{
 		return this->m_Corners;
@@ -48,6 +113,32 @@ public:
 		return this->m_Size;
 	}
 
+	int GetStep(void) const
+	{
+		return this->m_Step;
+	}
+
+	int GetCarveStep(void) const
+	{
+		return this->m_CarveStep;
+	}
+
+	const int *GetRegion(void) const
+	{
+		return this->m_Region;
+	}
+
+	const float *GetVolume(void) const
+	{
+		return this->m_Volume;
+	}
+
+	// Number of voxels in the carved region at the current carve step
+	double GetRegionVoxels(void) const
+	{
+		return double((this->m_Region[1] - this->m_Region[0]) / this->m_CarveStep) * ((this->m_Region[3] - this->m_Region[2]) / this->m_CarveStep) * ((this->m_Region[5] - this->m_Region[4]) / this->m_CarveStep);
+	}
+
 	const cv::Size &GetFrustumSize(void) const
 	{
 		return this->m_FrustumSize;
@@ -0,0 +1,190 @@
+#include "Stdafx.h"
+
+#include "ScaledFrameSource.h"
+#include "Exception.h"
+
+#include "yuv.cuh"
+
+ScaledFrameSource::ScaledFrameSource(FrameSource *source, const int scale, const bool yuv) : m_Source(source), m_Scale(scale), m_IsYuv(yuv)
+{
+	if (scale < 1)
+	{
+		throw_line("Frames can only be reduced by a positive factor");
+	}
+
+	this->m_Size = cv::Size(source->GetSize().width / scale, source->GetSize().height / scale);
+
+	// Keep whole pairs and quads of the format
+	switch (source->GetFormat())
+	{
+	case FRAME_FORMAT_BGR:
+		if (yuv)
+		{
+			this->m_Size.width &= ~1;
+			this->m_Size.height &= ~3;
+		}
+		break;
+	case FRAME_FORMAT_UYVY:
+		this->m_Size.width &= ~1;
+		break;
+	default:
+		this->m_Size.width &= ~1;
+		this->m_Size.height &= ~1;
+		break;
+	}
+
+	if (this->m_Size.area() == 0)
+	{
+		char b[100];
+		sprintf(b, "Frames are too small to be reduced by a factor of %d", scale);
+		throw_line(b);
+	}
+}
+
+ScaledFrameSource::~ScaledFrameSource(void)
+{
+	delete this->m_Source;
+}
+
+bool ScaledFrameSource::Read(cv::Mat &frame)
+{
+	if (!this->m_Source->Read(this->m_Decoded))
+	{
+		return false;
+	}
+
+	// The reduced frame is written into the frame that was passed when it has the right shape already
+	switch (this->m_Source->GetFormat())
+	{
+	case FRAME_FORMAT_BGR:
+		if (this->m_IsYuv && is_yuv_frame(this->m_Decoded.rows, this->m_Decoded.cols, this->m_Source->GetSize().width, this->m_Source->GetSize().height))
+		{
+			this->ReduceYuv(this->m_Decoded, frame);
+		}
+		else
+		{
+			ScaledFrameSource::Reduce(this->m_Decoded, frame, this->m_Size, this->m_Scale);
+		}
+		break;
+	case FRAME_FORMAT_UYVY:
+		this->ReduceUyvy(this->m_Decoded, frame);
+		break;
+	default:
+		this->ReduceBayer(this->m_Decoded, frame);
+		break;
+	}
+
+	return true;
+}
+
+void ScaledFrameSource::Reduce(const cv::Mat &in, cv::Mat &out, const cv::Size &size)
+{
+	const int sx = in.cols / size.width, sy = in.rows / size.height;
+	const int scale = sx < sy ? sx : sy;
+
+	if (scale < 1)
+	{
+		throw_line("Image is smaller than the size it should be reduced to");
+	}
+
+	ScaledFrameSource::Reduce(in, out, size, scale);
+}
+
+void ScaledFrameSource::Reduce(const cv::Mat &in, cv::Mat &out, const cv::Size &size, const int scale)
+{
+	// With an integer factor area interpolation averages whole blocks of pixels
+	cv::resize(in(cv::Rect(0, 0, size.width * scale, size.height * scale)), out, size, 0, 0, cv::INTER_AREA);
+}
+
+void ScaledFrameSource::ReduceYuv(const cv::Mat &in, cv::Mat &out) const
+{
+	const cv::Size &size = this->m_Size;
+	const cv::Size &full = this->m_Source->GetSize();
+
+	// The planes are only laid out one after the other without gaps in a continuous frame
+	const cv::Mat yuv = in.isContinuous() ? in : in.clone();
+
+	out.create(size.height * 3 / 2, size.width, CV_8UC1);
+	assert(out.isContinuous());
+
+	cv::Mat luma(size, CV_8UC1, out.data);
+	ScaledFrameSource::Reduce(cv::Mat(full, CV_8UC1, yuv.data), luma, size, this->m_Scale);
+
+	// Chroma planes are a quarter of the size of the frame, they're reduced by the same factor
+	const cv::Size chroma(size.width / 2, size.height / 2);
+	const cv::Size fullChroma(full.width / 2, full.height / 2);
+	for (int p = 0 ; p < 2 ; ++p)
+	{
+		cv::Mat plane(chroma, CV_8UC1, out.data + size.area() + p * chroma.area());
+		ScaledFrameSource::Reduce(cv::Mat(fullChroma, CV_8UC1, yuv.data + full.area() + p * fullChroma.area()), plane, chroma, this->m_Scale);
+	}
+}
+
+void ScaledFrameSource::ReduceBayer(const cv::Mat &in, cv::Mat &out) const
+{
+	const int scale = this->m_Scale;
+	const int area = scale * scale;
+
+	out.create(this->m_Size, CV_8UC1);
+
+	// A pixel of the reduced mosaic averages the pixels of its colour in a block of scale x scale quads, same colours are
+	// two pixels apart
+	#pragma omp parallel for
+	for (int y = 0 ; y < out.rows ; ++y)
+	{
+		const int row = (y >> 1) * 2 * scale + (y & 1);
+		uchar *dst = out.ptr<uchar>(y);
+
+		for (int x = 0 ; x < out.cols ; ++x)
+		{
+			const int col = (x >> 1) * 2 * scale + (x & 1);
+
+			int sum = 0;
+			for (int j = 0 ; j < scale ; ++j)
+			{
+				const uchar *src = in.ptr<uchar>(row + j * 2) + col;
+				for (int i = 0 ; i < scale ; ++i)
+				{
+					sum += src[i * 2];
+				}
+			}
+
+			dst[x] = uchar((sum + area / 2) / area);
+		}
+	}
+}
+
+void ScaledFrameSource::ReduceUyvy(const cv::Mat &in, cv::Mat &out) const
+{
+	const int scale = this->m_Scale;
+	const int area = scale * scale;
+
+	out.create(this->m_Size, CV_8UC2);
+
+	// Luma is averaged over the block of the pixel. Chroma is shared by a pair of pixels, a reduced pair averages the
+	// chroma of the scale x scale pairs it covers, U of the even pixels and V of the odd ones
+	#pragma omp parallel for
+	for (int y = 0 ; y < out.rows ; ++y)
+	{
+		uchar *dst = out.ptr<uchar>(y);
+
+		for (int x = 0 ; x < out.cols ; ++x)
+		{
+			const int pair = (x >> 1) * scale;
+
+			int luma = 0, chroma = 0;
+			for (int j = 0 ; j < scale ; ++j)
+			{
+				const uchar *src = in.ptr<uchar>(y * scale + j);
+				for (int i = 0 ; i < scale ; ++i)
+				{
+					luma += src[((x * scale + i) << 1) + 1];
+					chroma += src[((pair + i) * 2 + (x & 1)) << 1];
+				}
+			}
+
+			dst[x * 2] = uchar((chroma + area / 2) / area);
+			dst[x * 2 + 1] = uchar((luma + area / 2) / area);
+		}
+	}
+}
\ No newline at end of file
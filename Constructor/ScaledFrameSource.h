@@ -0,0 +1,79 @@
+#pragma once
+
+#include "FrameSource.h"
+
+// Frames of another source reduced by an integer factor, for coarse and preview passes where a voxel covers many pixels.
+// Frames keep their format and are box filtered in it: BGR and greyscale frames and the planes of I420 frames by area,
+// Bayer mosaics per colour such that they stay a mosaic of the same pattern, UYVY per channel. The edge of the frame the
+// factor doesn't divide is cropped, and so are pixels that would break the pairs or quads of the format
+class ScaledFrameSource : public FrameSource
+{
+private:
+	// Owned
+	FrameSource *m_Source;
+
+	int m_Scale;
+
+	cv::Size m_Size;
+
+	// I420 frames are reduced plane by plane when set
+	bool m_IsYuv;
+
+	cv::Mat m_Decoded;
+
+	static void Reduce(const cv::Mat &in, cv::Mat &out, const cv::Size &size, const int scale);
+
+	void ReduceYuv(const cv::Mat &in, cv::Mat &out) const;
+	void ReduceBayer(const cv::Mat &in, cv::Mat &out) const;
+	void ReduceUyvy(const cv::Mat &in, cv::Mat &out) const;
+public:
+	// Takes ownership of the source, yuv should be set if it may hand out I420 frames
+	ScaledFrameSource(FrameSource *source, const int scale, const bool yuv);
+	~ScaledFrameSource(void);
+
+	const cv::Size &GetSize(void) const
+	{
+		return this->m_Size;
+	}
+
+	long GetNumFrames(void) const
+	{
+		return this->m_Source->GetNumFrames();
+	}
+
+	FrameFormat GetFormat(void) const
+	{
+		return this->m_Source->GetFormat();
+	}
+
+	double GetFrameRate(void) const
+	{
+		return this->m_Source->GetFrameRate();
+	}
+
+	int GetPosition(void) const
+	{
+		return this->m_Source->GetPosition();
+	}
+
+	void Seek(const int frame)
+	{
+		this->m_Source->Seek(frame);
+	}
+
+	bool Read(cv::Mat &frame);
+
+	double GetTimestamp(void) const
+	{
+		return this->m_Source->GetTimestamp();
+	}
+
+	int GetScale(void) const
+	{
+		return this->m_Scale;
+	}
+
+	// Box filter a BGR or greyscale image down to the given size, by the largest integer factor that fits. Used for the
+	// images that go with the frames, like mattes and masks
+	static void Reduce(const cv::Mat &in, cv::Mat &out, const cv::Size &size);
+};
\ No newline at end of file
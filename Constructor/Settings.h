@@ -14,11 +14,85 @@ typedef struct Settings
 
 	bool UseMatteVideo;
 
+	bool UseBrickMap;
+
+	// Only write the surface of the hull from the brick map, the interior voxels are dropped
+	bool BrickSurfaceOnly;
+
+	unsigned int TileDivisions;
+
+	// Size of the voxel space, it spans 4 times this along every axis from the center (x and y) or the floor (z)
+	int VolumeSize;
+
+	float TargetLatency;
+
+	bool UseOrientedVolume;
+
+	bool UseHierarchicalCarving;
+
+	bool UseTiledImages;
+
+	bool UseHostKeyer;
+
+	bool UseFusedKeying;
+
+	unsigned int KeyRefreshInterval;
+
+	bool UseBackgroundModel;
+
+	bool UseMatteCache;
+
+	unsigned int CleanupRadius;
+
+	bool FillHoles;
+
+	bool UseAutoTreshold;
+
+	bool Headless;
+
+	bool UseKeyTable;
+
+	bool UseYuvFrames;
+
+	unsigned int PrefetchDepth;
+
+	// Frames to process, from first to last (inclusive, -1 for the end of the video) every stride frames
+	int FirstFrame;
+	int LastFrame;
+	int FrameStride;
+
+	// Frames and mattes are reduced by this factor as they're decoded, the intrinsics follow. 1 keeps full frames
+	unsigned int DecodeScale;
+
 	Settings(void)
 	{
 		this->UseCalibrationImages = false;
 		this->UseMatteStill = false;
 		this->UseMatteVideo = false;
+		this->UseBrickMap = false;
+		this->BrickSurfaceOnly = false;
+		this->TileDivisions = 0;
+		this->VolumeSize = 128;
+		this->TargetLatency = 0;
+		this->UseOrientedVolume = false;
+		this->UseHierarchicalCarving = false;
+		this->UseTiledImages = false;
+		this->UseHostKeyer = false;
+		this->UseFusedKeying = false;
+		this->KeyRefreshInterval = 0;
+		this->UseBackgroundModel = false;
+		this->UseMatteCache = false;
+		this->CleanupRadius = 0;
+		this->FillHoles = false;
+		this->UseAutoTreshold = false;
+		this->Headless = false;
+		this->UseKeyTable = false;
+		this->UseYuvFrames = false;
+		this->PrefetchDepth = 0;
+		this->FirstFrame = 0;
+		this->LastFrame = -1;
+		this->FrameStride = 1;
+		this->DecodeScale = 1;
 	}
 
 	void Print(void)
@@ -31,5 +105,36 @@ typedef struct Settings
 		std::cout << "Calibration images: " << (this->UseCalibrationImages ? "yes" : "no") << std::endl;
 		std::cout << "Matte still: " << (this->UseMatteStill ? "yes" : "no") << std::endl;
 		std::cout << "Matte video: " << (this->UseMatteVideo ? "yes" : "no") << std::endl;
+		std::cout << "Brick map: " << (this->UseBrickMap ? "yes" : "no") << std::endl;
+		std::cout << "Brick map surface only: " << (this->BrickSurfaceOnly ? "yes" : "no") << std::endl;
+		std::cout << "Out-of-core tiles per axis: " << this->TileDivisions << (this->TileDivisions > 0 ? "" : " (in-core)") << std::endl;
+		std::cout << "Voxel space size: " << this->VolumeSize << std::endl;
+		std::cout << "Target latency: " << this->TargetLatency << (this->TargetLatency > 0 ? " ms" : " (no deadline)") << std::endl;
+		std::cout << "Oriented volume: " << (this->UseOrientedVolume ? "yes" : "no") << std::endl;
+		std::cout << "Hierarchical carving: " << (this->UseHierarchicalCarving ? "yes" : "no") << std::endl;
+		std::cout << "Tiled images: " << (this->UseTiledImages ? "yes" : "no") << std::endl;
+		std::cout << "Host keyer: " << (this->UseHostKeyer ? "yes" : "no") << std::endl;
+		std::cout << "Fused keying: " << (this->UseFusedKeying ? "yes" : "no") << std::endl;
+		std::cout << "Background model: " << (this->UseBackgroundModel ? "yes" : "no") << std::endl;
+		std::cout << "Matte cache: " << (this->UseMatteCache ? "yes" : "no") << std::endl;
+		std::cout << "Silhouette cleanup radius: " << this->CleanupRadius << (this->CleanupRadius > 0 ? " pixels" : " (no opening and closing)") << std::endl;
+		std::cout << "Fill holes: " << (this->FillHoles ? "yes" : "no") << std::endl;
+		std::cout << "Automatic key treshold: " << (this->UseAutoTreshold ? "yes" : "no") << std::endl;
+		std::cout << "Headless: " << (this->Headless ? "yes" : "no") << std::endl;
+		std::cout << "Key table: " << (this->UseKeyTable ? "yes" : "no") << std::endl;
+		std::cout << "YUV frames: " << (this->UseYuvFrames ? "yes" : "no") << std::endl;
+		std::cout << "Prefetched frames per camera: " << this->PrefetchDepth << (this->PrefetchDepth > 0 ? "" : " (decoding on demand)") << std::endl;
+		std::cout << "Frames: " << this->FirstFrame << " to ";
+		if (this->LastFrame < 0)
+		{
+			std::cout << "the end";
+		}
+		else
+		{
+			std::cout << this->LastFrame;
+		}
+		std::cout << ", every " << this->FrameStride << (this->FrameStride > 1 ? " frames" : " frame") << std::endl;
+		std::cout << "Decode scale: 1/" << this->DecodeScale << (this->DecodeScale > 1 ? "" : " (full frames)") << std::endl;
+		std::cout << "Key color refresh interval: " << this->KeyRefreshInterval << (this->KeyRefreshInterval > 0 ? " frames" : " (first frame only)") << std::endl;
 	}
 } Settings;
\ No newline at end of file
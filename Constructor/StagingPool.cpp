@@ -0,0 +1,129 @@
+#include "Stdafx.h"
+
+#include "StagingPool.h"
+#include "Exception.h"
+
+StagingPool::StagingPool(const size_t count)
+{
+	if (count == 0)
+	{
+		throw_line("Staging needs at least one buffer");
+	}
+
+	this->m_Buffers.resize(count);
+	for (size_t i = 0 ; i < count ; ++i)
+	{
+		StagingBuffer &buffer = this->m_Buffers[i];
+		buffer.Data = 0;
+		buffer.Capacity = 0;
+		buffer.InUse = false;
+		buffer.IsReleasePending = false;
+
+		if (cudaEventCreateWithFlags(&buffer.Released, cudaEventDisableTiming) != cudaSuccess)
+		{
+			throw_line("Failed to create staging event");
+		}
+	}
+}
+
+StagingPool::~StagingPool(void)
+{
+	for (size_t i = 0 ; i < this->m_Buffers.size() ; ++i)
+	{
+		StagingBuffer &buffer = this->m_Buffers[i];
+
+		// Uploads from the buffer may still be in flight
+		cudaEventSynchronize(buffer.Released);
+		cudaEventDestroy(buffer.Released);
+
+		cudaFreeHost(buffer.Data);
+	}
+}
+
+int StagingPool::Acquire(cv::Mat &host)
+{
+	int index = -1;
+	{
+		std::unique_lock<std::mutex> lock(this->m_Mutex);
+
+		for (;;)
+		{
+			for (size_t i = 0 ; i < this->m_Buffers.size() && index < 0 ; ++i)
+			{
+				if (!this->m_Buffers[i].InUse)
+				{
+					index = (int)i;
+				}
+			}
+
+			if (index >= 0)
+			{
+				break;
+			}
+
+			this->m_Available.wait(lock);
+		}
+
+		this->m_Buffers[index].InUse = true;
+	}
+
+	StagingBuffer &buffer = this->m_Buffers[index];
+	if (buffer.IsReleasePending)
+	{
+		cudaEventSynchronize(buffer.Released);
+		buffer.IsReleasePending = false;
+	}
+
+	host = buffer.Host;
+
+	return index;
+}
+
+const cv::Mat &StagingPool::Stage(const int index, const cv::Mat &frame)
+{
+	StagingBuffer &buffer = this->m_Buffers[index];
+	if (buffer.Host.data == frame.data && buffer.Host.size() == frame.size() && buffer.Host.type() == frame.type())
+	{
+		return buffer.Host;
+	}
+
+	const size_t step = frame.cols * frame.elemSize();
+	const size_t size = step * frame.rows;
+	if (size > buffer.Capacity)
+	{
+		cudaFreeHost(buffer.Data);
+		buffer.Data = 0;
+		buffer.Capacity = 0;
+
+		if (cudaHostAlloc(&buffer.Data, size, cudaHostAllocPortable) != cudaSuccess)
+		{
+			throw_line("Failed to allocate page-locked staging memory");
+		}
+
+		buffer.Capacity = size;
+	}
+
+	buffer.Host = cv::Mat(frame.size(), frame.type(), buffer.Data, step);
+	frame.copyTo(buffer.Host);
+
+	return buffer.Host;
+}
+
+void StagingPool::Release(const int index)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->m_Mutex);
+		this->m_Buffers[index].InUse = false;
+	}
+
+	this->m_Available.notify_one();
+}
+
+void StagingPool::Release(const int index, cudaStream_t stream)
+{
+	StagingBuffer &buffer = this->m_Buffers[index];
+	cudaEventRecord(buffer.Released, stream);
+	buffer.IsReleasePending = true;
+
+	this->Release(index);
+}
\ No newline at end of file
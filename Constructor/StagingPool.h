@@ -0,0 +1,48 @@
+#pragma once
+
+typedef struct StagingBuffer
+{
+	// Page-locked memory and the frame it holds
+	void *Data;
+	size_t Capacity;
+	cv::Mat Host;
+
+	bool InUse;
+
+	// Recorded on release, the buffer isn't reused before the uploads queued until then have finished
+	cudaEvent_t Released;
+	bool IsReleasePending;
+} StagingBuffer;
+
+// Page-locked host buffers frames are decoded or copied into, such that they're uploaded asynchronously at full speed.
+// The buffers are reused frame after frame and take the shape of the frames they hold, memory is only allocated again
+// when a frame doesn't fit. Acquire and release may happen on different threads
+class StagingPool
+{
+private:
+	std::vector<StagingBuffer> m_Buffers;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Available;
+public:
+	StagingPool(const size_t count);
+	~StagingPool(void);
+
+	// Blocks until a buffer is free, the buffer is returned with the shape of the frame it held last
+	int Acquire(cv::Mat &buffer);
+
+	// Make the buffer hold the frame and return it. Frames that were read into the buffer are left alone, other frames are
+	// copied in
+	const cv::Mat &Stage(const int index, const cv::Mat &frame);
+
+	// Hand a buffer back, it's reused right away
+	void Release(const int index);
+
+	// Hand a buffer back once the work queued on the stream so far is done
+	void Release(const int index, cudaStream_t stream);
+
+	size_t GetNumBuffers(void) const
+	{
+		return this->m_Buffers.size();
+	}
+};
\ No newline at end of file
@@ -11,11 +11,16 @@
 #include <string>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <map>
 #include <cmath>
+#include <cfloat>
 #include <cstdlib>
 #include <fstream>
 #include <stdexcept>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <chrono>
 
 // GLFW
@@ -41,6 +46,9 @@
 #include <boost/archive/binary_iarchive.hpp> 
 #include <boost/filesystem.hpp>
 #include <boost/serialization/list.hpp>
+#include <boost/serialization/version.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 // CUDA Runtime, Interop, and includes
 #include <cuda_runtime.h>
@@ -0,0 +1,65 @@
+#include "Stdafx.h"
+
+#include "VideoFrameSource.h"
+#include "Exception.h"
+
+VideoFrameSource::VideoFrameSource(const std::string &file, const bool yuv)
+{
+	this->m_Video = cv::VideoCapture(file);
+	if (!this->m_Video.isOpened())
+	{
+		throw_line("Unable to open video: " + file);
+	}
+
+	// Determine image size
+	this->m_Size.width = (int)this->m_Video.get(CV_CAP_PROP_FRAME_WIDTH);
+	this->m_Size.height = (int)this->m_Video.get(CV_CAP_PROP_FRAME_HEIGHT);
+	assert(this->m_Size.area() > 0);
+
+	// Fetch number of frames
+	this->m_Video.set(CV_CAP_PROP_POS_AVI_RATIO, 1);
+	this->m_NumFrames = (long)this->m_Video.get(CV_CAP_PROP_POS_FRAMES);
+	assert(this->m_NumFrames > 1);
+
+	// Index the keyframes, or reload the index from the previous run
+	this->m_FrameRate = this->m_Video.get(CV_CAP_PROP_FPS);
+	this->m_Index = new KeyframeIndex(file);
+
+	// Rewind
+	this->m_Video.release();
+	this->m_Video = cv::VideoCapture(file);
+	this->m_Position = 0;
+	this->m_Timestamp = -1;
+
+	if (yuv)
+	{
+		this->m_Video.set(CV_CAP_PROP_CONVERT_RGB, 0);
+	}
+}
+
+VideoFrameSource::~VideoFrameSource(void)
+{
+	delete this->m_Index;
+}
+
+void VideoFrameSource::Seek(const int frame)
+{
+	this->m_Index->Seek(this->m_Video, this->m_Position, frame);
+	this->m_Position = frame;
+}
+
+bool VideoFrameSource::Read(cv::Mat &frame)
+{
+	this->m_Video >> frame;
+	if (frame.empty())
+	{
+		return false;
+	}
+
+	++this->m_Position;
+
+	// The capture reports the time of the frame it retrieved last
+	this->m_Timestamp = this->m_FrameRate > 0 ? this->m_Video.get(CV_CAP_PROP_POS_MSEC) / 1000.0 : -1;
+
+	return true;
+}
\ No newline at end of file
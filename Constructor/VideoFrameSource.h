@@ -0,0 +1,66 @@
+#pragma once
+
+#include "FrameSource.h"
+#include "KeyframeIndex.h"
+
+// Frames decoded from a video file, seeks go to the keyframe before the frame and decode forward
+class VideoFrameSource : public FrameSource
+{
+private:
+	cv::VideoCapture m_Video;
+
+	KeyframeIndex *m_Index;
+
+	cv::Size m_Size;
+	long m_NumFrames;
+	double m_FrameRate;
+
+	// Presentation time of the frame read last
+	double m_Timestamp;
+
+	// Frame the capture reads next, frames that were grabbed but not retrieved moved it too
+	int m_Position;
+public:
+	// Asks the decoder for its native I420 planes if yuv is set, backends that don't support this keep converting to BGR
+	VideoFrameSource(const std::string &file, const bool yuv);
+	~VideoFrameSource(void);
+
+	const cv::Size &GetSize(void) const
+	{
+		return this->m_Size;
+	}
+
+	long GetNumFrames(void) const
+	{
+		return this->m_NumFrames;
+	}
+
+	FrameFormat GetFormat(void) const
+	{
+		return FRAME_FORMAT_BGR;
+	}
+
+	double GetFrameRate(void) const
+	{
+		return this->m_FrameRate;
+	}
+
+	int GetPosition(void) const
+	{
+		return this->m_Position;
+	}
+
+	void Seek(const int frame);
+
+	bool Read(cv::Mat &frame);
+
+	double GetTimestamp(void) const
+	{
+		return this->m_Timestamp;
+	}
+
+	const KeyframeIndex &GetIndex(void) const
+	{
+		return *this->m_Index;
+	}
+};
\ No newline at end of file
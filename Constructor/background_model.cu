@@ -0,0 +1,138 @@
+#include <opencv2/core/core.hpp>
+#include <opencv2/core/cuda_types.hpp>
+
+#include <cuda_runtime.h>
+
+#include <iostream>
+
+#include "cuda_common.cuh"
+#include "background_model.cuh"
+
+#include "Exception.h"
+
+__global__
+void learn_background_kernel(const cv::cuda::PtrStepSz<uchar3> in, cv::cuda::PtrStepSz<float3> mean, cv::cuda::PtrStepSz<float3> m2, const unsigned int n)
+{
+	uint x = blockIdx.x * blockDim.x + threadIdx.x;
+	uint y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x < in.cols && y < in.rows)
+	{
+		// Welford's running mean and sum of squared differences, n is the number of the sample being added (starting at 1)
+		const float3 p = make_float3(in(y, x).x, in(y, x).y, in(y, x).z);
+		float3 mu = mean(y, x);
+		float3 s = m2(y, x);
+
+		const float3 delta = make_float3(p.x - mu.x, p.y - mu.y, p.z - mu.z);
+		mu.x += delta.x / n;
+		mu.y += delta.y / n;
+		mu.z += delta.z / n;
+
+		s.x += delta.x * (p.x - mu.x);
+		s.y += delta.y * (p.y - mu.y);
+		s.z += delta.z * (p.z - mu.z);
+
+		mean(y, x) = mu;
+		m2(y, x) = s;
+	}
+}
+
+__global__
+void finalize_background_kernel(cv::cuda::PtrStepSz<float3> m2, const unsigned int n, const float min_variance)
+{
+	uint x = blockIdx.x * blockDim.x + threadIdx.x;
+	uint y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x < m2.cols && y < m2.rows)
+	{
+		const float inv = n > 1 ? 1.0f / (n - 1) : 0.0f;
+		const float3 s = m2(y, x);
+
+		m2(y, x) = make_float3(fmaxf(s.x * inv, min_variance), fmaxf(s.y * inv, min_variance), fmaxf(s.z * inv, min_variance));
+	}
+}
+
+__global__
+void segment_background_kernel(const cv::cuda::PtrStepSz<uchar3> in, cv::cuda::PtrStepSz<float3> mean, cv::cuda::PtrStepSz<float3> variance, const float treshold, const float learning_rate, const float min_variance, cv::cuda::PtrStepSz<uchar> out)
+{
+	uint x = blockIdx.x * blockDim.x + threadIdx.x;
+	uint y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x < in.cols && y < in.rows)
+	{
+		const float3 p = make_float3(in(y, x).x, in(y, x).y, in(y, x).z);
+		float3 mu = mean(y, x);
+		float3 var = variance(y, x);
+
+		const float3 d = make_float3(p.x - mu.x, p.y - mu.y, p.z - mu.z);
+
+		// Squared distance to the mean in standard deviations, summed over the channels
+		const float distance = d.x * d.x / var.x + d.y * d.y / var.y + d.z * d.z / var.z;
+		if (distance > treshold * treshold)
+		{
+			out(y, x) = 255;
+			return;
+		}
+
+		out(y, x) = 0;
+
+		// Follow slow lighting changes, only pixels classified as background are blended in
+		if (learning_rate > 0)
+		{
+			mu.x += learning_rate * d.x;
+			mu.y += learning_rate * d.y;
+			mu.z += learning_rate * d.z;
+
+			var.x = fmaxf(var.x + learning_rate * (d.x * d.x - var.x), min_variance);
+			var.y = fmaxf(var.y + learning_rate * (d.y * d.y - var.y), min_variance);
+			var.z = fmaxf(var.z + learning_rate * (d.z * d.z - var.z), min_variance);
+
+			mean(y, x) = mu;
+			variance(y, x) = var;
+		}
+	}
+}
+
+static void check_background_error(const char *what)
+{
+	cudaError_t err = cudaGetLastError();
+	if (err != cudaSuccess)
+	{
+		char b[500];
+		sprintf(b, "Failed to %s: %s", what, cudaGetErrorString(err));
+		throw_line(b);
+	}
+}
+
+void learn_background(const cv::cuda::PtrStepSz<uchar3> in, cv::cuda::PtrStepSz<float3> mean, cv::cuda::PtrStepSz<float3> m2, const unsigned int n)
+{
+	dim3 blockSize(128, 8);
+	dim3 gridSize = dim3(iDivUp(in.cols, blockSize.x), iDivUp(in.rows, blockSize.y));
+
+	learn_background_kernel<<<gridSize, blockSize>>>(in, mean, m2, n);
+	cudaDeviceSynchronize();
+
+	check_background_error("learn background");
+}
+
+void finalize_background(cv::cuda::PtrStepSz<float3> m2, const unsigned int n, const float min_variance)
+{
+	dim3 blockSize(128, 8);
+	dim3 gridSize = dim3(iDivUp(m2.cols, blockSize.x), iDivUp(m2.rows, blockSize.y));
+
+	finalize_background_kernel<<<gridSize, blockSize>>>(m2, n, min_variance);
+	cudaDeviceSynchronize();
+
+	check_background_error("finalize background");
+}
+
+void segment_background(const cv::cuda::PtrStepSz<uchar3> in, cv::cuda::PtrStepSz<float3> mean, cv::cuda::PtrStepSz<float3> variance, const float treshold, const float learning_rate, const float min_variance, cv::cuda::PtrStepSz<uchar> out)
+{
+	dim3 blockSize(128, 8);
+	dim3 gridSize = dim3(iDivUp(in.cols, blockSize.x), iDivUp(in.rows, blockSize.y));
+
+	segment_background_kernel<<<gridSize, blockSize>>>(in, mean, variance, treshold, learning_rate, min_variance, out);
+	cudaStreamSynchronize(cudaStreamPerThread);
+
+	check_background_error("segment background");
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef BACKGROUND_MODEL_H
+#define BACKGROUND_MODEL_H
+
+// Add sample n (starting at 1) to the running mean and sum of squared differences
+void learn_background(
+	const cv::cuda::PtrStepSz<uchar3> in,
+	cv::cuda::PtrStepSz<float3> mean,
+	cv::cuda::PtrStepSz<float3> m2,
+	const unsigned int n
+);
+
+// Turn the sum of squared differences of n samples into the variance, in place
+void finalize_background(
+	cv::cuda::PtrStepSz<float3> m2,
+	const unsigned int n,
+	const float min_variance
+);
+
+// Pixels further than treshold standard deviations from the mean are foreground, background pixels update the model in place
+void segment_background(
+	const cv::cuda::PtrStepSz<uchar3> in,
+	cv::cuda::PtrStepSz<float3> mean,
+	cv::cuda::PtrStepSz<float3> variance,
+	const float treshold,
+	const float learning_rate,
+	const float min_variance,
+	cv::cuda::PtrStepSz<uchar> out
+);
+
+#endif /* BACKGROUND_MODEL_H */
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <iostream>
 
 #include "cuda_common.cuh"
+#include "key_matte.cuh"
 
 #include "Exception.h"
 
@@ -17,33 +18,7 @@ void compute_matte_kernel(const uint3 color, const uint treshold, const uint tol
 
 	if (x < in.cols && y < in.rows)
 	{
-		double i_255 = 1.0 / 255.0;
-		
-		float r = float(in(y, x).x), g = float(in(y, x).y), b = float(in(y, x).z);
-
-		float d = ((r * i_255 - color.x * i_255) * (r * i_255 - color.x * i_255)) + ((g * i_255 - color.y * i_255) * (g * i_255 - color.y * i_255)) + ((b * i_255 - color.z * i_255) * (b * i_255 - color.z * i_255));
-		
-		// Sqrt hack
-		unsigned int i = *(unsigned int*)&(d);
-		i += 127 << 23;
-		i >>= 1;
-		float distance = *(float*)&i;
-
-		int grey = 255 * distance / sqrt(3.0);
-		if (grey <= treshold)
-		{
-			out(y, x) = 0;
-		}
-		else if (grey >= tolerance)
-		{
-			out(y, x) = 255;
-		}
-		else
-		{
-			grey = 255 * (grey - treshold) / (tolerance - treshold);
-
-			out(y, x) = grey;
-		}
+		out(y, x) = key_matte(in(y, x), color, treshold, tolerance);
 	}
 }
 
@@ -53,7 +28,7 @@ void compute_matte(const uint3 color, const uint treshold, const uint tolerance,
 	dim3 gridSize = dim3(iDivUp(in.cols, blockSize.x), iDivUp(in.rows, blockSize.y));
 
 	compute_matte_kernel<<<gridSize, blockSize>>>(color, treshold, tolerance, in, out);
-	cudaDeviceSynchronize();
+	cudaStreamSynchronize(cudaStreamPerThread);
 
 	cudaError_t err = cudaGetLastError();
 	if (err != cudaSuccess)
@@ -0,0 +1,228 @@
+#include "Stdafx.h"
+
+#include <intrin.h>
+#include <immintrin.h>
+
+#include "compute_matte_host.h"
+
+// Number of pixels keyed per iteration of the vectorized loop
+#define MATTE_SIMD_WIDTH 32
+
+// Key distance scaled to 0 - 255, same math as compute_matte_kernel including the mixed double/float precision
+static inline int compute_grey(const uchar *pixel, const double key[3])
+{
+	const double i_255 = 1.0 / 255.0;
+
+	const double r = pixel[0] * i_255 - key[0];
+	const double g = pixel[1] * i_255 - key[1];
+	const double b = pixel[2] * i_255 - key[2];
+
+	float d = float(r * r + g * g + b * b);
+
+	// Sqrt hack
+	unsigned int i;
+	memcpy(&i, &d, sizeof(float));
+	i += 127 << 23;
+	i >>= 1;
+	float distance;
+	memcpy(&distance, &i, sizeof(float));
+
+	return int(255 * distance / sqrt(3.0));
+}
+
+// Same decision as compute_matte_kernel, including the unsigned comparisons
+static inline uchar compute_matte_pixel(const uchar *pixel, const double key[3], const unsigned int treshold, const unsigned int tolerance)
+{
+	int grey = compute_grey(pixel, key);
+	if (grey <= treshold)
+	{
+		return 0;
+	}
+	else if (grey >= tolerance)
+	{
+		return 255;
+	}
+
+	return uchar(255 * (grey - treshold) / (tolerance - treshold));
+}
+
+static void compute_matte_row_scalar(const uchar *in, uchar *out, const int from, const int to, const double key[3], const unsigned int treshold, const unsigned int tolerance)
+{
+	for (int x = from ; x < to ; ++x)
+	{
+		out[x] = compute_matte_pixel(in + x * 3, key, treshold, tolerance);
+	}
+}
+
+static void compute_matte_row_avx2(const uchar *in, uchar *out, const int cols, const double key[3], const unsigned int treshold, const unsigned int tolerance)
+{
+	// Moves the channels of 4 pixels (12 bytes) into 3 groups of 4 bytes
+	const __m128i deinterleave = _mm_setr_epi8(0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11, -1, -1, -1, -1);
+
+	const __m256d i_255 = _mm256_set1_pd(1.0 / 255.0);
+	const __m256d k0 = _mm256_set1_pd(key[0]);
+	const __m256d k1 = _mm256_set1_pd(key[1]);
+	const __m256d k2 = _mm256_set1_pd(key[2]);
+	const __m128i hack = _mm_set1_epi32(127 << 23);
+	const __m128 scale = _mm_set1_ps(255.0f);
+	const __m256d sqrt3 = _mm256_set1_pd(sqrt(3.0));
+
+	// Grey values are small and positive, clamping the bounds to the signed range keeps the unsigned comparisons of the kernel
+	const int t = treshold > INT_MAX ? INT_MAX : (int)treshold;
+	const int l = tolerance > INT_MAX ? INT_MAX : (int)tolerance;
+	const __m256i vt = _mm256_set1_epi32(t);
+	const __m256i vl = _mm256_set1_epi32(l - 1);
+	const __m256 range = _mm256_set1_ps(float(tolerance - treshold));
+	const __m256i white = _mm256_set1_epi32(255);
+
+	// Restores pixel order after packing, the packs work per 128 bit lane
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	int x = 0;
+
+	// Every group of 4 pixels loads 16 bytes of which 12 are used, stay clear of the end of the row
+	for ( ; x + MATTE_SIMD_WIDTH + 2 <= cols ; x += MATTE_SIMD_WIDTH)
+	{
+		__m256i result[4];
+		for (int q = 0 ; q < 4 ; ++q)
+		{
+			__m128i grey[2];
+			for (int h = 0 ; h < 2 ; ++h)
+			{
+				const __m128i channels = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + (x + q * 8 + h * 4) * 3)), deinterleave);
+
+				const __m256d c0 = _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(channels));
+				const __m256d c1 = _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(_mm_srli_si128(channels, 4)));
+				const __m256d c2 = _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(_mm_srli_si128(channels, 8)));
+
+				const __m256d d0 = _mm256_sub_pd(_mm256_mul_pd(c0, i_255), k0);
+				const __m256d d1 = _mm256_sub_pd(_mm256_mul_pd(c1, i_255), k1);
+				const __m256d d2 = _mm256_sub_pd(_mm256_mul_pd(c2, i_255), k2);
+
+				const __m256d d = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(d0, d0), _mm256_mul_pd(d1, d1)), _mm256_mul_pd(d2, d2));
+
+				// Sqrt hack on the bits of the single precision distance
+				__m128i i = _mm_castps_si128(_mm256_cvtpd_ps(d));
+				i = _mm_srli_epi32(_mm_add_epi32(i, hack), 1);
+				const __m128 distance = _mm_castsi128_ps(i);
+
+				grey[h] = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtps_pd(_mm_mul_ps(distance, scale)), sqrt3));
+			}
+
+			const __m256i g = _mm256_inserti128_si256(_mm256_castsi128_si256(grey[0]), grey[1], 1);
+
+			// The numerator is an exact integer and the quotient is truncated, so single precision gives the integer division
+			const __m256 ramp = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_mullo_epi32(_mm256_sub_epi32(g, vt), white)), range);
+
+			__m256i v = _mm256_blendv_epi8(_mm256_cvttps_epi32(ramp), white, _mm256_cmpgt_epi32(g, vl));
+			result[q] = _mm256_and_si256(v, _mm256_cmpgt_epi32(g, vt));
+		}
+
+		const __m256i ab = _mm256_packus_epi32(result[0], result[1]);
+		const __m256i cd = _mm256_packus_epi32(result[2], result[3]);
+		_mm256_storeu_si256((__m256i*)(out + x), _mm256_permutevar8x32_epi32(_mm256_packus_epi16(ab, cd), order));
+	}
+
+	// Tail of the row
+	compute_matte_row_scalar(in, out, x, cols, key, treshold, tolerance);
+}
+
+bool has_avx2(void)
+{
+	int info[4];
+
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	// AVX and OSXSAVE, the OS should also save the ymm registers
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+
+	return (info[1] & (1 << 5)) != 0;
+}
+
+static void compute_matte_key(const cv::Vec3i &color, double key[3])
+{
+	const double i_255 = 1.0 / 255.0;
+
+	key[0] = color[0] * i_255;
+	key[1] = color[1] * i_255;
+	key[2] = color[2] * i_255;
+}
+
+void compute_matte_scalar(const cv::Vec3i &color, const unsigned int treshold, const unsigned int tolerance, const cv::Mat &in, cv::Mat &out)
+{
+	assert(in.type() == CV_8UC3);
+
+	out.create(in.size(), CV_8UC1);
+
+	double key[3];
+	compute_matte_key(color, key);
+
+	#pragma omp parallel for
+	for (int y = 0 ; y < in.rows ; ++y)
+	{
+		compute_matte_row_scalar(in.ptr<uchar>(y), out.ptr<uchar>(y), 0, in.cols, key, treshold, tolerance);
+	}
+}
+
+void compute_matte_avx2(const cv::Vec3i &color, const unsigned int treshold, const unsigned int tolerance, const cv::Mat &in, cv::Mat &out)
+{
+	assert(in.type() == CV_8UC3);
+
+	out.create(in.size(), CV_8UC1);
+
+	double key[3];
+	compute_matte_key(color, key);
+
+	#pragma omp parallel for
+	for (int y = 0 ; y < in.rows ; ++y)
+	{
+		compute_matte_row_avx2(in.ptr<uchar>(y), out.ptr<uchar>(y), in.cols, key, treshold, tolerance);
+	}
+}
+
+void compute_key_distance_host(const cv::Vec3i &color, const cv::Mat &in, cv::Mat &out)
+{
+	assert(in.type() == CV_8UC3);
+
+	out.create(in.size(), CV_8UC1);
+
+	double key[3];
+	compute_matte_key(color, key);
+
+	#pragma omp parallel for
+	for (int y = 0 ; y < in.rows ; ++y)
+	{
+		const uchar *src = in.ptr<uchar>(y);
+		uchar *dst = out.ptr<uchar>(y);
+
+		for (int x = 0 ; x < in.cols ; ++x)
+		{
+			const int grey = compute_grey(src + x * 3, key);
+			dst[x] = uchar(grey > 255 ? 255 : grey);
+		}
+	}
+}
+
+void compute_matte_host(const cv::Vec3i &color, const unsigned int treshold, const unsigned int tolerance, const cv::Mat &in, cv::Mat &out)
+{
+	static const bool avx2 = has_avx2();
+
+	if (avx2)
+	{
+		compute_matte_avx2(color, treshold, tolerance, in, out);
+	}
+	else
+	{
+		compute_matte_scalar(color, treshold, tolerance, in, out);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef COMPUTE_MATTE_HOST_H
+#define COMPUTE_MATTE_HOST_H
+
+// Host implementations of compute_matte_kernel, rows are keyed in parallel. The vectorized version produces exactly the
+// same matte as the scalar reference
+
+bool has_avx2(void);
+
+void compute_matte_scalar(
+	const cv::Vec3i &color,
+	const unsigned int treshold,
+	const unsigned int tolerance,
+	const cv::Mat &in,
+	cv::Mat &out
+);
+
+void compute_matte_avx2(
+	const cv::Vec3i &color,
+	const unsigned int treshold,
+	const unsigned int tolerance,
+	const cv::Mat &in,
+	cv::Mat &out
+);
+
+// Key distance of every pixel on the scale the treshold and tolerance apply to, clamped to 255
+void compute_key_distance_host(
+	const cv::Vec3i &color,
+	const cv::Mat &in,
+	cv::Mat &out
+);
+
+// Picks the AVX2 version when the CPU supports it
+void compute_matte_host(
+	const cv::Vec3i &color,
+	const unsigned int treshold,
+	const unsigned int tolerance,
+	const cv::Mat &in,
+	cv::Mat &out
+);
+
+#endif /* COMPUTE_MATTE_HOST_H */
\ No newline at end of file
@@ -3,4 +3,27 @@
 
 #define iDivUp(a, b) (a % b != 0) ? (a / b + 1) : (a / b)
 
+// Voxels are carved in bricks of 8x8x8, one thread block per brick with the threads in Morton order
+#define MORTON_BRICK_SHIFT 3
+#define MORTON_BRICK_EDGE (1 << MORTON_BRICK_SHIFT)
+#define MORTON_BRICK_VOXELS (MORTON_BRICK_EDGE * MORTON_BRICK_EDGE * MORTON_BRICK_EDGE)
+
+// Tiled image layout, pixels are stored in tiles of 8x8 such that a tile is a couple of cache lines
+#define IMAGE_TILE_SHIFT 3
+#define IMAGE_TILE_EDGE (1 << IMAGE_TILE_SHIFT)
+#define IMAGE_TILE_MASK (IMAGE_TILE_EDGE - 1)
+#define IMAGE_TILE_PIXELS (IMAGE_TILE_EDGE * IMAGE_TILE_EDGE)
+
+// Keep every third bit of a Morton code, x is in bits 0, 3, 6, ..., shift the code by 1 for y and by 2 for z
+__host__ __device__ inline unsigned int morton_compact(unsigned int v)
+{
+	v &= 0x09249249;
+	v = (v ^ (v >> 2)) & 0x030C30C3;
+	v = (v ^ (v >> 4)) & 0x0300F00F;
+	v = (v ^ (v >> 8)) & 0xFF0000FF;
+	v = (v ^ (v >> 16)) & 0x000003FF;
+
+	return v;
+}
+
 #endif /* CUDA_COMMON_H */
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef KEY_MATTE_H
+#define KEY_MATTE_H
+
+// Distance keyer for a single pixel, shared by the matte kernel and the carving kernel when keying is fused into carving
+__device__ __forceinline__ uchar key_matte(const uchar3 pixel, const uint3 color, const uint treshold, const uint tolerance)
+{
+	double i_255 = 1.0 / 255.0;
+
+	float r = float(pixel.x), g = float(pixel.y), b = float(pixel.z);
+
+	float d = ((r * i_255 - color.x * i_255) * (r * i_255 - color.x * i_255)) + ((g * i_255 - color.y * i_255) * (g * i_255 - color.y * i_255)) + ((b * i_255 - color.z * i_255) * (b * i_255 - color.z * i_255));
+
+	// Sqrt hack
+	unsigned int i = *(unsigned int*)&(d);
+	i += 127 << 23;
+	i >>= 1;
+	float distance = *(float*)&i;
+
+	int grey = 255 * distance / sqrt(3.0);
+	if (grey <= treshold)
+	{
+		return 0;
+	}
+	else if (grey >= tolerance)
+	{
+		return 255;
+	}
+
+	return 255 * (grey - treshold) / (tolerance - treshold);
+}
+
+// Keying through a baked table (see key_table.cuh), a single gather per pixel
+__device__ __forceinline__ bool key_table_test(const uint *table, const uchar3 pixel)
+{
+	const uint index = (uint(pixel.x) << 16) | (uint(pixel.y) << 8) | uint(pixel.z);
+
+	return (table[index >> 5] >> (index & 31)) & 1;
+}
+
+#endif /* KEY_MATTE_H */
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include <opencv2/core/core.hpp>
+#include <opencv2/core/cuda_types.hpp>
+
+#include <cuda_runtime.h>
+
+#include <iostream>
+
+#include "cuda_common.cuh"
+#include "key_matte.cuh"
+#include "key_table.cuh"
+
+#include "Exception.h"
+
+// Every thread decides a single colour, every warp writes a word
+__global__
+void build_key_table_kernel(const uint3 *colors, const unsigned int num_colors, const uint treshold, const uint tolerance, uint *table)
+{
+	const uint index = blockIdx.x * blockDim.x + threadIdx.x;
+
+	const uchar3 pixel = make_uchar3((index >> 16) & 255, (index >> 8) & 255, index & 255);
+
+	bool foreground = true;
+	for (unsigned int c = 0 ; c < num_colors && foreground ; ++c)
+	{
+		foreground = key_matte(pixel, colors[c], treshold, tolerance) == 255;
+	}
+
+	const uint word = __ballot(foreground);
+	if ((threadIdx.x & 31) == 0)
+	{
+		table[index >> 5] = word;
+	}
+}
+
+void build_key_table(const uint3 *h_colors, const unsigned int num_colors, const uint treshold, const uint tolerance, uint *table)
+{
+	char b[500];
+
+	uint3 *d_colors = NULL;
+	cudaError_t err = cudaMalloc((void**)&d_colors, sizeof(uint3) * num_colors);
+	if (err != cudaSuccess)
+	{
+		sprintf(b, "Failed to allocate key table colors: %s", cudaGetErrorString(err));
+		throw_line(b);
+	}
+
+	err = cudaMemcpy(d_colors, h_colors, sizeof(uint3) * num_colors, cudaMemcpyHostToDevice);
+	if (err != cudaSuccess)
+	{
+		cudaFree(d_colors);
+
+		sprintf(b, "Failed to upload key table colors: %s", cudaGetErrorString(err));
+		throw_line(b);
+	}
+
+	dim3 blockSize(256);
+	dim3 gridSize = dim3(KEY_TABLE_COLORS / blockSize.x);
+
+	build_key_table_kernel<<<gridSize, blockSize>>>(d_colors, num_colors, treshold, tolerance, table);
+	cudaDeviceSynchronize();
+
+	cudaFree(d_colors);
+
+	err = cudaGetLastError();
+	if (err != cudaSuccess)
+	{
+		sprintf(b, "Failed to build key table: %s", cudaGetErrorString(err));
+		throw_line(b);
+	}
+}
\ No newline at end of file
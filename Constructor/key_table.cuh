@@ -0,0 +1,19 @@
+#ifndef KEY_TABLE_H
+#define KEY_TABLE_H
+
+// The keyer decision for every 8 bit colour, 1 bit per colour. Bit (index & 31) of word (index >> 5) is set if the colour
+// is foreground, the index of a pixel is (x << 16) | (y << 8) | z
+#define KEY_TABLE_COLORS (1 << 24)
+#define KEY_TABLE_WORDS (KEY_TABLE_COLORS >> 5)
+
+// A colour is foreground if the distance keyer fully keys it in for every key color. The table should hold
+// KEY_TABLE_WORDS words of device memory
+void build_key_table(
+	const uint3 *colors,
+	const unsigned int num_colors,
+	const uint treshold,
+	const uint tolerance,
+	uint *table
+);
+
+#endif /* KEY_TABLE_H */
\ No newline at end of file
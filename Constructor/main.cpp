@@ -20,21 +20,29 @@ int main(int argc, char **argv)
 
 	init_cuda();
 
+	int result = EXIT_SUCCESS;
+
+	Constructor c;
 	try
 	{
-		Constructor c;
 		c.Run(argc, argv);
 	}
 	catch (ConstructorException &e)
 	{
 		std::cout << "Exception occurred, halting execution:" << std::endl << e.what() << std::endl;
+
+		result = EXIT_FAILURE;
 	}
 	catch (StopException &e)
 	{
 		std::cout << "CTRL+C, halt." << std::endl;
 	}
 
-	system("pause");
+	// Unattended runs should just exit
+	if (!c.GetSettings().Headless)
+	{
+		system("pause");
+	}
 
-	return EXIT_SUCCESS;
+	return result;
 }
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "Stdafx.h"
+
+#include "morphology_host.h"
+
+// Value of the padding, it never wins the comparison
+typedef struct MinOp
+{
+	static const uchar Identity = 255;
+
+	static inline uchar Apply(const uchar a, const uchar b) { return a < b ? a : b; }
+} MinOp;
+
+typedef struct MaxOp
+{
+	static const uchar Identity = 0;
+
+	static inline uchar Apply(const uchar a, const uchar b) { return a > b ? a : b; }
+} MaxOp;
+
+// The padded signal is split into blocks of the window size. Within every block g holds the running result from the start
+// of the block and h the running result towards the end of the block, a window starting at x then is op(h[x], g[x + 2r])
+
+template<typename Op>
+static void morphology_rows(const cv::Mat &in, cv::Mat &out, const int radius)
+{
+	const int k = 2 * radius + 1;
+	const int n = in.cols;
+	const int m = ((n + 2 * radius + k - 1) / k) * k;
+
+	out.create(in.size(), CV_8UC1);
+
+	#pragma omp parallel
+	{
+		std::vector<uchar> f(m), g(m), h(m);
+
+		#pragma omp for
+		for (int y = 0 ; y < in.rows ; ++y)
+		{
+			memset(&f[0], Op::Identity, radius);
+			memcpy(&f[radius], in.ptr<uchar>(y), n);
+			memset(&f[radius + n], Op::Identity, m - n - radius);
+
+			for (int b = 0 ; b < m ; b += k)
+			{
+				g[b] = f[b];
+				for (int i = b + 1 ; i < b + k ; ++i)
+				{
+					g[i] = Op::Apply(g[i - 1], f[i]);
+				}
+
+				h[b + k - 1] = f[b + k - 1];
+				for (int i = b + k - 2 ; i >= b ; --i)
+				{
+					h[i] = Op::Apply(h[i + 1], f[i]);
+				}
+			}
+
+			uchar *dst = out.ptr<uchar>(y);
+			for (int x = 0 ; x < n ; ++x)
+			{
+				dst[x] = Op::Apply(h[x], g[x + 2 * radius]);
+			}
+		}
+	}
+}
+
+// Padded row j of the input
+static inline const uchar *padded_row(const cv::Mat &in, const int j, const int radius, const uchar *identity)
+{
+	const int y = j - radius;
+
+	return y >= 0 && y < in.rows ? in.ptr<uchar>(y) : identity;
+}
+
+// Same as the rows, whole rows are combined at once and blocks of rows are processed in parallel
+template<typename Op>
+static void morphology_cols(const cv::Mat &in, cv::Mat &out, const int radius)
+{
+	const int k = 2 * radius + 1;
+	const int n = in.rows;
+	const int m = ((n + 2 * radius + k - 1) / k) * k;
+	const int cols = in.cols;
+
+	std::vector<uchar> identity(cols, (uchar)Op::Identity);
+
+	cv::Mat g(m, cols, CV_8UC1), h(m, cols, CV_8UC1);
+
+	#pragma omp parallel for
+	for (int b = 0 ; b < m ; b += k)
+	{
+		memcpy(g.ptr<uchar>(b), padded_row(in, b, radius, &identity[0]), cols);
+		for (int i = b + 1 ; i < b + k ; ++i)
+		{
+			const uchar *f = padded_row(in, i, radius, &identity[0]);
+			const uchar *previous = g.ptr<uchar>(i - 1);
+			uchar *current = g.ptr<uchar>(i);
+
+			for (int x = 0 ; x < cols ; ++x)
+			{
+				current[x] = Op::Apply(previous[x], f[x]);
+			}
+		}
+
+		memcpy(h.ptr<uchar>(b + k - 1), padded_row(in, b + k - 1, radius, &identity[0]), cols);
+		for (int i = b + k - 2 ; i >= b ; --i)
+		{
+			const uchar *f = padded_row(in, i, radius, &identity[0]);
+			const uchar *next = h.ptr<uchar>(i + 1);
+			uchar *current = h.ptr<uchar>(i);
+
+			for (int x = 0 ; x < cols ; ++x)
+			{
+				current[x] = Op::Apply(next[x], f[x]);
+			}
+		}
+	}
+
+	out.create(in.size(), CV_8UC1);
+
+	#pragma omp parallel for
+	for (int y = 0 ; y < n ; ++y)
+	{
+		const uchar *a = h.ptr<uchar>(y);
+		const uchar *b = g.ptr<uchar>(y + 2 * radius);
+		uchar *dst = out.ptr<uchar>(y);
+
+		for (int x = 0 ; x < cols ; ++x)
+		{
+			dst[x] = Op::Apply(a[x], b[x]);
+		}
+	}
+}
+
+void erode_host(const cv::Mat &in, cv::Mat &out, const int radius)
+{
+	assert(in.type() == CV_8UC1);
+
+	if (radius <= 0)
+	{
+		in.copyTo(out);
+		return;
+	}
+
+	cv::Mat rows;
+	morphology_rows<MinOp>(in, rows, radius);
+	morphology_cols<MinOp>(rows, out, radius);
+}
+
+void dilate_host(const cv::Mat &in, cv::Mat &out, const int radius)
+{
+	assert(in.type() == CV_8UC1);
+
+	if (radius <= 0)
+	{
+		in.copyTo(out);
+		return;
+	}
+
+	cv::Mat rows;
+	morphology_rows<MaxOp>(in, rows, radius);
+	morphology_cols<MaxOp>(rows, out, radius);
+}
+
+void open_host(const cv::Mat &in, cv::Mat &out, const int radius)
+{
+	cv::Mat eroded;
+	erode_host(in, eroded, radius);
+	dilate_host(eroded, out, radius);
+}
+
+void close_host(const cv::Mat &in, cv::Mat &out, const int radius)
+{
+	cv::Mat dilated;
+	dilate_host(in, dilated, radius);
+	erode_host(dilated, out, radius);
+}
+
+void fill_holes_host(const cv::Mat &in, cv::Mat &out)
+{
+	assert(in.type() == CV_8UC1);
+
+	// Surround the matte by background such that all background connected to the border is a single region, flood it
+	cv::Mat outside(in.rows + 2, in.cols + 2, CV_8UC1, cv::Scalar(0));
+	in.copyTo(outside(cv::Rect(1, 1, in.cols, in.rows)));
+	cv::floodFill(outside, cv::Point(0, 0), cv::Scalar(128));
+
+	out.create(in.size(), CV_8UC1);
+
+	#pragma omp parallel for
+	for (int y = 0 ; y < in.rows ; ++y)
+	{
+		const uchar *src = outside.ptr<uchar>(y + 1) + 1;
+		uchar *dst = out.ptr<uchar>(y);
+
+		for (int x = 0 ; x < in.cols ; ++x)
+		{
+			dst[x] = src[x] == 128 ? 0 : 255;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef MORPHOLOGY_HOST_H
+#define MORPHOLOGY_HOST_H
+
+// Morphology on 8 bit mattes with a square structuring element of 2 * radius + 1 pixels. The van Herk/Gil-Werman algorithm
+// is used for both passes, the cost per pixel doesn't depend on the radius. Rows (and blocks of rows) are processed in
+// parallel. Pixels outside the image don't affect the result
+
+void erode_host(
+	const cv::Mat &in,
+	cv::Mat &out,
+	const int radius
+);
+
+void dilate_host(
+	const cv::Mat &in,
+	cv::Mat &out,
+	const int radius
+);
+
+// Erosion followed by dilation, removes foreground specks smaller than the structuring element
+void open_host(
+	const cv::Mat &in,
+	cv::Mat &out,
+	const int radius
+);
+
+// Dilation followed by erosion, removes background specks smaller than the structuring element
+void close_host(
+	const cv::Mat &in,
+	cv::Mat &out,
+	const int radius
+);
+
+// Background that isn't connected to the border of the image becomes foreground, expects a binary (0 or 255) matte
+void fill_holes_host(
+	const cv::Mat &in,
+	cv::Mat &out
+);
+
+#endif /* MORPHOLOGY_HOST_H */
\ No newline at end of file
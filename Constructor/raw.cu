@@ -0,0 +1,112 @@
+#include <opencv2/core/core.hpp>
+#include <opencv2/core/cuda_types.hpp>
+
+#include <cuda_runtime.h>
+
+#include <iostream>
+
+#include "cuda_common.cuh"
+#include "yuv_pixel.cuh"
+#include "raw.cuh"
+
+#include "Exception.h"
+
+// Mirror coordinates across the border without repeating it, this keeps their position in the Bayer pattern
+__device__ __forceinline__ int reflect(const int i, const int n)
+{
+	return i < 0 ? -i : (i >= n ? 2 * n - 2 - i : i);
+}
+
+__device__ __forceinline__ int fetch_bayer(const cv::cuda::PtrStepSz<uchar> &in, const int x, const int y)
+{
+	return in(reflect(y, in.rows), reflect(x, in.cols));
+}
+
+__global__
+void convert_bayer_frame_kernel(const cv::cuda::PtrStepSz<uchar> in, const int2 red, cv::cuda::PtrStepSz<uchar3> out)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= out.cols || y >= out.rows)
+	{
+		return;
+	}
+
+	const int center = in(y, x);
+	const int cross = (fetch_bayer(in, x - 1, y) + fetch_bayer(in, x + 1, y) + fetch_bayer(in, x, y - 1) + fetch_bayer(in, x, y + 1) + 2) >> 2;
+	const int diagonal = (fetch_bayer(in, x - 1, y - 1) + fetch_bayer(in, x + 1, y - 1) + fetch_bayer(in, x - 1, y + 1) + fetch_bayer(in, x + 1, y + 1) + 2) >> 2;
+	const int horizontal = (fetch_bayer(in, x - 1, y) + fetch_bayer(in, x + 1, y) + 1) >> 1;
+	const int vertical = (fetch_bayer(in, x, y - 1) + fetch_bayer(in, x, y + 1) + 1) >> 1;
+
+	const bool redColumn = (x & 1) == red.x;
+	const bool redRow = (y & 1) == red.y;
+
+	int r, g, b;
+	if (redRow && redColumn)
+	{
+		r = center; g = cross; b = diagonal;
+	}
+	else if (!redRow && !redColumn)
+	{
+		r = diagonal; g = cross; b = center;
+	}
+	else if (redRow)
+	{
+		r = horizontal; g = center; b = vertical;
+	}
+	else
+	{
+		r = vertical; g = center; b = horizontal;
+	}
+
+	out(y, x) = make_uchar3(b, g, r);
+}
+
+__global__
+void convert_uyvy_frame_kernel(const cv::cuda::PtrStepSz<uchar2> in, cv::cuda::PtrStepSz<uchar3> out)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= out.cols || y >= out.rows)
+	{
+		return;
+	}
+
+	// The chroma of both pixels of a pair is in the first channel, U with the even pixel and V with the odd one
+	const uchar2 chroma = make_uchar2(in(y, x & ~1).x, in(y, x | 1).x);
+
+	out(y, x) = yuv_to_bgr(in(y, x).y, chroma);
+}
+
+static void check_convert_raw_frame(void)
+{
+	cudaStreamSynchronize(cudaStreamPerThread);
+
+	cudaError_t err = cudaGetLastError();
+	if (err != cudaSuccess)
+	{
+		char b[500];
+		sprintf(b, "Failed to convert raw frame: %s", cudaGetErrorString(err));
+		throw_line(b);
+	}
+}
+
+void convert_bayer_frame(const cv::cuda::PtrStepSz<uchar> in, const int2 red, cv::cuda::PtrStepSz<uchar3> out)
+{
+	dim3 blockSize(128, 8);
+	dim3 gridSize = dim3(iDivUp(out.cols, blockSize.x), iDivUp(out.rows, blockSize.y));
+
+	convert_bayer_frame_kernel<<<gridSize, blockSize>>>(in, red, out);
+	check_convert_raw_frame();
+}
+
+void convert_uyvy_frame(const cv::cuda::PtrStepSz<uchar2> in, cv::cuda::PtrStepSz<uchar3> out)
+{
+	dim3 blockSize(128, 8);
+	dim3 gridSize = dim3(iDivUp(out.cols, blockSize.x), iDivUp(out.rows, blockSize.y));
+
+	convert_uyvy_frame_kernel<<<gridSize, blockSize>>>(in, out);
+	check_convert_raw_frame();
+}
\ No newline at end of file
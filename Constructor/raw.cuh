@@ -0,0 +1,19 @@
+#ifndef RAW_H
+#define RAW_H
+
+// Raw frames of capture cards are uploaded as they are stored and converted to BGR on the device. Bayer mosaics are a
+// single 8 bit channel, red sits at (red.x, red.y) of every 2x2 block and blue diagonally across. Colours are
+// interpolated bilinearly
+void convert_bayer_frame(
+	const cv::cuda::PtrStepSz<uchar> in,
+	const int2 red,
+	cv::cuda::PtrStepSz<uchar3> out
+);
+
+// UYVY is 4:2:2, every pair of pixels is stored as U Y0 V Y1. Same BT.601 conversion as I420 frames
+void convert_uyvy_frame(
+	const cv::cuda::PtrStepSz<uchar2> in,
+	cv::cuda::PtrStepSz<uchar3> out
+);
+
+#endif /* RAW_H */
\ No newline at end of file
@@ -10,18 +10,32 @@
 
 #include <iostream>
 #include <chrono>
+#include <cassert>
+#include <climits>
 
 #include "VisibleVoxel.h"
+#include "BrickMap.h"
+
+#include <fstream>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "TileStore.h"
 #include "cuda_common.cuh"
+#include "key_matte.cuh"
+#include "yuv_pixel.cuh"
+#include "silhouette.cuh"
 #include "reconstructor.cuh"
 
 #include "Exception.h"
 
 #define CHECK_ERROR(a) if ((a) != cudaSuccess) { goto error; }
 
-#define DIV 2
+static VisibleVoxel *sd_visible_voxel_storage = NULL;
 
-static VisibleVoxel *sd_visible_voxel_storage;
+// When carving into a brick map only bricks holding voxels are written to the device, the pool grows to the number of
+// occupied bricks of the fullest division and is kept across frames
+static CarvedBrick *sd_brick_pool = NULL;
+static unsigned int sh_brick_capacity;
 
 static unsigned int sh_num_cameras;
 
@@ -31,17 +45,33 @@ static unsigned int sh_depth;
 
 static unsigned int sh_step;
 
+// Number of divisions of the voxel space per axis, each division is carved by its own kernel launch
+static unsigned int sh_div;
+
+// Number of voxels the device storage can hold, this is the size of a single division
+static unsigned long long int sh_capacity;
+
 static int sh_x_l;
 static int sh_y_l;
 static int sh_z_l;
 
-static unsigned int sh_frustum_width;
-static unsigned int sh_frustum_height;
-
 float *sd_r = 0, *sd_t = 0, *sd_a = 0, *sd_k = 0;
 
+// Region of interest per camera as x0, y0, x1, y1 (exclusive), projections outside it are background
+int *sd_roi = 0;
+
+// Volume to world transformation, row major rotation followed by the origin
+float *sd_volume = 0;
+
 static bool s_IsInitialized = false;
 
+// Number of voxels of a division along an axis, rounded up such that no voxels are dropped. The last division along an axis
+// can be partial
+__host__ __device__ inline unsigned int division_size(const unsigned int size, const unsigned int divisions)
+{
+	return (size + divisions - 1) / divisions;
+}
+
 __device__ short2 project_points_for_camera_kernel(
 	float3 point,
 	float *R, 
@@ -82,15 +112,48 @@ __device__ short2 project_points_for_camera_kernel(
 	return make_short2(__float2int_ru(xd * fx + cx), __float2int_ru(yd * fy + cy));
 }
 
+// In the tiled layout the step of an image holds the number of tiles per row in stead of the row pitch in bytes
+template<bool TILED, typename T>
+__device__ __forceinline__ const T &fetch_pixel(const cv::cuda::PtrStepSz<T> &image, const int x, const int y)
+{
+	if (TILED)
+	{
+		return image.data[((y >> IMAGE_TILE_SHIFT) * image.step + (x >> IMAGE_TILE_SHIFT)) * IMAGE_TILE_PIXELS + ((y & IMAGE_TILE_MASK) << IMAGE_TILE_SHIFT) + (x & IMAGE_TILE_MASK)];
+	}
+
+	return image(y, x);
+}
+
+// Colour of a pixel of a BGR frame, or converted from an I420 frame
+template<bool TILED, bool YUV>
+__device__ __forceinline__ uchar3 fetch_color(const cv::cuda::PtrStepSz<uchar3> &frame, const cv::cuda::PtrStepSz<uchar> &yuv, const int x, const int y)
+{
+	if (YUV)
+	{
+		return fetch_yuv(yuv, x, y);
+	}
+
+	return fetch_pixel<TILED>(frame, x, y);
+}
+
+__device__ __forceinline__ bool silhouette_test(const cv::cuda::PtrStepSz<uint> &silhouette, const int x, const int y)
+{
+	return (silhouette(y, x >> SILHOUETTE_WORD_SHIFT) >> (x & SILHOUETTE_WORD_MASK)) & 1;
+}
+
+template<bool TILED, bool YUV>
 __global__
 void update_voxels_kernel(
 	VisibleVoxel					  *visible_voxel_storage, //
-	const cv::cuda::PtrStepSz<uchar>  foregrounds[], 		 // Array of foreground images from cameras
+	const cv::cuda::PtrStepSz<uint>   silhouettes[], 		 // Array of packed silhouettes from cameras
 	const cv::cuda::PtrStepSz<uchar3> frames[], 		     // Array of frames from cameras
+	const cv::cuda::PtrStepSz<uchar>  yuv_frames[], 		 // Array of I420 frames from cameras, in stead of the frames
 	float							  *r,
 	float							  *t,
 	float							  *a,
 	float							  *k,
+	const int						  *roi,
+	const float						  *volume,				 // Volume to world transformation
 	const unsigned int				  num_cameras,			 // Number of cameras
 	const unsigned int				  width,
 	const unsigned int                height,
@@ -98,65 +161,180 @@ void update_voxels_kernel(
 	const int						  x_l,
 	const int						  y_l,
 	const int						  z_l,
-	const unsigned int				  frustum_width,
-	const unsigned int				  frustum_height,
 	const unsigned int                step,
 	unsigned long long int  	      *voxel_pointer,
 	const unsigned int				  m_x,
 	const unsigned int				  m_y,
 	const unsigned int				  m_z,
-	const unsigned int				  part
+	const unsigned int				  part,
+	const int						  o_x,					 // Origin subtracted from the stored voxel coordinates
+	const int						  o_y,
+	const int						  o_z,
+	const fused_key					  *keys,				 // Keys per camera when keying while carving, silhouettes are not used
+	CarvedBrick						  *bricks,				 // Brick pool, in stead of the visible voxel storage
+	unsigned int					  *brick_pointer,
+	const unsigned int				  brick_capacity
 	)
 {
-	const unsigned int xIdx = (m_x * (width / part)) + blockIdx.x * blockDim.x + threadIdx.x;
-	const unsigned int yIdx = (m_y * (height / part)) + blockIdx.y * blockDim.y + threadIdx.y;
-	const unsigned int zIdx = (m_z * (depth / part)) + blockIdx.z * blockDim.z + threadIdx.z;
+	// Occupancy of the brick of this block, one bit per voxel in the order of Brick::VoxelIdx
+	__shared__ unsigned int s_occupancy[MORTON_BRICK_VOXELS / 32];
+	__shared__ unsigned int s_brick;
+
+	// Every block carves a brick, threads walk the brick in Morton order such that neighbouring threads carve neighbouring
+	// voxels in all three dimensions and project to nearby pixels
+	const unsigned int bx = morton_compact(threadIdx.x);
+	const unsigned int by = morton_compact(threadIdx.x >> 1);
+	const unsigned int bz = morton_compact(threadIdx.x >> 2);
+
+	const unsigned int lxIdx = (blockIdx.x << MORTON_BRICK_SHIFT) + bx;
+	const unsigned int lyIdx = (blockIdx.y << MORTON_BRICK_SHIFT) + by;
+	const unsigned int lzIdx = (blockIdx.z << MORTON_BRICK_SHIFT) + bz;
+
+	if (bricks != NULL)
+	{
+		if (threadIdx.x < MORTON_BRICK_VOXELS / 32)
+		{
+			s_occupancy[threadIdx.x] = 0;
+		}
+
+		__syncthreads();
+	}
+
+	// The grid is rounded up to whole blocks, don't spill into the next division. When writing bricks every thread of the
+	// block has to reach the barriers below
+	const unsigned int part_width = division_size(width, part);
+	const unsigned int part_height = division_size(height, part);
+	const unsigned int part_depth = division_size(depth, part);
+
+	const unsigned int xIdx = (m_x * part_width) + lxIdx;
+	const unsigned int yIdx = (m_y * part_height) + lyIdx;
+	const unsigned int zIdx = (m_z * part_depth) + lzIdx;
+
+	const bool inside = lxIdx < part_width && lyIdx < part_height && lzIdx < part_depth && xIdx < width && yIdx < height && zIdx < depth;
+	if (!inside && bricks == NULL)
+	{
+		return;
+	}
 
 	const int x = x_l + xIdx * step;
 	const int y = y_l + yIdx * step;
 	const int z = z_l + zIdx * step;
 
+	// Carving iterates in volume coordinates, project the world position
+	float3 p;
+	p.x = volume[0] * x + volume[1] * y + volume[2] * z + volume[9];
+	p.y = volume[3] * x + volume[4] * y + volume[5] * z + volume[10];
+	p.z = volume[6] * x + volume[7] * y + volume[8] * z + volume[11];
+
 	int t_r, t_g, t_b;
 	t_r = t_g = t_b = 0;
 
 	int v = 0;
-	for (int i = 0 ; i < num_cameras ; ++i)
+	for (int i = 0 ; inside && i < num_cameras ; ++i)
 	{
-		float3 p;
-		p.x = x;
-		p.y = y;
-		p.z = z;
-
 		float R[9], T[3], A[9], K[12];
 		memcpy(R, r + (i * 9), sizeof(float) * 9);
 		memcpy(T, t + (i * 3), sizeof(float) * 3);
 		memcpy(A, a + (i * 9), sizeof(float) * 9);
 		memcpy(K, k + (i * 12), sizeof(float) * 12);
 
+		// Outside the region of interest is background, without sampling the silhouette
 		short2 point = project_points_for_camera_kernel(p, R, T, A, K, i);
-		if ((point.x >= 0 && point.x < frustum_width && point.y >= 0 && point.y < frustum_height))
+		if ((point.x >= roi[i * 4] && point.x < roi[i * 4 + 2] && point.y >= roi[i * 4 + 1] && point.y < roi[i * 4 + 3]))
 		{
 			// Has white pixel in matte?
-			uchar pixel = foregrounds[i](point.y, point.x);
-			if (pixel == 255)
+			uchar3 color;
+			bool foreground;
+			if (keys != NULL)
+			{
+				const fused_key &key = keys[i];
+
+				// Only garbage masks are passed as silhouettes, masked pixels aren't keyed. The colour is needed for the voxel
+				// anyway, key it in stead of reading a matte
+				foreground = silhouettes[i].data == NULL || silhouette_test(silhouettes[i], point.x, point.y);
+				if (foreground)
+				{
+					color = fetch_color<TILED, YUV>(frames[i], yuv_frames[i], point.x, point.y);
+					foreground = key.table != NULL ? key_table_test(key.table, color) : key_matte(color, key.color, key.treshold, key.tolerance) == 255;
+				}
+			}
+			else
+			{
+				// Packed silhouettes are already an eighth of the matte, they are not tiled
+				foreground = silhouette_test(silhouettes[i], point.x, point.y);
+			}
+
+			if (foreground)
 			{
 				++v;
 
-				t_r += frames[i](point.y, point.x).x;
-				t_g += frames[i](point.y, point.x).y;
-				t_b += frames[i](point.y, point.x).z;
+				if (keys == NULL)
+				{
+					color = fetch_color<TILED, YUV>(frames[i], yuv_frames[i], point.x, point.y);
+				}
+
+				t_r += color.x;
+				t_g += color.y;
+				t_b += color.z;
 			}
 		}
 	}
 
-	if (v >= num_cameras)
+	const bool visible = inside && v >= num_cameras;
+
+	if (bricks != NULL)
+	{
+		const unsigned int bit = (bz << (MORTON_BRICK_SHIFT * 2)) | (by << MORTON_BRICK_SHIFT) | bx;
+		if (visible)
+		{
+			atomicOr(&s_occupancy[bit >> 5], 1u << (bit & 31));
+		}
+
+		// Empty bricks are not written at all
+		if (!__syncthreads_or(visible))
+		{
+			return;
+		}
+
+		if (threadIdx.x == 0)
+		{
+			s_brick = atomicAdd(brick_pointer, 1);
+		}
+
+		__syncthreads();
+
+		// The pool overflowed, the host grows it to the number of bricks counted and carves the division again
+		if (s_brick >= brick_capacity)
+		{
+			return;
+		}
+
+		CarvedBrick &brick = bricks[s_brick];
+		if (threadIdx.x == 0)
+		{
+			brick.X = x - (int)bx * (int)step;
+			brick.Y = y - (int)by * (int)step;
+			brick.Z = z - (int)bz * (int)step;
+		}
+
+		if (threadIdx.x < BRICK_WORDS)
+		{
+			brick.Occupancy[threadIdx.x] = s_occupancy[threadIdx.x * 2] | ((unsigned long long int)s_occupancy[threadIdx.x * 2 + 1] << 32);
+		}
+
+		brick.Colors[bit] = visible ? ((t_r / v) << 16) | ((t_g / v) << 8) | (t_b / v) : 0;
+
+		return;
+	}
+
+	if (visible)
 	{
 		unsigned long long int vIdx = atomicAdd(voxel_pointer, 1);
 
 		// Push the voxel into the set of visible voxels
-		visible_voxel_storage[vIdx].X = x;
-		visible_voxel_storage[vIdx].Y = y;
-		visible_voxel_storage[vIdx].Z = z;
+		visible_voxel_storage[vIdx].X = x - o_x;
+		visible_voxel_storage[vIdx].Y = y - o_y;
+		visible_voxel_storage[vIdx].Z = z - o_z;
 
 		visible_voxel_storage[vIdx].R = t_r / v;
 		visible_voxel_storage[vIdx].G = t_g / v;
@@ -165,78 +343,183 @@ void update_voxels_kernel(
 }
 
 bool update_voxels(
-	const cv::cuda::GpuMat *h_gputmat_foregrounds,
+	const cv::cuda::GpuMat *h_gputmat_silhouettes,
 	const cv::cuda::GpuMat *h_gputmat_frames,
 	unsigned long long int *h_num_voxels,
-	VisibleVoxel		   **h_visible_voxels
+	VisibleVoxel		   **h_visible_voxels,
+	BrickMap			   *h_brick_map,
+	TileStore			   *h_tile_store,
+	const cv::cuda::GpuMat *h_gpumat_tiled_frames,
+	const bool			   h_yuv_frames,
+	const fused_key		   *h_keys
 	)
 {
-	cv::cuda::PtrStepSz<uchar> *h_foregrounds = new cv::cuda::PtrStepSz<uchar>[sh_num_cameras];
+	cv::cuda::PtrStepSz<uint> *h_silhouettes = new cv::cuda::PtrStepSz<uint>[sh_num_cameras];
 	cv::cuda::PtrStepSz<uchar3> *h_frames = new cv::cuda::PtrStepSz<uchar3>[sh_num_cameras];
+	cv::cuda::PtrStepSz<uchar> *h_yuv = new cv::cuda::PtrStepSz<uchar>[sh_num_cameras];
+
 	for (int i = 0 ; i < sh_num_cameras ; ++i)
 	{
-		h_foregrounds[i] = h_gputmat_foregrounds[i];
-		h_frames[i] = h_gputmat_frames[i];
+		h_silhouettes[i] = h_gputmat_silhouettes[i];
+
+		// The kernel converts the colours of the carved voxels only
+		if (h_yuv_frames)
+		{
+			h_yuv[i] = h_gputmat_frames[i];
+		}
+		else
+		{
+			h_frames[i] = h_gputmat_frames[i];
+		}
+
+		// The tiled copies are made along with the silhouettes, the step of a tiled image holds the number of tiles per row
+		if (h_gpumat_tiled_frames != NULL)
+		{
+			h_frames[i] = cv::cuda::PtrStepSz<uchar3>(h_frames[i].rows, h_frames[i].cols, (uchar3*)h_gpumat_tiled_frames[i].data, iDivUp(h_frames[i].cols, IMAGE_TILE_EDGE));
+		}
 	}
 
+	// When storing into a tile store each division is downloaded into a scratch buffer and spilled, when storing into a brick map
+	// only the occupied bricks of a division are downloaded and folded into the map. The flat list of visible voxels is never
+	// materialized
+	VisibleVoxel *h_scratch = NULL;
+	CarvedBrick *h_bricks = NULL;
+
 	unsigned long long int h_voxel_pointer, *d_voxel_pointer;
-	cudaMalloc((void**)&d_voxel_pointer, sizeof(int));
-	h_voxel_pointer = 0;
-	cudaMemcpy(d_voxel_pointer, &h_voxel_pointer, sizeof(unsigned long long int), cudaMemcpyHostToDevice);
+	cudaMalloc((void**)&d_voxel_pointer, sizeof(unsigned long long int));
+
+	unsigned int h_brick_pointer, *d_brick_pointer = NULL;
+	if (h_brick_map != NULL && cudaMalloc((void**)&d_brick_pointer, sizeof(unsigned int)) != cudaSuccess)
+	{
+		goto error;
+	}
 
-	cv::cuda::PtrStepSz<uchar> *d_foregrounds = 0;
-	CHECK_ERROR(cudaMalloc((void**)&d_foregrounds, sizeof(cv::cuda::PtrStepSz<uchar>) * sh_num_cameras));
-	CHECK_ERROR(cudaMemcpy(d_foregrounds, h_foregrounds, sizeof(cv::cuda::PtrStepSz<uchar>) * sh_num_cameras, cudaMemcpyHostToDevice));
+	cv::cuda::PtrStepSz<uint> *d_silhouettes = 0;
+	CHECK_ERROR(cudaMalloc((void**)&d_silhouettes, sizeof(cv::cuda::PtrStepSz<uint>) * sh_num_cameras));
+	CHECK_ERROR(cudaMemcpy(d_silhouettes, h_silhouettes, sizeof(cv::cuda::PtrStepSz<uint>) * sh_num_cameras, cudaMemcpyHostToDevice));
 
 	cv::cuda::PtrStepSz<uchar3> *d_frames = 0;
 	CHECK_ERROR(cudaMalloc((void**)&d_frames, sizeof(cv::cuda::PtrStepSz<uchar3>) * sh_num_cameras));
 	CHECK_ERROR(cudaMemcpy(d_frames, h_frames, sizeof(cv::cuda::PtrStepSz<uchar3>) * sh_num_cameras, cudaMemcpyHostToDevice));
 
+	cv::cuda::PtrStepSz<uchar> *d_yuv = 0;
+	CHECK_ERROR(cudaMalloc((void**)&d_yuv, sizeof(cv::cuda::PtrStepSz<uchar>) * sh_num_cameras));
+	CHECK_ERROR(cudaMemcpy(d_yuv, h_yuv, sizeof(cv::cuda::PtrStepSz<uchar>) * sh_num_cameras, cudaMemcpyHostToDevice));
+
+	fused_key *d_keys = NULL;
+	if (h_keys != NULL)
+	{
+		CHECK_ERROR(cudaMalloc((void**)&d_keys, sizeof(fused_key) * sh_num_cameras));
+		CHECK_ERROR(cudaMemcpy(d_keys, h_keys, sizeof(fused_key) * sh_num_cameras, cudaMemcpyHostToDevice));
+	}
+
 	*h_visible_voxels = NULL;
 
 	// Divide the voxel space into equal divisions to reducs vram usage
+	const unsigned int part_width = division_size(sh_width, sh_div);
+	const unsigned int part_height = division_size(sh_height, sh_div);
+	const unsigned int part_depth = division_size(sh_depth, sh_div);
+
+	// Tile voxels are stored in 16 bits relative to the origin of their division, which the reconstructor guarantees
+	assert(h_tile_store == NULL || ((part_width - 1) * sh_step <= SHRT_MAX && (part_height - 1) * sh_step <= SHRT_MAX && (part_depth - 1) * sh_step <= SHRT_MAX));
+
 	long total_voxels = 0;
-	for (int x = 0 ; x < DIV ; ++x)
+	for (int x = 0 ; x < sh_div ; ++x)
 	{
-		for (int y = 0 ; y < DIV ; ++y)
+		for (int y = 0 ; y < sh_div ; ++y)
 		{
-			for (int z = 0 ; z < DIV ; ++z)
+			for (int z = 0 ; z < sh_div ; ++z)
 			{
-				dim3 block_size(16, 8, 8);
-				dim3 grid_size = dim3(iDivUp(sh_width / DIV, block_size.x), iDivUp(sh_height / DIV, block_size.y), iDivUp(sh_depth / DIV, block_size.z));
-				update_voxels_kernel <<<grid_size, block_size>>>(
-					sd_visible_voxel_storage,
-					d_foregrounds,
-					d_frames,
-					sd_r,
-					sd_t,
-					sd_a,
-					sd_k,
-					sh_num_cameras,
-					sh_width,
-					sh_height,
-					sh_depth,
-					sh_x_l,
-					sh_y_l,
-					sh_z_l,
-					sh_frustum_width,
-					sh_frustum_height,
-					sh_step,
-					d_voxel_pointer,
-					x,
-					y,
-					z,
-					DIV
-				);
-
-				if (cudaDeviceSynchronize() != cudaSuccess)
+				// When spilling tiles the voxels are stored relative to the origin of their division
+				int o_x = 0, o_y = 0, o_z = 0;
+				if (h_tile_store != NULL)
+				{
+					o_x = sh_x_l + x * part_width * sh_step;
+					o_y = sh_y_l + y * part_height * sh_step;
+					o_z = sh_z_l + z * part_depth * sh_step;
+				}
+
+				// One block per brick of the division
+				dim3 block_size(MORTON_BRICK_VOXELS);
+				dim3 grid_size = dim3(iDivUp(part_width, MORTON_BRICK_EDGE), iDivUp(part_height, MORTON_BRICK_EDGE), iDivUp(part_depth, MORTON_BRICK_EDGE));
+
+				// When the brick pool overflows it is grown to the number of occupied bricks and the division is carved again
+				bool carved = false;
+				while (!carved)
 				{
-					std::cout << "Failed to initialize voxels..." << std::endl;
-					goto error;
+					// Every division starts at the beginning of the device storage
+					h_voxel_pointer = 0;
+					cudaMemcpy(d_voxel_pointer, &h_voxel_pointer, sizeof(unsigned long long int), cudaMemcpyHostToDevice);
+
+					h_brick_pointer = 0;
+					CarvedBrick *d_bricks = NULL;
+					if (h_brick_map != NULL)
+					{
+						cudaMemcpy(d_brick_pointer, &h_brick_pointer, sizeof(unsigned int), cudaMemcpyHostToDevice);
+						d_bricks = sd_brick_pool;
+					}
+
+					if (h_yuv_frames)
+					{
+						update_voxels_kernel<false, true> <<<grid_size, block_size>>>(sd_visible_voxel_storage, d_silhouettes, d_frames, d_yuv, sd_r, sd_t, sd_a, sd_k, sd_roi, sd_volume, sh_num_cameras, sh_width, sh_height, sh_depth, sh_x_l, sh_y_l, sh_z_l, sh_step, d_voxel_pointer, x, y, z, sh_div, o_x, o_y, o_z, d_keys, d_bricks, d_brick_pointer, sh_brick_capacity);
+					}
+					else if (h_gpumat_tiled_frames != NULL)
+					{
+						update_voxels_kernel<true, false> <<<grid_size, block_size>>>(sd_visible_voxel_storage, d_silhouettes, d_frames, d_yuv, sd_r, sd_t, sd_a, sd_k, sd_roi, sd_volume, sh_num_cameras, sh_width, sh_height, sh_depth, sh_x_l, sh_y_l, sh_z_l, sh_step, d_voxel_pointer, x, y, z, sh_div, o_x, o_y, o_z, d_keys, d_bricks, d_brick_pointer, sh_brick_capacity);
+					}
+					else
+					{
+						update_voxels_kernel<false, false> <<<grid_size, block_size>>>(sd_visible_voxel_storage, d_silhouettes, d_frames, d_yuv, sd_r, sd_t, sd_a, sd_k, sd_roi, sd_volume, sh_num_cameras, sh_width, sh_height, sh_depth, sh_x_l, sh_y_l, sh_z_l, sh_step, d_voxel_pointer, x, y, z, sh_div, o_x, o_y, o_z, d_keys, d_bricks, d_brick_pointer, sh_brick_capacity);
+					}
+
+					if (cudaDeviceSynchronize() != cudaSuccess)
+					{
+						std::cout << "Failed to initialize voxels..." << std::endl;
+						goto error;
+					}
+
+					carved = true;
+					if (h_brick_map != NULL)
+					{
+						cudaMemcpy(&h_brick_pointer, d_brick_pointer, sizeof(unsigned int), cudaMemcpyDeviceToHost);
+						if (h_brick_pointer > sh_brick_capacity)
+						{
+							std::cout << "Growing device brick pool to " << h_brick_pointer << " bricks (" << (h_brick_pointer * sizeof(CarvedBrick)) / 1000000 << " MB)" << std::endl;
+
+							cudaFree(sd_brick_pool);
+							sh_brick_capacity = 0;
+							CHECK_ERROR(cudaMalloc((void**)&sd_brick_pool, sizeof(CarvedBrick) * h_brick_pointer));
+							sh_brick_capacity = h_brick_pointer;
+
+							carved = false;
+						}
+					}
 				}
 
 				// Fetch number of visible voxels from kernel
-				cudaMemcpy(&h_voxel_pointer, d_voxel_pointer, sizeof(int), cudaMemcpyDeviceToHost);
+				cudaMemcpy(&h_voxel_pointer, d_voxel_pointer, sizeof(unsigned long long int), cudaMemcpyDeviceToHost);
+
+				if (h_tile_store != NULL)
+				{
+					h_scratch = (VisibleVoxel*) realloc(h_scratch, sizeof(VisibleVoxel) * h_voxel_pointer);
+					cudaMemcpy(h_scratch, sd_visible_voxel_storage, sizeof(VisibleVoxel) * h_voxel_pointer, cudaMemcpyDeviceToHost);
+
+					// Spill the division to disk as a tile
+					h_tile_store->AddTile(o_x, o_y, o_z, h_scratch, h_voxel_pointer);
+
+					continue;
+				}
+
+				// Only the occupied bricks of the division are downloaded
+				if (h_brick_map != NULL)
+				{
+					h_bricks = (CarvedBrick*) realloc(h_bricks, sizeof(CarvedBrick) * h_brick_pointer);
+					cudaMemcpy(h_bricks, sd_brick_pool, sizeof(CarvedBrick) * h_brick_pointer, cudaMemcpyDeviceToHost);
+
+					h_brick_map->Insert(h_bricks, h_brick_pointer, sh_step);
+
+					continue;
+				}
 
 				// Create memory to store the visible voxels
 				*h_visible_voxels = (VisibleVoxel*) realloc(*h_visible_voxels, sizeof(VisibleVoxel) * (h_voxel_pointer + total_voxels));
@@ -251,15 +534,32 @@ bool update_voxels(
 		}
 	}
 
+	if (h_tile_store != NULL)
+	{
+		h_tile_store->Flush();
+		total_voxels = h_tile_store->GetNumVoxels();
+	}
+	else if (h_brick_map != NULL)
+	{
+		total_voxels = h_brick_map->GetNumVoxels();
+	}
+
 	*h_num_voxels = total_voxels;
 
 	// House keeping
-	delete[] h_foregrounds;
+	free(h_scratch);
+	free(h_bricks);
+
+	delete[] h_silhouettes;
 	delete[] h_frames;
+	delete[] h_yuv;
 
 	cudaFree(d_frames);
-	cudaFree(d_foregrounds);
+	cudaFree(d_yuv);
+	cudaFree(d_keys);
+	cudaFree(d_silhouettes);
 	cudaFree(d_voxel_pointer);
+	cudaFree(d_brick_pointer);
 
 	return EXIT_SUCCESS;
 error:
@@ -272,11 +572,54 @@ error:
 	return EXIT_FAILURE;
 }
 
+bool configure_voxels(
+	const int			   x_l,
+	const int			   x_r,
+	const int			   y_l,
+	const int              y_r,
+	const int              z_l,
+	const int              z_r,
+	const unsigned int     step
+	)
+{
+	if (!s_IsInitialized)
+	{
+		return EXIT_FAILURE;
+	}
+
+	const unsigned int voxel_space_width = (x_r - x_l) / step;
+	const unsigned int voxel_space_height = (y_r - y_l) / step;
+	const unsigned int voxel_space_depth = (z_r - z_l) / step;
+
+	// A single division should fit the storage that was allocated at initialization
+	unsigned long long int num_voxels = division_size(voxel_space_width, sh_div);
+	num_voxels *= division_size(voxel_space_height, sh_div);
+	num_voxels *= division_size(voxel_space_depth, sh_div);
+	if (sd_visible_voxel_storage != NULL && num_voxels > sh_capacity)
+	{
+		return EXIT_FAILURE;
+	}
+
+	sh_width = voxel_space_width;
+	sh_height = voxel_space_height;
+	sh_depth = voxel_space_depth;
+
+	sh_step = step;
+
+	sh_x_l = x_l;
+	sh_y_l = y_l;
+	sh_z_l = z_l;
+
+	return EXIT_SUCCESS;
+}
+
 bool initialize_voxels(
 	float			       *h_r,
 	float                  *h_t,
 	float				   *h_a,
 	float				   *h_k,
+	int					   *h_roi,
+	float				   *h_volume,
 	const unsigned int	   num_cameras,
 	const int			   x_l,
 	const int			   x_r,
@@ -285,8 +628,8 @@ bool initialize_voxels(
 	const int              z_l,
 	const int              z_r,
 	const unsigned int     step,
-	const unsigned int     frustum_width,
-	const unsigned int     frustum_height,
+	const unsigned int     divisions,
+	const bool			   bricks,
 	int					   *total_voxels
 	)
 {
@@ -304,35 +647,50 @@ bool initialize_voxels(
 	sh_height = voxel_space_height;
 	sh_depth = voxel_space_depth;
 
-	sh_frustum_width = frustum_width;
-	sh_frustum_height = frustum_height;
-
 	sh_step = step;
+	sh_div = divisions;
 
 	sh_x_l = x_l;
 	sh_y_l = y_l;
 	sh_z_l = z_l;
 
-	unsigned long long int num_voxels = voxel_space_width;
-	num_voxels *= voxel_space_height;
-	num_voxels *= voxel_space_depth;
-	num_voxels /= pow(DIV, 3);
+	// Divisions are rounded up, the storage holds the largest division
+	unsigned long long int num_voxels = division_size(voxel_space_width, divisions);
+	num_voxels *= division_size(voxel_space_height, divisions);
+	num_voxels *= division_size(voxel_space_depth, divisions);
 
 	*total_voxels = num_voxels;
 
+	sh_capacity = num_voxels;
+
 	std::cout << "Number of voxels per CUDA kernel: " << num_voxels << std::endl;
-	std::cout << "Total number of voxels: " << num_voxels * pow(DIV, 3) << std::endl;
+	std::cout << "Total number of voxels: " << (unsigned long long int)voxel_space_width * voxel_space_height * voxel_space_depth << std::endl;
 
 	sh_num_cameras = num_cameras;
 
 	// Since when we're destroying we're deallocating memory of voxel storage, we state that we're intitialized at this point
 	s_IsInitialized = true;
 
-	// Create storage for visible voxels (device)
-	std::cout << "Allocating " << (num_voxels * sizeof(VisibleVoxel)) / 1000000 << " MB of memory for visible voxel storage" << std::endl;
-	if (cudaMalloc((void**)&sd_visible_voxel_storage, (num_voxels * sizeof(VisibleVoxel))) != cudaSuccess)
+	if (bricks)
 	{
-		goto error;
+		// Start the brick pool at an eighth of the bricks of a division, it grows as needed
+		const unsigned long long int num_bricks = (unsigned long long int)(iDivUp(division_size(voxel_space_width, divisions), MORTON_BRICK_EDGE)) * (iDivUp(division_size(voxel_space_height, divisions), MORTON_BRICK_EDGE)) * (iDivUp(division_size(voxel_space_depth, divisions), MORTON_BRICK_EDGE));
+		sh_brick_capacity = (unsigned int)(num_bricks / 8 > 0 ? num_bricks / 8 : 1);
+
+		std::cout << "Allocating " << (sh_brick_capacity * sizeof(CarvedBrick)) / 1000000 << " MB of memory for " << sh_brick_capacity << " device bricks" << std::endl;
+		if (cudaMalloc((void**)&sd_brick_pool, sh_brick_capacity * sizeof(CarvedBrick)) != cudaSuccess)
+		{
+			goto error;
+		}
+	}
+	else
+	{
+		// Create storage for visible voxels (device)
+		std::cout << "Allocating " << (num_voxels * sizeof(VisibleVoxel)) / 1000000 << " MB of memory for visible voxel storage" << std::endl;
+		if (cudaMalloc((void**)&sd_visible_voxel_storage, (num_voxels * sizeof(VisibleVoxel))) != cudaSuccess)
+		{
+			goto error;
+		}
 	}
 
 	// Copy host R, T, K and D to device
@@ -340,12 +698,16 @@ bool initialize_voxels(
 	cudaMalloc((void**)&sd_t, sizeof(float) * num_cameras * 3);
 	cudaMalloc((void**)&sd_a, sizeof(float) * num_cameras * 9);
 	cudaMalloc((void**)&sd_k, sizeof(float) * num_cameras * 12);
+	cudaMalloc((void**)&sd_roi, sizeof(int) * num_cameras * 4);
+	cudaMalloc((void**)&sd_volume, sizeof(float) * 12);
 
 	// Copy
 	cudaMemcpy(sd_r, h_r, sizeof(float) * num_cameras * 9, cudaMemcpyHostToDevice);
 	cudaMemcpy(sd_t, h_t, sizeof(float) * num_cameras * 3, cudaMemcpyHostToDevice);
 	cudaMemcpy(sd_a, h_a, sizeof(float) * num_cameras * 9, cudaMemcpyHostToDevice);
 	cudaMemcpy(sd_k, h_k, sizeof(float) * num_cameras * 12, cudaMemcpyHostToDevice);
+	cudaMemcpy(sd_roi, h_roi, sizeof(int) * num_cameras * 4, cudaMemcpyHostToDevice);
+	cudaMemcpy(sd_volume, h_volume, sizeof(float) * 12, cudaMemcpyHostToDevice);
 
 	return EXIT_SUCCESS;
 error:
@@ -371,11 +733,17 @@ bool destroy_voxels(void)
 
 	// Free the voxel storage
 	cudaFree(sd_visible_voxel_storage);
+	cudaFree(sd_brick_pool);
+
+	sd_visible_voxel_storage = NULL;
+	sd_brick_pool = NULL;
 
 	cudaFree(sd_a);
 	cudaFree(sd_k);
 	cudaFree(sd_t);
 	cudaFree(sd_r);
+	cudaFree(sd_roi);
+	cudaFree(sd_volume);
 
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -1,6 +1,17 @@
 #ifndef RECONSTRUCTOR_H
 #define RECONSTRUCTOR_H
 
+// Keying applied by the carving kernel to the colour of the projected pixel, in stead of reading a matte. Carving takes
+// a key per camera, or none to carve the silhouettes. When a key table (see key_table.cuh) is given it replaces the
+// distance keyer
+typedef struct fused_key
+{
+	uint3 color;
+	unsigned int treshold;
+	unsigned int tolerance;
+	const unsigned int *table;
+} fused_key;
+
 bool destroy_voxels(void);
 
 bool initialize_voxels(
@@ -8,6 +19,8 @@ bool initialize_voxels(
 	float                  *h_t,
 	float				   *h_a,
 	float				   *h_k,
+	int					   *h_roi,
+	float				   *h_volume,
 	const unsigned int	   num_cameras,
 	const int			   x_l,
 	const int			   x_r,
@@ -16,16 +29,31 @@ bool initialize_voxels(
 	const int              z_l,
 	const int              z_r,
 	const unsigned int     step,
-	const unsigned int     plane_width,
-	const unsigned int     plane_height,
+	const unsigned int     divisions,
+	const bool			   bricks,
 	int					   *total_voxels
 );
 
+bool configure_voxels(
+	const int			   x_l,
+	const int			   x_r,
+	const int			   y_l,
+	const int              y_r,
+	const int              z_l,
+	const int              z_r,
+	const unsigned int     step
+);
+
 bool update_voxels(
-	const cv::cuda::GpuMat *h_gputmat_foregrounds,
+	const cv::cuda::GpuMat *h_gputmat_silhouettes,
 	const cv::cuda::GpuMat *h_gputmat_frames,
 	unsigned long long int *h_num_voxels,
-	VisibleVoxel		   **h_visible_voxels
+	VisibleVoxel		   **h_visible_voxels,
+	BrickMap			   *h_brick_map,
+	TileStore			   *h_tile_store,
+	const cv::cuda::GpuMat *h_gpumat_tiled_frames,
+	const bool			   h_yuv_frames,
+	const fused_key		   *h_keys
 );
 
 #endif /* VOXEL_H */
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include <opencv2/core/core.hpp>
+#include <opencv2/core/cuda_types.hpp>
+
+#include <cuda_runtime.h>
+
+#include <iostream>
+
+#include "cuda_common.cuh"
+#include "key_matte.cuh"
+#include "yuv_pixel.cuh"
+#include "silhouette.cuh"
+
+#include "Exception.h"
+
+__device__ __forceinline__ bool mask_test(const cv::cuda::PtrStepSz<uint> &mask, const uint x, const uint y)
+{
+	return mask.data == NULL || ((mask(y, x >> SILHOUETTE_WORD_SHIFT) >> (x & SILHOUETTE_WORD_MASK)) & 1);
+}
+
+// Every warp handles 32 consecutive pixels of a row and writes them as a single word, blockDim.x should be a multiple of 32
+__global__
+void pack_silhouette_kernel(const cv::cuda::PtrStepSz<uchar> in, const cv::cuda::PtrStepSz<uint> mask, cv::cuda::PtrStepSz<uint> out)
+{
+	uint x = blockIdx.x * blockDim.x + threadIdx.x;
+	uint y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	// No early return, the whole warp has to take part in the ballot
+	const bool inside = x < in.cols && y < in.rows;
+	const uint word = __ballot(inside && in(y, x) == 255);
+
+	if (inside && (threadIdx.x & SILHOUETTE_WORD_MASK) == 0)
+	{
+		out(y, x >> SILHOUETTE_WORD_SHIFT) = mask.data == NULL ? word : word & mask(y, x >> SILHOUETTE_WORD_SHIFT);
+	}
+}
+
+// The grid covers the region of interest (x0, y0) -> (x1, y1) only, it starts at the word holding x0 such that warps
+// still cover whole words. With a key table the colour is looked up in stead of keyed
+template<bool TABLE>
+__global__
+void compute_silhouette_kernel(const uint3 color, const uint treshold, const uint tolerance, const uint *table, const cv::cuda::PtrStepSz<uchar3> in, const cv::cuda::PtrStepSz<uint> mask, const uint x0, const uint y0, const uint x1, const uint y1, cv::cuda::PtrStepSz<uint> out)
+{
+	uint x = (x0 & ~SILHOUETTE_WORD_MASK) + blockIdx.x * blockDim.x + threadIdx.x;
+	uint y = y0 + blockIdx.y * blockDim.y + threadIdx.y;
+
+	// Pixels outside the region and masked pixels are not fetched nor keyed
+	const bool inside = x < x1 && y < y1;
+	const uint word = __ballot(inside && x >= x0 && mask_test(mask, x, y) && (TABLE ? key_table_test(table, in(y, x)) : key_matte(in(y, x), color, treshold, tolerance) == 255));
+
+	if (inside && (threadIdx.x & SILHOUETTE_WORD_MASK) == 0)
+	{
+		out(y, x >> SILHOUETTE_WORD_SHIFT) = word;
+	}
+}
+
+// Doubles every bit of the lower 16 bits, bit i moves to bits 2i and 2i + 1
+__device__ __forceinline__ uint spread_bits(uint v)
+{
+	v = (v | (v << 8)) & 0x00FF00FF;
+	v = (v | (v << 4)) & 0x0F0F0F0F;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+
+	return v | (v << 1);
+}
+
+// Keys I420 frames at chroma resolution, every thread keys a chroma sample which covers 2x2 pixels. The grid covers the
+// chroma samples of the region of interest (cx0, cy0) -> (cx1, cy1), starting at a multiple of 32 samples such that a
+// warp covers two words of two rows of the silhouette
+__global__
+void compute_silhouette_yuv_kernel(const uint2 color, const uint treshold, const uint tolerance, const cv::cuda::PtrStepSz<uchar> in, const uint height, const cv::cuda::PtrStepSz<uint> mask, const uint cx0, const uint cy0, const uint cx1, const uint cy1, cv::cuda::PtrStepSz<uint> out)
+{
+	uint cx = (cx0 & ~SILHOUETTE_WORD_MASK) + blockIdx.x * blockDim.x + threadIdx.x;
+	uint cy = cy0 + blockIdx.y * blockDim.y + threadIdx.y;
+
+	const bool inside = cx < cx1 && cy < cy1;
+	const uint word = __ballot(inside && cx >= cx0 && key_chroma(fetch_chroma(in, height, cx, cy), color, treshold, tolerance) == 255);
+
+	// The first two threads of the warp write the lower and upper half. Pixels of the edge samples that lie outside the
+	// region are cleared by the mask, which holds the region whenever it isn't the whole frame
+	const uint half = threadIdx.x & SILHOUETTE_WORD_MASK;
+	if (inside && half < 2)
+	{
+		const uint bits = spread_bits(half ? word >> 16 : word & 0xFFFF);
+		const uint w = (((cx & ~SILHOUETTE_WORD_MASK) << 1) >> SILHOUETTE_WORD_SHIFT) + half;
+
+		for (uint y = cy << 1 ; w < out.cols && y < (cy << 1) + 2 ; ++y)
+		{
+			out(y, w) = mask.data == NULL ? bits : bits & mask(y, w);
+		}
+	}
+}
+
+void pack_silhouette(const cv::cuda::PtrStepSz<uchar> in, const cv::cuda::PtrStepSz<uint> mask, cv::cuda::PtrStepSz<uint> out)
+{
+	dim3 blockSize(128, 8);
+	dim3 gridSize = dim3(iDivUp(in.cols, blockSize.x), iDivUp(in.rows, blockSize.y));
+
+	// Cameras are segmented from several threads, every thread launches on its own default stream and only waits for that
+	pack_silhouette_kernel<<<gridSize, blockSize>>>(in, mask, out);
+	cudaStreamSynchronize(cudaStreamPerThread);
+
+	cudaError_t err = cudaGetLastError();
+	if (err != cudaSuccess)
+	{
+		char b[500];
+		sprintf(b, "Failed to pack silhouette: %s", cudaGetErrorString(err));
+		throw_line(b);
+	}
+}
+
+template<bool TABLE>
+static void launch_compute_silhouette(const uint3 color, const uint treshold, const uint tolerance, const uint *table, const cv::cuda::PtrStepSz<uchar3> in, const cv::cuda::PtrStepSz<uint> mask, const cv::Rect roi, cv::cuda::PtrStepSz<uint> out)
+{
+	const cv::Rect r = roi & cv::Rect(0, 0, in.cols, in.rows);
+
+	// Everything outside the region of interest is background
+	cudaMemset2D(out.data, out.step, 0, out.cols * sizeof(uint), out.rows);
+	if (r.area() == 0)
+	{
+		return;
+	}
+
+	dim3 blockSize(128, 8);
+	dim3 gridSize = dim3(iDivUp(r.x + r.width - (r.x & ~SILHOUETTE_WORD_MASK), blockSize.x), iDivUp(r.height, blockSize.y));
+
+	compute_silhouette_kernel<TABLE><<<gridSize, blockSize>>>(color, treshold, tolerance, table, in, mask, r.x, r.y, r.x + r.width, r.y + r.height, out);
+	cudaStreamSynchronize(cudaStreamPerThread);
+
+	cudaError_t err = cudaGetLastError();
+	if (err != cudaSuccess)
+	{
+		char b[500];
+		sprintf(b, "Failed to compute silhouette: %s", cudaGetErrorString(err));
+		throw_line(b);
+	}
+}
+
+void compute_silhouette(const uint3 color, const uint treshold, const uint tolerance, const cv::cuda::PtrStepSz<uchar3> in, const cv::cuda::PtrStepSz<uint> mask, const cv::Rect roi, cv::cuda::PtrStepSz<uint> out)
+{
+	launch_compute_silhouette<false>(color, treshold, tolerance, NULL, in, mask, roi, out);
+}
+
+void compute_silhouette_table(const uint *table, const cv::cuda::PtrStepSz<uchar3> in, const cv::cuda::PtrStepSz<uint> mask, const cv::Rect roi, cv::cuda::PtrStepSz<uint> out)
+{
+	launch_compute_silhouette<true>(make_uint3(0, 0, 0), 0, 0, table, in, mask, roi, out);
+}
+
+void compute_silhouette_yuv(const uint2 color, const uint treshold, const uint tolerance, const cv::cuda::PtrStepSz<uchar> in, const cv::cuda::PtrStepSz<uint> mask, const cv::Rect roi, cv::cuda::PtrStepSz<uint> out)
+{
+	const int height = in.rows * 2 / 3;
+	const cv::Rect r = roi & cv::Rect(0, 0, in.cols, height);
+
+	// Everything outside the region of interest is background
+	cudaMemset2D(out.data, out.step, 0, out.cols * sizeof(uint), out.rows);
+	if (r.area() == 0)
+	{
+		return;
+	}
+
+	// Chroma samples covering the region
+	const int cx0 = r.x >> 1, cy0 = r.y >> 1;
+	const int cx1 = (r.x + r.width + 1) >> 1, cy1 = (r.y + r.height + 1) >> 1;
+
+	dim3 blockSize(128, 8);
+	dim3 gridSize = dim3(iDivUp(cx1 - (cx0 & ~SILHOUETTE_WORD_MASK), blockSize.x), iDivUp(cy1 - cy0, blockSize.y));
+
+	compute_silhouette_yuv_kernel<<<gridSize, blockSize>>>(color, treshold, tolerance, in, height, mask, cx0, cy0, cx1, cy1, out);
+	cudaStreamSynchronize(cudaStreamPerThread);
+
+	cudaError_t err = cudaGetLastError();
+	if (err != cudaSuccess)
+	{
+		char b[500];
+		sprintf(b, "Failed to compute silhouette: %s", cudaGetErrorString(err));
+		throw_line(b);
+	}
+}
\ No newline at end of file
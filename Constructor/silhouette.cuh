@@ -0,0 +1,56 @@
+#ifndef SILHOUETTE_H
+#define SILHOUETTE_H
+
+// Silhouettes are packed 1 bit per pixel, bit (x & 31) of word (x >> 5) of a row is set for foreground pixels. They're
+// stored as CV_32SC1 images of silhouette_words(width) columns
+#define SILHOUETTE_WORD_SHIFT 5
+#define SILHOUETTE_WORD_BITS (1 << SILHOUETTE_WORD_SHIFT)
+#define SILHOUETTE_WORD_MASK (SILHOUETTE_WORD_BITS - 1)
+
+inline int silhouette_words(const int width)
+{
+	return (width + SILHOUETTE_WORD_MASK) >> SILHOUETTE_WORD_SHIFT;
+}
+
+// Masks use the same layout, pixels whose bit is cleared are never foreground. An empty mask masks nothing
+
+// Pack an 8 bit matte, only fully opaque (255) pixels are foreground
+void pack_silhouette(
+	const cv::cuda::PtrStepSz<uchar> in,
+	const cv::cuda::PtrStepSz<uint> mask,
+	cv::cuda::PtrStepSz<uint> out
+);
+
+// Distance keyer writing a packed silhouette directly, same decision as compute_matte. Only pixels in the region of
+// interest that aren't masked are keyed, the rest of the silhouette is cleared
+void compute_silhouette(
+	const uint3 color,
+	const uint treshold,
+	const uint tolerance,
+	const cv::cuda::PtrStepSz<uchar3> in,
+	const cv::cuda::PtrStepSz<uint> mask,
+	const cv::Rect roi,
+	cv::cuda::PtrStepSz<uint> out
+);
+
+// Same, keying through a key table (see key_table.cuh)
+void compute_silhouette_table(
+	const uint *table,
+	const cv::cuda::PtrStepSz<uchar3> in,
+	const cv::cuda::PtrStepSz<uint> mask,
+	const cv::Rect roi,
+	cv::cuda::PtrStepSz<uint> out
+);
+
+// Same, keying an I420 frame (see yuv.cuh) on chroma distance at chroma resolution. The key color is given as (U, V)
+void compute_silhouette_yuv(
+	const uint2 color,
+	const uint treshold,
+	const uint tolerance,
+	const cv::cuda::PtrStepSz<uchar> in,
+	const cv::cuda::PtrStepSz<uint> mask,
+	const cv::Rect roi,
+	cv::cuda::PtrStepSz<uint> out
+);
+
+#endif /* SILHOUETTE_H */
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include <opencv2/core/core.hpp>
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/core/cuda_types.hpp>
+
+#include <cuda_runtime.h>
+
+#include <iostream>
+
+#include "cuda_common.cuh"
+#include "tiled_image.cuh"
+
+#include "Exception.h"
+
+__global__
+void tile_frame_kernel(const cv::cuda::PtrStepSz<uchar3> in, uchar3 *out, const unsigned int tiles_per_row)
+{
+	const int x = blockIdx.x * blockDim.x + threadIdx.x;
+	const int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= in.cols || y >= in.rows)
+	{
+		return;
+	}
+
+	out[((y >> IMAGE_TILE_SHIFT) * tiles_per_row + (x >> IMAGE_TILE_SHIFT)) * IMAGE_TILE_PIXELS + ((y & IMAGE_TILE_MASK) << IMAGE_TILE_SHIFT) + (x & IMAGE_TILE_MASK)] = in(y, x);
+}
+
+void tile_frame(const cv::cuda::PtrStepSz<uchar3> in, cv::cuda::GpuMat &out)
+{
+	const unsigned int tiles_per_row = iDivUp(in.cols, IMAGE_TILE_EDGE);
+	const unsigned int tiles_per_col = iDivUp(in.rows, IMAGE_TILE_EDGE);
+
+	// Same size as the previous frame, create keeps the buffer
+	out.create(1, tiles_per_row * tiles_per_col * IMAGE_TILE_PIXELS, CV_8UC3);
+
+	dim3 blockSize(32, 8);
+	dim3 gridSize = dim3(iDivUp(in.cols, blockSize.x), iDivUp(in.rows, blockSize.y));
+
+	// Cameras are segmented from several threads, the frame is tiled on the stream of the thread producing its silhouette
+	tile_frame_kernel<<<gridSize, blockSize>>>(in, (uchar3*)out.data, tiles_per_row);
+	cudaStreamSynchronize(cudaStreamPerThread);
+
+	cudaError_t err = cudaGetLastError();
+	if (err != cudaSuccess)
+	{
+		char b[500];
+		sprintf(b, "Failed to tile frame: %s", cudaGetErrorString(err));
+		throw_line(b);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#ifndef TILED_IMAGE_H
+#define TILED_IMAGE_H
+
+// Copy a frame into the tiled layout (see cuda_common.cuh), the tiles are stored as a single continuous row. Out is only
+// reallocated when the size of the frame changes, such that the buffer is kept frame after frame
+void tile_frame(
+	const cv::cuda::PtrStepSz<uchar3> in,
+	cv::cuda::GpuMat &out
+);
+
+#endif /* TILED_IMAGE_H */
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include <opencv2/core/core.hpp>
+#include <opencv2/core/cuda_types.hpp>
+
+#include <cuda_runtime.h>
+
+#include <iostream>
+
+#include "cuda_common.cuh"
+#include "yuv_pixel.cuh"
+#include "yuv.cuh"
+
+#include "Exception.h"
+
+__global__
+void convert_yuv_frame_kernel(const cv::cuda::PtrStepSz<uchar> in, cv::cuda::PtrStepSz<uchar3> out)
+{
+	uint x = blockIdx.x * blockDim.x + threadIdx.x;
+	uint y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= out.cols || y >= out.rows)
+	{
+		return;
+	}
+
+	out(y, x) = fetch_yuv(in, x, y);
+}
+
+void convert_yuv_frame(const cv::cuda::PtrStepSz<uchar> in, cv::cuda::PtrStepSz<uchar3> out)
+{
+	dim3 blockSize(128, 8);
+	dim3 gridSize = dim3(iDivUp(out.cols, blockSize.x), iDivUp(out.rows, blockSize.y));
+
+	convert_yuv_frame_kernel<<<gridSize, blockSize>>>(in, out);
+	cudaStreamSynchronize(cudaStreamPerThread);
+
+	cudaError_t err = cudaGetLastError();
+	if (err != cudaSuccess)
+	{
+		char b[500];
+		sprintf(b, "Failed to convert frame: %s", cudaGetErrorString(err));
+		throw_line(b);
+	}
+}
+
+__global__
+void convert_yuv_samples_kernel(const cv::cuda::PtrStepSz<uchar> in, const int x0, const int y0, const int step, cv::cuda::PtrStepSz<uchar3> out)
+{
+	uint x = blockIdx.x * blockDim.x + threadIdx.x;
+	uint y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= out.cols || y >= out.rows)
+	{
+		return;
+	}
+
+	out(y, x) = fetch_yuv(in, x0 + x * step, y0 + y * step);
+}
+
+void convert_yuv_samples(const cv::cuda::PtrStepSz<uchar> in, const int x, const int y, const int step, cv::cuda::PtrStepSz<uchar3> out)
+{
+	dim3 blockSize(128, 8);
+	dim3 gridSize = dim3(iDivUp(out.cols, blockSize.x), iDivUp(out.rows, blockSize.y));
+
+	convert_yuv_samples_kernel<<<gridSize, blockSize>>>(in, x, y, step, out);
+	cudaStreamSynchronize(cudaStreamPerThread);
+
+	cudaError_t err = cudaGetLastError();
+	if (err != cudaSuccess)
+	{
+		char b[500];
+		sprintf(b, "Failed to convert samples: %s", cudaGetErrorString(err));
+		throw_line(b);
+	}
+}
+
+uint2 key_color_chroma(const uint3 color)
+{
+	const float b = float(color.x), g = float(color.y), r = float(color.z);
+
+	const float u = 128.0f - 0.148f * r - 0.291f * g + 0.439f * b;
+	const float v = 128.0f + 0.439f * r - 0.368f * g - 0.071f * b;
+
+	return make_uint2(uint(u + 0.5f), uint(v + 0.5f));
+}
\ No newline at end of file
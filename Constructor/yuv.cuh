@@ -0,0 +1,31 @@
+#ifndef YUV_H
+#define YUV_H
+
+// Frames decoded as I420 (see yuv_pixel.cuh) are uploaded as is, at 1.5 bytes per pixel. Only the 4:2:0 layout with a
+// width that is a multiple of 2 and a height that is a multiple of 4 is supported
+inline bool is_yuv_frame(const int rows, const int cols, const int width, const int height)
+{
+	return cols == width && rows == height * 3 / 2 && (width & 1) == 0 && (height & 3) == 0;
+}
+
+// Convert a whole I420 frame to BGR, only needed by consumers of full colour frames
+void convert_yuv_frame(
+	const cv::cuda::PtrStepSz<uchar> in,
+	cv::cuda::PtrStepSz<uchar3> out
+);
+
+// Convert every step-th pixel of every step-th row from (x, y) on, out is as large as the number of samples
+void convert_yuv_samples(
+	const cv::cuda::PtrStepSz<uchar> in,
+	const int x,
+	const int y,
+	const int step,
+	cv::cuda::PtrStepSz<uchar3> out
+);
+
+// The (U, V) of a key color given in frame channel order (B, G, R)
+uint2 key_color_chroma(
+	const uint3 color
+);
+
+#endif /* YUV_H */
\ No newline at end of file
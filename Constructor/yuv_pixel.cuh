@@ -0,0 +1,65 @@
+#ifndef YUV_PIXEL_H
+#define YUV_PIXEL_H
+
+// I420 frames are a single 8 bit image of 3/2 the frame height, the luma plane followed by the quarter size U and V
+// planes. A row of the image holds two consecutive rows of a chroma plane
+
+// U and V of chroma sample (cx, cy), the frame is height rows of luma
+__device__ __forceinline__ uchar2 fetch_chroma(const cv::cuda::PtrStepSz<uchar> &yuv, const int height, const int cx, const int cy)
+{
+	const int row = height + (cy >> 1);
+	const int col = (cy & 1) * (yuv.cols >> 1) + cx;
+
+	return make_uchar2(yuv(row, col), yuv(row + (height >> 2), col));
+}
+
+// BT.601 studio swing, same as OpenCV's YUV to BGR conversion. Channels are in frame order (B, G, R)
+__device__ __forceinline__ uchar3 yuv_to_bgr(const uchar luma, const uchar2 chroma)
+{
+	const float y = 1.164f * (float(luma) - 16.0f);
+	const float u = float(chroma.x) - 128.0f;
+	const float v = float(chroma.y) - 128.0f;
+
+	return make_uchar3(
+		__float2int_rn(__saturatef((y + 2.018f * u) / 255.0f) * 255.0f),
+		__float2int_rn(__saturatef((y - 0.813f * v - 0.391f * u) / 255.0f) * 255.0f),
+		__float2int_rn(__saturatef((y + 1.596f * v) / 255.0f) * 255.0f)
+	);
+}
+
+// Colour of pixel (x, y), only converts this one pixel
+__device__ __forceinline__ uchar3 fetch_yuv(const cv::cuda::PtrStepSz<uchar> &yuv, const int x, const int y)
+{
+	const int height = yuv.rows * 2 / 3;
+
+	return yuv_to_bgr(yuv(y, x), fetch_chroma(yuv, height, x >> 1, y >> 1));
+}
+
+// Distance keyer on chroma only, the key color is given as (U, V). The chroma difference is taken as the BGR difference
+// it makes at equal luma (see yuv_to_bgr), so the distance is on the scale of key_matte and the treshold and tolerance
+// apply the same way
+__device__ __forceinline__ uchar key_chroma(const uchar2 chroma, const uint2 color, const uint treshold, const uint tolerance)
+{
+	const float i_255 = 1.0f / 255.0f;
+
+	const float u = (float(chroma.x) - float(color.x)) * i_255;
+	const float v = (float(chroma.y) - float(color.y)) * i_255;
+
+	const float b = 2.018f * u;
+	const float g = -0.813f * v - 0.391f * u;
+	const float r = 1.596f * v;
+
+	int grey = 255 * sqrtf(r * r + g * g + b * b) / sqrtf(3.0f);
+	if (grey <= treshold)
+	{
+		return 0;
+	}
+	else if (grey >= tolerance)
+	{
+		return 255;
+	}
+
+	return 255 * (grey - treshold) / (tolerance - treshold);
+}
+
+#endif /* YUV_PIXEL_H */
\ No newline at end of file
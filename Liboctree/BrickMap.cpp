@@ -0,0 +1,366 @@
+#include "Stdafx.h"
+
+#include "BrickMap.h"
+#include "Exception.h"
+
+BrickMap::BrickMap(const unsigned int width, const unsigned int height, const unsigned int depth, const int originX, const int originY, const int originZ, const int step, const bool hasColors) :
+	m_Width(width), m_Height(height), m_Depth(depth), m_OriginX(originX), m_OriginY(originY), m_OriginZ(originZ), m_Step(step), m_HasColors(hasColors)
+{
+	if (step <= 0)
+	{
+		throw_line("Brick map step should be positive");
+	}
+
+	// Round the voxel space up to whole bricks
+	this->m_BricksX = (width + BRICK_MASK) >> BRICK_SHIFT;
+	this->m_BricksY = (height + BRICK_MASK) >> BRICK_SHIFT;
+	this->m_BricksZ = (depth + BRICK_MASK) >> BRICK_SHIFT;
+
+	if (this->m_BricksX > 0xFFFF || this->m_BricksY > 0xFFFF || this->m_BricksZ > 0xFFFF)
+	{
+		throw_line("Brick map dimensions too large");
+	}
+
+	// The index is the only dense part, 4 bytes per 512 voxels
+	this->m_Index.assign((size_t)this->m_BricksX * this->m_BricksY * this->m_BricksZ, BRICK_UNALLOCATED);
+
+	this->m_NumVoxels = 0;
+}
+
+BrickMap::~BrickMap(void)
+{
+}
+
+int BrickMap::AllocateBrick(const unsigned int bx, const unsigned int by, const unsigned int bz)
+{
+	int brick;
+	if (!this->m_FreeBricks.empty())
+	{
+		// Recycle a released brick
+		brick = this->m_FreeBricks.back();
+		this->m_FreeBricks.pop_back();
+	}
+	else
+	{
+		brick = (int)this->m_Pool.size();
+		this->m_Pool.push_back(Brick());
+
+		if (this->m_HasColors)
+		{
+			this->m_Colors.resize(this->m_Colors.size() + BRICK_VOXELS);
+		}
+	}
+
+	Brick &b = this->m_Pool[brick];
+	b.Reset();
+	b.BX = bx;
+	b.BY = by;
+	b.BZ = bz;
+
+	this->m_Index[this->BrickIdx(bx, by, bz)] = brick;
+
+	return brick;
+}
+
+void BrickMap::ReleaseBrick(const unsigned int idx)
+{
+	const int brick = this->m_Index[idx];
+	assert(brick != BRICK_UNALLOCATED && this->m_Pool[brick].NumVoxels == 0);
+
+	this->m_FreeBricks.push_back(brick);
+	this->m_Index[idx] = BRICK_UNALLOCATED;
+}
+
+bool BrickMap::Test(const int x, const int y, const int z) const
+{
+	if (!this->InBounds(x, y, z))
+	{
+		return false;
+	}
+
+	const int brick = this->m_Index[this->BrickIdx(x >> BRICK_SHIFT, y >> BRICK_SHIFT, z >> BRICK_SHIFT)];
+	if (brick == BRICK_UNALLOCATED)
+	{
+		return false;
+	}
+
+	return this->m_Pool[brick].Test(Brick::VoxelIdx(x & BRICK_MASK, y & BRICK_MASK, z & BRICK_MASK));
+}
+
+void BrickMap::Set(const int x, const int y, const int z)
+{
+	this->Set(x, y, z, 0, 0, 0);
+}
+
+void BrickMap::Set(const int x, const int y, const int z, const unsigned char r, const unsigned char g, const unsigned char b)
+{
+	assert(this->InBounds(x, y, z));
+
+	const unsigned int bx = x >> BRICK_SHIFT, by = y >> BRICK_SHIFT, bz = z >> BRICK_SHIFT;
+
+	int brick = this->m_Index[this->BrickIdx(bx, by, bz)];
+	if (brick == BRICK_UNALLOCATED)
+	{
+		brick = this->AllocateBrick(bx, by, bz);
+	}
+
+	const unsigned int v = Brick::VoxelIdx(x & BRICK_MASK, y & BRICK_MASK, z & BRICK_MASK);
+	if (this->m_Pool[brick].Set(v))
+	{
+		++this->m_NumVoxels;
+	}
+
+	if (this->m_HasColors)
+	{
+		this->m_Colors[(size_t)brick * BRICK_VOXELS + v] = (r << 16) | (g << 8) | b;
+	}
+}
+
+void BrickMap::Unset(const int x, const int y, const int z)
+{
+	if (!this->InBounds(x, y, z))
+	{
+		return;
+	}
+
+	const unsigned int idx = this->BrickIdx(x >> BRICK_SHIFT, y >> BRICK_SHIFT, z >> BRICK_SHIFT);
+
+	const int brick = this->m_Index[idx];
+	if (brick == BRICK_UNALLOCATED)
+	{
+		return;
+	}
+
+	if (this->m_Pool[brick].Unset(Brick::VoxelIdx(x & BRICK_MASK, y & BRICK_MASK, z & BRICK_MASK)))
+	{
+		--this->m_NumVoxels;
+
+		// Give empty bricks back to the pool
+		if (this->m_Pool[brick].NumVoxels == 0)
+		{
+			this->ReleaseBrick(idx);
+		}
+	}
+}
+
+bool BrickMap::GetColor(const int x, const int y, const int z, unsigned char &r, unsigned char &g, unsigned char &b) const
+{
+	if (!this->m_HasColors || !this->Test(x, y, z))
+	{
+		return false;
+	}
+
+	const int brick = this->m_Index[this->BrickIdx(x >> BRICK_SHIFT, y >> BRICK_SHIFT, z >> BRICK_SHIFT)];
+	const unsigned int color = this->m_Colors[(size_t)brick * BRICK_VOXELS + Brick::VoxelIdx(x & BRICK_MASK, y & BRICK_MASK, z & BRICK_MASK)];
+
+	r = (color >> 16) & 0xFF;
+	g = (color >> 8) & 0xFF;
+	b = color & 0xFF;
+
+	return true;
+}
+
+bool BrickMap::IsSurface(const int x, const int y, const int z) const
+{
+	if (!this->Test(x, y, z))
+	{
+		return false;
+	}
+
+	return !this->Test(x - 1, y, z) || !this->Test(x + 1, y, z) ||
+		   !this->Test(x, y - 1, z) || !this->Test(x, y + 1, z) ||
+		   !this->Test(x, y, z - 1) || !this->Test(x, y, z + 1);
+}
+
+void BrickMap::Clear(void)
+{
+	std::vector<Brick>::iterator it;
+	for (it = this->m_Pool.begin() ; it != this->m_Pool.end() ; ++it)
+	{
+		if (it->NumVoxels > 0)
+		{
+			it->Reset();
+			this->ReleaseBrick(this->BrickIdx(it->BX, it->BY, it->BZ));
+		}
+	}
+
+	this->m_NumVoxels = 0;
+}
+
+void BrickMap::Insert(const VisibleVoxel *voxels, const unsigned long long int numVoxels)
+{
+	for (unsigned long long int i = 0 ; i < numVoxels ; ++i)
+	{
+		const VisibleVoxel &v = voxels[i];
+
+		// World to grid coordinates
+		const int x = (v.X - this->m_OriginX) / this->m_Step;
+		const int y = (v.Y - this->m_OriginY) / this->m_Step;
+		const int z = (v.Z - this->m_OriginZ) / this->m_Step;
+
+		if (this->InBounds(x, y, z))
+		{
+			this->Set(x, y, z, v.R, v.G, v.B);
+		}
+	}
+}
+
+void BrickMap::Insert(const CarvedBrick *bricks, const unsigned int numBricks, const int step)
+{
+	for (unsigned int i = 0 ; i < numBricks ; ++i)
+	{
+		const CarvedBrick &brick = bricks[i];
+
+		for (unsigned int w = 0 ; w < BRICK_WORDS ; ++w)
+		{
+			unsigned long long int word = brick.Occupancy[w];
+			while (word)
+			{
+				// Pop the lowest set bit
+				unsigned int bit = 0;
+				while (!((word >> bit) & 1))
+				{
+					++bit;
+				}
+				word &= word - 1;
+
+				const unsigned int v = (w << 6) | bit;
+
+				// World to grid coordinates, the carve step can be coarser than the step of the map
+				const int x = (brick.X + (int)(v & BRICK_MASK) * step - this->m_OriginX) / this->m_Step;
+				const int y = (brick.Y + (int)((v >> BRICK_SHIFT) & BRICK_MASK) * step - this->m_OriginY) / this->m_Step;
+				const int z = (brick.Z + (int)(v >> (BRICK_SHIFT * 2)) * step - this->m_OriginZ) / this->m_Step;
+
+				if (this->InBounds(x, y, z))
+				{
+					const unsigned int color = brick.Colors[v];
+					this->Set(x, y, z, (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF);
+				}
+			}
+		}
+	}
+}
+
+unsigned long long int BrickMap::Extract(std::vector<VisibleVoxel> &out, const bool surfaceOnly) const
+{
+	const size_t start = out.size();
+
+	// Walk the pool in stead of the index, we only touch allocated bricks
+	for (size_t p = 0 ; p < this->m_Pool.size() ; ++p)
+	{
+		this->ExtractBrick(p, out, surfaceOnly);
+	}
+
+	return out.size() - start;
+}
+
+unsigned int BrickMap::ExtractBrick(const size_t brick, std::vector<VisibleVoxel> &out, const bool surfaceOnly) const
+{
+	const Brick &b = this->m_Pool[brick];
+	if (b.NumVoxels == 0)
+	{
+		return 0;
+	}
+
+	const size_t start = out.size();
+
+	for (unsigned int w = 0 ; w < BRICK_WORDS ; ++w)
+	{
+		unsigned long long int word = b.Occupancy[w];
+		while (word)
+		{
+			// Pop the lowest set bit
+			unsigned int bit = 0;
+			while (!((word >> bit) & 1))
+			{
+				++bit;
+			}
+			word &= word - 1;
+
+			const unsigned int v = (w << 6) | bit;
+			const int x = (b.BX << BRICK_SHIFT) | (v & BRICK_MASK);
+			const int y = (b.BY << BRICK_SHIFT) | ((v >> BRICK_SHIFT) & BRICK_MASK);
+			const int z = (b.BZ << BRICK_SHIFT) | (v >> (BRICK_SHIFT * 2));
+
+			if (surfaceOnly && !this->IsSurface(x, y, z))
+			{
+				continue;
+			}
+
+			VisibleVoxel voxel;
+			voxel.X = this->m_OriginX + x * this->m_Step;
+			voxel.Y = this->m_OriginY + y * this->m_Step;
+			voxel.Z = this->m_OriginZ + z * this->m_Step;
+
+			const unsigned int color = this->m_HasColors ? this->m_Colors[brick * BRICK_VOXELS + v] : 0xFFFFFF;
+			voxel.R = (color >> 16) & 0xFF;
+			voxel.G = (color >> 8) & 0xFF;
+			voxel.B = color & 0xFF;
+
+			out.push_back(voxel);
+		}
+	}
+
+	return (unsigned int)(out.size() - start);
+}
+
+void BrickMap::GetBrickBounds(const size_t brick, int min[3], int max[3]) const
+{
+	const Brick &b = this->m_Pool[brick];
+
+	min[0] = this->m_OriginX + (int)(b.BX << BRICK_SHIFT) * this->m_Step;
+	min[1] = this->m_OriginY + (int)(b.BY << BRICK_SHIFT) * this->m_Step;
+	min[2] = this->m_OriginZ + (int)(b.BZ << BRICK_SHIFT) * this->m_Step;
+
+	for (int a = 0 ; a < 3 ; ++a)
+	{
+		max[a] = min[a] + BRICK_MASK * this->m_Step;
+	}
+}
+
+bool BrickMap::GetBounds(int min[3], int max[3]) const
+{
+	bool found = false;
+
+	// Only allocated bricks are visited
+	for (size_t p = 0 ; p < this->m_Pool.size() ; ++p)
+	{
+		const Brick &brick = this->m_Pool[p];
+		if (brick.NumVoxels == 0)
+		{
+			continue;
+		}
+
+		for (unsigned int v = 0 ; v < BRICK_VOXELS ; ++v)
+		{
+			if (!brick.Test(v))
+			{
+				continue;
+			}
+
+			const int c[3] = {
+				this->m_OriginX + (int)((brick.BX << BRICK_SHIFT) | (v & BRICK_MASK)) * this->m_Step,
+				this->m_OriginY + (int)((brick.BY << BRICK_SHIFT) | ((v >> BRICK_SHIFT) & BRICK_MASK)) * this->m_Step,
+				this->m_OriginZ + (int)((brick.BZ << BRICK_SHIFT) | (v >> (BRICK_SHIFT * 2))) * this->m_Step
+			};
+
+			for (int i = 0 ; i < 3 ; ++i)
+			{
+				min[i] = !found || c[i] < min[i] ? c[i] : min[i];
+				max[i] = !found || c[i] > max[i] ? c[i] : max[i];
+			}
+
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+unsigned long long int BrickMap::GetMemoryUsage(void) const
+{
+	return this->m_Index.size() * sizeof(int) +
+		   this->m_Pool.size() * sizeof(Brick) +
+		   this->m_Colors.size() * sizeof(unsigned int) +
+		   this->m_FreeBricks.size() * sizeof(int);
+}
\ No newline at end of file
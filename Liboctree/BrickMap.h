@@ -0,0 +1,179 @@
+#pragma once
+
+#include <vector>
+
+#include "VisibleVoxel.h"
+
+// Bricks are 8x8x8 voxels, the occupancy of a brick fits in eight 64 bit words
+#define BRICK_SHIFT 3
+#define BRICK_EDGE (1 << BRICK_SHIFT)
+#define BRICK_MASK (BRICK_EDGE - 1)
+#define BRICK_VOXELS (BRICK_EDGE * BRICK_EDGE * BRICK_EDGE)
+#define BRICK_WORDS (BRICK_VOXELS / 64)
+
+#define BRICK_UNALLOCATED -1
+
+typedef struct Brick
+{
+	unsigned long long int Occupancy[BRICK_WORDS];
+
+	// Number of occupied voxels in this brick
+	unsigned int NumVoxels;
+
+	// Brick coordinates (in bricks) of this brick in the top level index
+	unsigned short BX, BY, BZ;
+
+	void Reset(void)
+	{
+		for (int i = 0 ; i < BRICK_WORDS ; ++i)
+		{
+			this->Occupancy[i] = 0;
+		}
+
+		this->NumVoxels = 0;
+	}
+
+	static inline unsigned int VoxelIdx(const unsigned int lx, const unsigned int ly, const unsigned int lz)
+	{
+		return (lz << (BRICK_SHIFT * 2)) | (ly << BRICK_SHIFT) | lx;
+	}
+
+	inline bool Test(const unsigned int idx) const
+	{
+		return (this->Occupancy[idx >> 6] >> (idx & 63)) & 1;
+	}
+
+	inline bool Set(const unsigned int idx)
+	{
+		const unsigned long long int bit = 1ULL << (idx & 63);
+		if (this->Occupancy[idx >> 6] & bit)
+		{
+			return false;
+		}
+
+		this->Occupancy[idx >> 6] |= bit;
+		++this->NumVoxels;
+
+		return true;
+	}
+
+	inline bool Unset(const unsigned int idx)
+	{
+		const unsigned long long int bit = 1ULL << (idx & 63);
+		if (!(this->Occupancy[idx >> 6] & bit))
+		{
+			return false;
+		}
+
+		this->Occupancy[idx >> 6] &= ~bit;
+		--this->NumVoxels;
+
+		return true;
+	}
+} Brick;
+
+// Brick as carved on the device, only bricks holding at least one voxel are written. The position is the world position of
+// the first voxel, the voxels of the brick are the carve step apart. Colors are packed 0x00RRGGBB in occupancy order
+typedef struct CarvedBrick
+{
+	int X, Y, Z;
+
+	unsigned long long int Occupancy[BRICK_WORDS];
+	unsigned int Colors[BRICK_VOXELS];
+} CarvedBrick;
+
+// Sparse voxel occupancy storage, a coarse top level index points into a pool of 8^3 bricks. Bricks are only allocated
+// where voxels are actually set, such that memory scales with the surface of the hull in stead of the volume of the voxel
+// space. Voxels are addressed in grid coordinates (0 .. width, 0 .. height, 0 .. depth), the world position of a voxel is
+// origin + grid * step, which is the same mapping as used by the reconstructor
+class BrickMap
+{
+private:
+	const unsigned int m_Width, m_Height, m_Depth;
+
+	unsigned int m_BricksX, m_BricksY, m_BricksZ;
+
+	const int m_OriginX, m_OriginY, m_OriginZ;
+
+	const int m_Step;
+
+	const bool m_HasColors;
+
+	// Top level index, holds the offset of the brick in the pool or BRICK_UNALLOCATED
+	std::vector<int> m_Index;
+
+	// Brick pool, released bricks are recycled through the free list
+	std::vector<Brick> m_Pool;
+	std::vector<int> m_FreeBricks;
+
+	// Packed 0x00RRGGBB colors, BRICK_VOXELS per brick in the pool
+	std::vector<unsigned int> m_Colors;
+
+	unsigned long long int m_NumVoxels;
+
+	inline unsigned int BrickIdx(const unsigned int bx, const unsigned int by, const unsigned int bz) const
+	{
+		return (bz * this->m_BricksY + by) * this->m_BricksX + bx;
+	}
+
+	int AllocateBrick(const unsigned int bx, const unsigned int by, const unsigned int bz);
+	void ReleaseBrick(const unsigned int idx);
+public:
+	BrickMap(const unsigned int width, const unsigned int height, const unsigned int depth, const int originX = 0, const int originY = 0, const int originZ = 0, const int step = 1, const bool hasColors = true);
+	~BrickMap(void);
+
+	inline bool InBounds(const int x, const int y, const int z) const
+	{
+		return x >= 0 && y >= 0 && z >= 0 && x < (int)this->m_Width && y < (int)this->m_Height && z < (int)this->m_Depth;
+	}
+
+	bool Test(const int x, const int y, const int z) const;
+
+	void Set(const int x, const int y, const int z);
+	void Set(const int x, const int y, const int z, const unsigned char r, const unsigned char g, const unsigned char b);
+	void Unset(const int x, const int y, const int z);
+
+	bool GetColor(const int x, const int y, const int z, unsigned char &r, unsigned char &g, unsigned char &b) const;
+
+	// A voxel is on the surface when it is set and at least one of its six neighbours is not
+	bool IsSurface(const int x, const int y, const int z) const;
+
+	// Release all bricks, the pool keeps its capacity so the next frame doesn't reallocate
+	void Clear(void);
+
+	// Insert voxels given in world coordinates, voxels outside of the map are ignored
+	void Insert(const VisibleVoxel *voxels, const unsigned long long int numVoxels);
+
+	// Insert carved bricks whose voxels are step apart in world coordinates, voxels outside of the map are ignored
+	void Insert(const CarvedBrick *bricks, const unsigned int numBricks, const int step);
+
+	// Write all (or only the surface) voxels in world coordinates to out, returns the number of voxels written
+	unsigned long long int Extract(std::vector<VisibleVoxel> &out, const bool surfaceOnly = false) const;
+
+	// Same for a single brick of the pool, returns the number of voxels written
+	unsigned int ExtractBrick(const size_t brick, std::vector<VisibleVoxel> &out, const bool surfaceOnly = false) const;
+
+	// World coordinates of the first and last voxel a brick of the pool can hold
+	void GetBrickBounds(const size_t brick, int min[3], int max[3]) const;
+
+	// Compute the bounds of the set voxels in world coordinates, returns false if the map is empty
+	bool GetBounds(int min[3], int max[3]) const;
+
+	unsigned int GetWidth(void) const { return this->m_Width; }
+	unsigned int GetHeight(void) const { return this->m_Height; }
+	unsigned int GetDepth(void) const { return this->m_Depth; }
+
+	int GetStep(void) const { return this->m_Step; }
+
+	bool HasColors(void) const { return this->m_HasColors; }
+
+	unsigned long long int GetNumVoxels(void) const { return this->m_NumVoxels; }
+
+	unsigned int GetNumBricks(void) const { return (unsigned int)(this->m_Pool.size() - this->m_FreeBricks.size()); }
+
+	// Memory used by the index, the brick pool and the color pool in bytes
+	unsigned long long int GetMemoryUsage(void) const;
+
+	const std::vector<Brick> &GetPool(void) const { return this->m_Pool; }
+	const std::vector<int> &GetIndex(void) const { return this->m_Index; }
+};
\ No newline at end of file
@@ -2,12 +2,57 @@
 
 #include "Octree.h"
 
+#include <algorithm>
+
+// Interleave the bits of a brick coordinate with two zero bits, brick coordinates are at most 16 bits
+static unsigned long long int spread_bits(unsigned long long int v)
+{
+	v &= 0xFFFF;
+	v = (v | (v << 16)) & 0x0000FF0000FFULL;
+	v = (v | (v << 8)) & 0x00F00F00F00FULL;
+	v = (v | (v << 4)) & 0x0C30C30C30C3ULL;
+	v = (v | (v << 2)) & 0x249249249249ULL;
+
+	return v;
+}
+
+// Morton key of a brick, x is the most significant like the child index of a node
+static unsigned long long int morton_key(const unsigned int x, const unsigned int y, const unsigned int z)
+{
+	return (spread_bits(x) << 2) | (spread_bits(y) << 1) | spread_bits(z);
+}
+
+Octree::Octree(void)
+{
+	this->m_MaxPerCell = 0;
+
+	this->m_Voxels = 0;
+	this->m_NumVoxels = 0;
+
+	this->m_Root = 0;
+
+	this->m_NumNodes = 0;
+	this->m_NumFullNodes = 0;
+
+	this->m_Origin = glm::vec3(0, 0, 0);
+
+	this->SetVolumeTransform(glm::vec3(1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, 0));
+}
+
 Octree::Octree(glm::vec3 center, glm::vec3 halfsize, const unsigned int maxPerCell) : m_MaxPerCell(maxPerCell)
 {
+	this->m_Voxels = 0;
+	this->m_NumVoxels = 0;
+
 	this->m_Root = new OctreeNode(center, halfsize);
 	this->m_Root->IsRoot = true;
 
 	this->m_NumNodes = 1;
+	this->m_NumFullNodes = 0;
+
+	this->m_Origin = glm::vec3(0, 0, 0);
+
+	this->SetVolumeTransform(glm::vec3(1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, 0));
 }
 
 Octree::~Octree(void)
@@ -56,4 +101,147 @@ void Octree::Build(void)
 			}
 		}
 	}
+}
+
+void Octree::Build(const BrickMap &brickMap, const bool surfaceOnly)
+{
+	this->m_Voxels = 0;
+	this->m_NumVoxels = 0;
+
+	// Consecutive bricks in Morton order share most of their path down the tree
+	const std::vector<Brick> &pool = brickMap.GetPool();
+	std::vector<std::pair<unsigned long long int, size_t>> order;
+	for (size_t p = 0 ; p < pool.size() ; ++p)
+	{
+		if (pool[p].NumVoxels > 0)
+		{
+			order.push_back(std::make_pair(morton_key(pool[p].BX, pool[p].BY, pool[p].BZ), p));
+		}
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<VisibleVoxel> voxels;
+	for (size_t b = 0 ; b < order.size() ; ++b)
+	{
+		// Only the voxels of this brick are resident besides the octree, when surfaceOnly is set the interior of the hull is
+		// skipped entirely such that the octree scales with the surface area
+		voxels.clear();
+		if (brickMap.ExtractBrick(order[b].second, voxels, surfaceOnly) == 0)
+		{
+			continue;
+		}
+
+		int min[3], max[3];
+		brickMap.GetBrickBounds(order[b].second, min, max);
+
+		const glm::vec3 lower(min[0], min[1], min[2]);
+		const glm::vec3 upper(max[0], max[1], max[2]);
+
+		// Voxels outside the root are dropped, like Build does
+		if (!this->m_Root->Contains(lower) || !this->m_Root->Contains(upper))
+		{
+			size_t kept = 0;
+			for (size_t v = 0 ; v < voxels.size() ; ++v)
+			{
+				if (this->m_Root->Contains(glm::vec3(voxels[v].X, voxels[v].Y, voxels[v].Z)))
+				{
+					voxels[kept++] = voxels[v];
+				}
+			}
+			voxels.resize(kept);
+
+			if (kept == 0)
+			{
+				continue;
+			}
+		}
+
+		// Descend to the smallest split node holding the whole brick
+		OctreeNode *node = this->m_Root;
+		while (node->IsSplit && node->BestIdx(lower) == node->BestIdx(upper))
+		{
+			node = node->IdxToNodePointer(node->BestIdx(lower));
+		}
+
+		const unsigned int numVoxels = (unsigned int)voxels.size();
+		VisibleVoxel *stored = this->StoreVoxels(voxels);
+		for (unsigned int v = 0 ; v < numVoxels ; ++v)
+		{
+			this->Insert(node, &stored[v]);
+		}
+
+		this->m_NumVoxels += numVoxels;
+	}
+}
+
+VisibleVoxel *Octree::StoreVoxels(std::vector<VisibleVoxel> &voxels)
+{
+	VisibleVoxel *stored;
+
+	#pragma omp critical(octree_voxels)
+	{
+		this->m_VoxelBlocks.push_back(std::vector<VisibleVoxel>());
+		this->m_VoxelBlocks.back().swap(voxels);
+
+		stored = &this->m_VoxelBlocks.back()[0];
+	}
+
+	return stored;
+}
+
+void Octree::Insert(OctreeNode *node, VisibleVoxel *voxel)
+{
+	while (node->IsSplit)
+	{
+		node = node->IdxToNodePointer(node->BestIdx(glm::vec3(voxel->X, voxel->Y, voxel->Z)));
+	}
+
+	node->Add(voxel);
+
+	if (node->Objects.size() > this->m_MaxPerCell)
+	{
+		node->Subdivide();
+		node->Rebalance();
+
+		this->m_NumNodes += 8;
+	}
+}
+
+void Octree::Split(OctreeNode *node)
+{
+	node->Subdivide();
+
+	#pragma omp atomic
+	this->m_NumNodes += 8;
+}
+
+void Octree::AddVoxels(OctreeNode *node, std::vector<VisibleVoxel> &voxels)
+{
+	if (voxels.empty())
+	{
+		return;
+	}
+
+	const unsigned int numVoxels = (unsigned int)voxels.size();
+
+	// The node belongs to the calling task, only the block storage is shared
+	VisibleVoxel *stored = this->StoreVoxels(voxels);
+	for (unsigned int v = 0 ; v < numVoxels ; ++v)
+	{
+		node->Add(&stored[v]);
+	}
+
+	#pragma omp atomic
+	this->m_NumVoxels += numVoxels;
+}
+
+void Octree::SetFull(OctreeNode *node, const unsigned char r, const unsigned char g, const unsigned char b)
+{
+	node->IsFull = true;
+	node->R = r;
+	node->G = g;
+	node->B = b;
+
+	#pragma omp atomic
+	++this->m_NumFullNodes;
 }
\ No newline at end of file
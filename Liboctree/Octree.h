@@ -1,8 +1,10 @@
 #pragma once
 
 #include <list>
+#include <deque>
 
 #include "VisibleVoxel.h"
+#include "BrickMap.h"
 
 #define iLoc(x, y, z) x << 2 + y << 1 + z << 0
 
@@ -42,6 +44,11 @@ typedef struct OctreeNode
 	bool IsRoot;
 	bool IsSplit;
 
+	// A full node is entirely inside the hull, its voxels are not enumerated
+	bool IsFull;
+
+	unsigned char R, G, B;
+
 	template<class Archive>
 	inline void serialize(Archive &ar, const unsigned int fileVersion)
 	{
@@ -54,9 +61,17 @@ typedef struct OctreeNode
 		ar & this->Loc;
 		ar & this->IsRoot;
 		ar & this->IsSplit;
+
+		if (fileVersion > 0)
+		{
+			ar & this->IsFull;
+			ar & this->R;
+			ar & this->G;
+			ar & this->B;
+		}
 	}
 
-	OctreeNode(void) {}
+	OctreeNode(void) : IsFull(false), R(0), G(0), B(0) {}
 
 	OctreeNode(glm::vec3 center, glm::vec3 halfsize, OctreeNode *parent = 0, const unsigned int loc = 0) : Loc(loc)
 	{
@@ -69,6 +84,9 @@ typedef struct OctreeNode
 
 		this->IsRoot = false;
 		this->IsSplit = false;
+
+		this->IsFull = false;
+		this->R = this->G = this->B = 0;
 	}
 
 	~OctreeNode(void)
@@ -175,8 +193,27 @@ private:
 	OctreeNode *m_Root;
 
 	unsigned int m_NumNodes;
+
+	// Position of the voxel coordinates in the volume, non-zero for octrees built from a tile with tile relative voxels
+	Vec3 m_Origin;
+
+	// Volume to world transformation, the world directions of the volume axes and the world position of the volume origin
+	Vec3 m_VolumeAxes[3];
+	Vec3 m_VolumeOrigin;
+
+	// Storage for the voxels when the octree is built from a brick map or carved directly, a block per brick or leaf.
+	// Blocks are never resized once stored, the nodes point into them
+	std::deque<std::vector<VisibleVoxel>> m_VoxelBlocks;
+
+	unsigned int m_NumFullNodes;
+
+	// Take over the voxels as a block of their own, returns the stored voxels. Safe to call from concurrent OpenMP tasks
+	VisibleVoxel *StoreVoxels(std::vector<VisibleVoxel> &voxels);
+
+	// Add a voxel to the leaf below node it belongs to, leaves holding too many voxels are split
+	void Insert(OctreeNode *node, VisibleVoxel *voxel);
 public:
-	Octree(void) {}
+	Octree(void);
 	Octree(glm::vec3 center, glm::vec3 halfsize, const unsigned int maxPerCell = 1000000);
 	~Octree(void);
 
@@ -184,9 +221,24 @@ public:
 
 	unsigned int GetNumVoxels(void) { return this->m_NumVoxels; }
 	unsigned int GetNumNodes(void) { return this->m_NumNodes; }
+	unsigned int GetNumFullNodes(void) { return this->m_NumFullNodes; }
 
 	VisibleVoxel *GetVoxels(void) { return this->m_Voxels; }
 
+	const glm::vec3 &GetOrigin(void) { return this->m_Origin; }
+	void SetOrigin(const glm::vec3 &origin) { this->m_Origin = origin; }
+
+	const glm::vec3 &GetVolumeAxis(const int axis) { return this->m_VolumeAxes[axis]; }
+	const glm::vec3 &GetVolumeOrigin(void) { return this->m_VolumeOrigin; }
+
+	void SetVolumeTransform(const glm::vec3 &axisX, const glm::vec3 &axisY, const glm::vec3 &axisZ, const glm::vec3 &origin)
+	{
+		this->m_VolumeAxes[0] = axisX;
+		this->m_VolumeAxes[1] = axisY;
+		this->m_VolumeAxes[2] = axisZ;
+		this->m_VolumeOrigin = origin;
+	}
+
 	void SetVoxels(VisibleVoxel *voxels) { this->m_Voxels = voxels; }
 	void SetNumVoxels(unsigned int numVoxels) { this->m_NumVoxels = numVoxels; }
 
@@ -198,8 +250,35 @@ public:
 		ar & this->m_MaxPerCell;
 		ar & this->m_NumVoxels;
 		ar & this->m_NumNodes;
+
+		if (fileVersion > 0)
+		{
+			ar & this->m_Origin;
+		}
+
+		if (fileVersion > 1)
+		{
+			ar & this->m_VolumeAxes;
+			ar & this->m_VolumeOrigin;
+		}
 	}
 
 	void Traverse(OctreeNode *node, VisibleVoxel *object);
 	void Build(void);
-};
\ No newline at end of file
+
+	// Build from the allocated bricks, in Morton order. The voxels of a brick descend together as far as the brick fits
+	// in a single node, the brick map isn't flattened into a voxel list first
+	void Build(const BrickMap &brickMap, const bool surfaceOnly = false);
+
+	// Direct construction, used when carving emits octree nodes in stead of voxels. These are safe to call from
+	// concurrent OpenMP tasks
+	void Split(OctreeNode *node);
+
+	// Take over the voxels of a leaf, only storing the block is serialized between tasks
+	void AddVoxels(OctreeNode *node, std::vector<VisibleVoxel> &voxels);
+
+	void SetFull(OctreeNode *node, const unsigned char r, const unsigned char g, const unsigned char b);
+};
+
+BOOST_CLASS_VERSION(OctreeNode, 1)
+BOOST_CLASS_VERSION(Octree, 2)
\ No newline at end of file
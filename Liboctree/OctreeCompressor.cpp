@@ -9,8 +9,19 @@ OctreeCompressor::OctreeCompressor(std::string file)
 	this->m_CompressedFile.open(file.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
 	if (!this->m_CompressedFile.good())
 	{
-		throw_line("Could not open compressed file for writing");
+		throw_line("Could not open compressed file for writing: " + file);
 	}
+
+	const unsigned int magic = OCTREE_FILE_MAGIC;
+	const unsigned int version = OCTREE_FILE_VERSION;
+	this->m_CompressedFile.write((const char*)&magic, sizeof(magic));
+	this->m_CompressedFile.write((const char*)&version, sizeof(version));
+	if (!this->m_CompressedFile.good())
+	{
+		throw_line("Could not write to compressed file");
+	}
+
+	this->m_NumRecords = 0;
 }
 
 OctreeCompressor::~OctreeCompressor()
@@ -18,8 +29,27 @@ OctreeCompressor::~OctreeCompressor()
 	this->m_CompressedFile.close();
 }
 
-void OctreeCompressor::Compress(Octree *octree)
+void OctreeCompressor::Compress(Octree *octree, const int frame)
 {
-	boost::archive::binary_oarchive archive(this->m_CompressedFile);
-	archive << octree;
+	std::ostringstream buffer(std::ios::out | std::ios::binary);
+	{
+		boost::archive::binary_oarchive archive(buffer);
+		archive << octree;
+	}
+
+	const std::string data = buffer.str();
+	const int number = frame;
+	const unsigned long long int size = data.size();
+
+	this->m_CompressedFile.write((const char*)&number, sizeof(number));
+	this->m_CompressedFile.write((const char*)&size, sizeof(size));
+	this->m_CompressedFile.write(data.data(), data.size());
+	this->m_CompressedFile.flush();
+
+	if (!this->m_CompressedFile.good())
+	{
+		throw_line("Could not write to compressed file");
+	}
+
+	++this->m_NumRecords;
 }
\ No newline at end of file
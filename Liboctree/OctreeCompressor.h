@@ -2,13 +2,28 @@
 
 #include "Octree.h"
 
+// Identifies compressed files, "OCTR" on disk. The version goes up whenever the layout of the file or the records changes
+#define OCTREE_FILE_MAGIC 0x5254434f
+#define OCTREE_FILE_VERSION 1
+
+// Writes a sequence of octrees, one record per frame (per tile out-of-core, the tiles of a frame share its number). The
+// file starts with the magic and version (32 bit each), then the records. A record is the frame number (32 bit), the
+// size of the archive (64 bit) and the archive itself, such that readers can skip frames without deserializing them
 class OctreeCompressor
 {
 private:
 	std::ofstream m_CompressedFile;
+
+	unsigned int m_NumRecords;
 public:
 	OctreeCompressor(std::string file);
 	~OctreeCompressor(void);
 
-	void Compress(Octree *octree);
+	// Append the octree of a frame, the record is on disk when this returns
+	void Compress(Octree *octree, const int frame);
+
+	unsigned int GetNumRecords(void) const
+	{
+		return this->m_NumRecords;
+	}
 };
\ No newline at end of file
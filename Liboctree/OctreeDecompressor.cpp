@@ -1,15 +1,31 @@
 #include "Stdafx.h"
 
 #include "OctreeDecompressor.h"
+#include "OctreeCompressor.h"
 #include "Exception.h"
 
 OctreeDecompressor::OctreeDecompressor(std::string file)
 {
-	// Create output stream for compressed pointcloud file
+	// Create input stream for compressed pointcloud file
 	this->m_CompressedFile.open(file.c_str(), std::ios::in | std::ios::binary);
 	if (!this->m_CompressedFile.good())
 	{
-		throw_line("Could not open compressed file for writing");
+		throw_line("Could not open compressed file for reading: " + file);
+	}
+
+	unsigned int magic = 0, version = 0;
+	this->m_CompressedFile.read((char*)&magic, sizeof(magic));
+	this->m_CompressedFile.read((char*)&version, sizeof(version));
+	if (!this->m_CompressedFile.good() || magic != OCTREE_FILE_MAGIC)
+	{
+		throw_line("Not a compressed octree file: " + file);
+	}
+
+	if (version != OCTREE_FILE_VERSION)
+	{
+		std::ostringstream message;
+		message << "Compressed file has version " << version << ", only version " << OCTREE_FILE_VERSION << " can be read";
+		throw_line(message.str());
 	}
 }
 
@@ -18,12 +34,47 @@ OctreeDecompressor::~OctreeDecompressor()
 	this->m_CompressedFile.close();
 }
 
-Octree *OctreeDecompressor::Decompress(void)
+static bool read_record_header(std::ifstream &in, int &frame, unsigned long long int &size)
 {
+	in.read((char*)&frame, sizeof(frame));
+	in.read((char*)&size, sizeof(size));
+
+	return in.gcount() == sizeof(size) && in.good();
+}
+
+Octree *OctreeDecompressor::Decompress(int &frame)
+{
+	unsigned long long int size;
+	if (!read_record_header(this->m_CompressedFile, frame, size))
+	{
+		return 0;
+	}
+
+	std::string data((size_t)size, '\0');
+	this->m_CompressedFile.read(&data[0], size);
+	if (!this->m_CompressedFile.good())
+	{
+		throw_line("Compressed file ends in the middle of a record");
+	}
+
 	Octree *octree;
 
-	boost::archive::binary_iarchive archive(this->m_CompressedFile);
+	std::istringstream buffer(data, std::ios::in | std::ios::binary);
+	boost::archive::binary_iarchive archive(buffer);
 	archive >> octree;
 
 	return octree;
+}
+
+bool OctreeDecompressor::Skip(int &frame)
+{
+	unsigned long long int size;
+	if (!read_record_header(this->m_CompressedFile, frame, size))
+	{
+		return false;
+	}
+
+	this->m_CompressedFile.seekg(size, std::ios::cur);
+
+	return true;
 }
\ No newline at end of file
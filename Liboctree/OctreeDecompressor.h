@@ -2,6 +2,7 @@
 
 #include "Octree.h"
 
+// Reads the records written by OctreeCompressor one after the other
 class OctreeDecompressor
 {
 private:
@@ -10,5 +11,9 @@ public:
 	OctreeDecompressor(std::string file);
 	~OctreeDecompressor(void);
 
-	Octree *Decompress(void);
+	// Next octree and its frame number, returns 0 after the last record. The caller owns the octree
+	Octree *Decompress(int &frame);
+
+	// Move past the next record without deserializing it, returns false after the last record
+	bool Skip(int &frame);
 };
\ No newline at end of file
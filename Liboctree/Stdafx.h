@@ -4,9 +4,12 @@
 
 // Stdlib
 #include <iostream>
+#include <cassert>
+#include <vector>
 #include <string>
 #include <chrono>
 #include <fstream>
+#include <sstream>
 #include <thread>
 
 // Boost
@@ -15,6 +18,9 @@
 #include <boost/archive/binary_iarchive.hpp> 
 #include <boost/filesystem.hpp>
 #include <boost/serialization/list.hpp>
+#include <boost/serialization/version.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 // GLM
 #include <glm/glm.hpp>
@@ -0,0 +1,222 @@
+#include "Stdafx.h"
+
+#include "TileStore.h"
+#include "Exception.h"
+
+TileStore::TileStore(std::string file) : m_File(file)
+{
+	this->m_Mapping = 0;
+	this->m_Region = 0;
+
+	this->m_Size = 0;
+	this->m_NumVoxels = 0;
+}
+
+TileStore::~TileStore(void)
+{
+	this->Unmap();
+
+	if (this->m_Data.is_open())
+	{
+		this->m_Data.close();
+	}
+}
+
+void TileStore::Clear(void)
+{
+	this->Unmap();
+
+	if (this->m_Data.is_open())
+	{
+		this->m_Data.close();
+	}
+
+	this->m_Index.clear();
+	this->m_Size = 0;
+	this->m_NumVoxels = 0;
+}
+
+void TileStore::AddTile(const int originX, const int originY, const int originZ, const VisibleVoxel *voxels, const unsigned long long int numVoxels)
+{
+	// The data file is (re)created on the first tile after a clear
+	if (!this->m_Data.is_open())
+	{
+		this->Unmap();
+
+		this->m_Data.open(this->m_File.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+		if (!this->m_Data.good())
+		{
+			throw_line("Could not open tile file for writing");
+		}
+	}
+
+	TileHeader header;
+	header.OriginX = originX;
+	header.OriginY = originY;
+	header.OriginZ = originZ;
+	header.NumVoxels = numVoxels;
+	header.Offset = this->m_Size;
+
+	// Bounds are kept with the tile, later stages don't have to map it to know where the hull is
+	for (int a = 0 ; a < 3 ; ++a)
+	{
+		header.Min[a] = header.Max[a] = 0;
+	}
+	for (unsigned long long int i = 0 ; i < numVoxels ; ++i)
+	{
+		const int c[3] = { originX + voxels[i].X, originY + voxels[i].Y, originZ + voxels[i].Z };
+
+		for (int a = 0 ; a < 3 ; ++a)
+		{
+			header.Min[a] = i == 0 || c[a] < header.Min[a] ? c[a] : header.Min[a];
+			header.Max[a] = i == 0 || c[a] > header.Max[a] ? c[a] : header.Max[a];
+		}
+	}
+
+	if (numVoxels > 0)
+	{
+		this->m_Data.write((const char*)voxels, sizeof(VisibleVoxel) * numVoxels);
+		if (!this->m_Data.good())
+		{
+			throw_line("Failed to spill tile to disk");
+		}
+	}
+
+	this->m_Index.push_back(header);
+
+	this->m_Size += sizeof(VisibleVoxel) * numVoxels;
+	this->m_NumVoxels += numVoxels;
+}
+
+void TileStore::WriteIndex(void)
+{
+	std::ofstream index((this->m_File + ".idx").c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!index.good())
+	{
+		throw_line("Could not open tile index for writing");
+	}
+
+	const unsigned int version = TILE_INDEX_VERSION;
+	index.write((const char*)&version, sizeof(unsigned int));
+
+	const unsigned int numTiles = (unsigned int)this->m_Index.size();
+	index.write((const char*)&numTiles, sizeof(unsigned int));
+	if (numTiles > 0)
+	{
+		index.write((const char*)&this->m_Index[0], sizeof(TileHeader) * numTiles);
+	}
+
+	index.close();
+}
+
+void TileStore::Flush(void)
+{
+	if (this->m_Data.is_open())
+	{
+		this->m_Data.close();
+	}
+
+	this->WriteIndex();
+}
+
+bool TileStore::Load(void)
+{
+	this->Clear();
+
+	std::ifstream index((this->m_File + ".idx").c_str(), std::ios::in | std::ios::binary);
+	if (!index.good())
+	{
+		return false;
+	}
+
+	// Indices of another layout are written again on the next frame
+	unsigned int version = 0;
+	index.read((char*)&version, sizeof(unsigned int));
+	if (!index.good() || version != TILE_INDEX_VERSION)
+	{
+		return false;
+	}
+
+	unsigned int numTiles = 0;
+	index.read((char*)&numTiles, sizeof(unsigned int));
+
+	this->m_Index.resize(numTiles);
+	if (numTiles > 0)
+	{
+		index.read((char*)&this->m_Index[0], sizeof(TileHeader) * numTiles);
+	}
+
+	if (!index.good())
+	{
+		this->m_Index.clear();
+		return false;
+	}
+
+	std::vector<TileHeader>::const_iterator it;
+	for (it = this->m_Index.begin() ; it != this->m_Index.end() ; ++it)
+	{
+		this->m_NumVoxels += it->NumVoxels;
+		this->m_Size = it->Offset + it->NumVoxels * sizeof(VisibleVoxel);
+	}
+
+	return true;
+}
+
+bool TileStore::GetBounds(int min[3], int max[3]) const
+{
+	bool found = false;
+
+	std::vector<TileHeader>::const_iterator it;
+	for (it = this->m_Index.begin() ; it != this->m_Index.end() ; ++it)
+	{
+		if (it->NumVoxels == 0)
+		{
+			continue;
+		}
+
+		for (int a = 0 ; a < 3 ; ++a)
+		{
+			min[a] = !found || it->Min[a] < min[a] ? it->Min[a] : min[a];
+			max[a] = !found || it->Max[a] > max[a] ? it->Max[a] : max[a];
+		}
+
+		found = true;
+	}
+
+	return found;
+}
+
+const VisibleVoxel *TileStore::MapTile(const unsigned int tile)
+{
+	assert(!this->m_Data.is_open());
+	assert(tile < this->m_Index.size());
+
+	const TileHeader &header = this->m_Index[tile];
+
+	delete this->m_Region;
+	this->m_Region = 0;
+
+	if (header.NumVoxels == 0)
+	{
+		return 0;
+	}
+
+	if (this->m_Mapping == 0)
+	{
+		this->m_Mapping = new boost::interprocess::file_mapping(this->m_File.c_str(), boost::interprocess::read_only);
+	}
+
+	// The region takes care of aligning the offset to the page size
+	this->m_Region = new boost::interprocess::mapped_region(*this->m_Mapping, boost::interprocess::read_only, header.Offset, sizeof(VisibleVoxel) * header.NumVoxels);
+
+	return (const VisibleVoxel*)this->m_Region->get_address();
+}
+
+void TileStore::Unmap(void)
+{
+	delete this->m_Region;
+	this->m_Region = 0;
+
+	delete this->m_Mapping;
+	this->m_Mapping = 0;
+}
\ No newline at end of file
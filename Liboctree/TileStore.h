@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+
+#include "VisibleVoxel.h"
+
+// Bumped whenever the layout of the tile index changes
+#define TILE_INDEX_VERSION 2
+
+typedef struct TileHeader
+{
+	// World coordinates of the tile origin, voxels in the tile are stored relative to this origin such that their
+	// coordinates fit in 16 bits regardless of the size of the voxel space
+	int OriginX, OriginY, OriginZ;
+
+	unsigned long long int NumVoxels;
+
+	// World coordinates of the lowest and highest voxel along every axis, only set when the tile has voxels
+	int Min[3], Max[3];
+
+	// Byte offset of the first voxel of this tile in the data file
+	unsigned long long int Offset;
+} TileHeader;
+
+// Disk backed storage for independently carved tiles of the voxel space. Tiles are appended to a data file while
+// carving, a tile index is written next to it (file + ".idx") and later stages map the tiles back in one at a time,
+// so only a single tile has to be resident at any moment
+class TileStore
+{
+private:
+	const std::string m_File;
+
+	std::ofstream m_Data;
+
+	std::vector<TileHeader> m_Index;
+
+	unsigned long long int m_Size;
+	unsigned long long int m_NumVoxels;
+
+	boost::interprocess::file_mapping *m_Mapping;
+	boost::interprocess::mapped_region *m_Region;
+
+	void WriteIndex(void);
+public:
+	TileStore(std::string file);
+	~TileStore(void);
+
+	// Drop all tiles, the data file is truncated
+	void Clear(void);
+
+	// Append a tile, voxels are expected to be relative to the given origin already
+	void AddTile(const int originX, const int originY, const int originZ, const VisibleVoxel *voxels, const unsigned long long int numVoxels);
+
+	// Finish writing, after flushing tiles can be mapped
+	void Flush(void);
+
+	// Map a tile into memory, the returned pointer is a view into the mapping and stays valid until the next call to MapTile
+	// or Unmap. Returns 0 for empty tiles
+	const VisibleVoxel *MapTile(const unsigned int tile);
+	void Unmap(void);
+
+	// Reload the tile index of a previously written store
+	bool Load(void);
+
+	unsigned int GetNumTiles(void) const { return (unsigned int)this->m_Index.size(); }
+
+	const TileHeader &GetTile(const unsigned int tile) const { return this->m_Index[tile]; }
+
+	unsigned long long int GetNumVoxels(void) const { return this->m_NumVoxels; }
+
+	unsigned long long int GetSize(void) const { return this->m_Size; }
+
+	// Bounds of the voxels of all tiles in world coordinates, from the tile index. Returns false if there are no voxels
+	bool GetBounds(int min[3], int max[3]) const;
+};
\ No newline at end of file
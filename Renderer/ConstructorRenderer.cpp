@@ -22,8 +22,38 @@ ConstructorRenderer::~ConstructorRenderer()
 
 void ConstructorRenderer::Run(void)
 {
-	Octree *octree = this->m_Decompressor->Decompress();
-	OctreeRenderer renderer(octree);
+	// Shows the first frame of the sequence, out-of-core reconstruction writes every tile of a frame as a record of its own
+	std::vector<Octree*> octrees;
+
+	int first = 0, frame;
+	Octree *octree;
+	while ((octree = this->m_Decompressor->Decompress(frame)) != 0)
+	{
+		if (!octrees.empty() && frame != first)
+		{
+			delete octree;
+			break;
+		}
+
+		first = frame;
+		octrees.push_back(octree);
+	}
+
+	if (octrees.empty())
+	{
+		throw_line("No octrees in the input file");
+	}
+
+	std::cout << "Rendering frame " << first << " from " << octrees.size() << (octrees.size() > 1 ? " tiles" : " octree") << std::endl;
+
+	{
+		OctreeRenderer renderer(octrees);
+	}
+
+	for (size_t i = 0 ; i < octrees.size() ; ++i)
+	{
+		delete octrees[i];
+	}
 }
 
 void ConstructorRenderer::ParseArguments(void)
@@ -5,9 +5,9 @@
 
 #define ASSERT_GL() assert(glGetError() == GL_NO_ERROR)
 
-OctreeRenderer::OctreeRenderer(Octree *octree, const unsigned int width, const unsigned int height) : m_Width(width), m_Height(height), m_NumVertices(0)
+OctreeRenderer::OctreeRenderer(const std::vector<Octree*> &octrees, const unsigned int width, const unsigned int height) : m_Width(width), m_Height(height), m_NumVertices(0)
 {
-	this->m_Octree = octree;
+	this->m_Octrees = octrees;
 	this->m_Camera = new Camera(glm::vec2(width, height));
 
 	// Reset keys
@@ -273,16 +273,35 @@ void OctreeRenderer::InitShaders(void)
 	ASSERT_GL();
 }
 
-void OctreeRenderer::NodeToVertexList(OctreeNode *node, VertexBufferObject *vbo)
+glm::vec3 OctreeRenderer::ToWorld(Octree *octree, const glm::vec3 &p) const
 {
-	vbo->AddVertex(Vertex(node->Center.x - node->Halfsize.x, node->Center.y - node->Halfsize.y, node->Center.z - node->Halfsize.z, 1.0f, 1.0f, 1.0f, 0.2f));
-	vbo->AddVertex(Vertex(node->Center.x - node->Halfsize.x, node->Center.y + node->Halfsize.y, node->Center.z - node->Halfsize.z, 1.0f, 1.0f, 1.0f, 0.2f));
-	vbo->AddVertex(Vertex(node->Center.x + node->Halfsize.x, node->Center.y + node->Halfsize.y, node->Center.z - node->Halfsize.z, 1.0f, 1.0f, 1.0f, 0.2f));
-	vbo->AddVertex(Vertex(node->Center.x + node->Halfsize.x, node->Center.y - node->Halfsize.y, node->Center.z - node->Halfsize.z, 1.0f, 1.0f, 1.0f, 0.2f));
-	vbo->AddVertex(Vertex(node->Center.x - node->Halfsize.x, node->Center.y - node->Halfsize.y, node->Center.z + node->Halfsize.z, 1.0f, 1.0f, 1.0f, 0.2f));
-	vbo->AddVertex(Vertex(node->Center.x - node->Halfsize.x, node->Center.y + node->Halfsize.y, node->Center.z + node->Halfsize.z, 1.0f, 1.0f, 1.0f, 0.2f));
-	vbo->AddVertex(Vertex(node->Center.x + node->Halfsize.x, node->Center.y + node->Halfsize.y, node->Center.z + node->Halfsize.z, 1.0f, 1.0f, 1.0f, 0.2f));
-	vbo->AddVertex(Vertex(node->Center.x + node->Halfsize.x, node->Center.y - node->Halfsize.y, node->Center.z + node->Halfsize.z, 1.0f, 1.0f, 1.0f, 0.2f));
+	// Tile relative to volume coordinates, then through the volume transformation to the world
+	const glm::vec3 v = p + octree->GetOrigin();
+
+	return octree->GetVolumeAxis(0) * v.x + octree->GetVolumeAxis(1) * v.y + octree->GetVolumeAxis(2) * v.z + octree->GetVolumeOrigin();
+}
+
+void OctreeRenderer::NodeToVertexList(Octree *octree, OctreeNode *node, VertexBufferObject *vbo, const glm::vec4 &color)
+{
+	const glm::vec3 &c = node->Center;
+	const glm::vec3 &h = node->Halfsize;
+
+	const glm::vec3 corners[8] = {
+		glm::vec3(c.x - h.x, c.y - h.y, c.z - h.z),
+		glm::vec3(c.x - h.x, c.y + h.y, c.z - h.z),
+		glm::vec3(c.x + h.x, c.y + h.y, c.z - h.z),
+		glm::vec3(c.x + h.x, c.y - h.y, c.z - h.z),
+		glm::vec3(c.x - h.x, c.y - h.y, c.z + h.z),
+		glm::vec3(c.x - h.x, c.y + h.y, c.z + h.z),
+		glm::vec3(c.x + h.x, c.y + h.y, c.z + h.z),
+		glm::vec3(c.x + h.x, c.y - h.y, c.z + h.z)
+	};
+
+	for (int i = 0 ; i < 8 ; ++i)
+	{
+		const glm::vec3 p = this->ToWorld(octree, corners[i]);
+		vbo->AddVertex(Vertex(p.x, p.y, p.z, color.r, color.g, color.b, color.a));
+	}
 }
 
 void OctreeRenderer::NodeToIndexList(const unsigned int offset, VertexBufferObject *vbo)
@@ -306,17 +325,18 @@ void OctreeRenderer::NodeToIndexList(const unsigned int offset, VertexBufferObje
 	vbo->AddIndex(offset + 0); vbo->AddIndex(offset + 4); vbo->AddIndex(offset + 3);
 }
 
-void OctreeRenderer::BuildBuffers(OctreeNode *node, VertexBufferObject *points, VertexBufferObject *root, VertexBufferObject *nodes)
+void OctreeRenderer::BuildBuffers(Octree *octree, OctreeNode *node, VertexBufferObject *points, VertexBufferObject *root, VertexBufferObject *nodes, VertexBufferObject *full)
 {
 	if (node->IsRoot)
 	{
-		this->NodeToVertexList(node, root);
-		this->NodeToIndexList(0, root);
+		int i = root->GetNumVertices();
+		this->NodeToVertexList(octree, node, root);
+		this->NodeToIndexList(i, root);
 	}
 	else
 	{
 		int i = nodes->GetNumVertices();
-		this->NodeToVertexList(node, nodes);
+		this->NodeToVertexList(octree, node, nodes);
 		this->NodeToIndexList(i, nodes);
 	}
 
@@ -325,19 +345,28 @@ void OctreeRenderer::BuildBuffers(OctreeNode *node, VertexBufferObject *points,
 		OctreeNode *child = node->FirstChild;
 		do
 		{
-			this->BuildBuffers(child, points, root, nodes);
+			this->BuildBuffers(octree, child, points, root, nodes, full);
 		}
 		while ((child = child->NextSibling) != 0);
 	}
+	else if (node->IsFull)
+	{
+		// Hierarchical carving stores blocks inside the hull as a single node with one colour, draw it as a solid cube
+		int i = full->GetNumVertices();
+		this->NodeToVertexList(octree, node, full, glm::vec4(node->R / 255.0f, node->G / 255.0f, node->B / 255.0f, 1.0f));
+		this->NodeToIndexList(i, full);
+	}
 	else
 	{
 		std::list<VisibleVoxel*>::const_iterator it;
 		for (it = node->Objects.begin() ; it != node->Objects.end() ; ++it)
 		{
+			const glm::vec3 p = this->ToWorld(octree, glm::vec3((*it)->X, (*it)->Y, (*it)->Z));
+
 			Vertex v;
-			v.X = (*it)->X;
-			v.Y = (*it)->Y;
-			v.Z = (*it)->Z;
+			v.X = p.x;
+			v.Y = p.y;
+			v.Z = p.z;
 			v.R = float((*it)->R) / 255.0;
 			v.G = float((*it)->G) / 255.0;
 			v.B = float((*it)->B) / 255.0;
@@ -357,21 +386,29 @@ void OctreeRenderer::CreateVboVaoFromOctree(void)
 	VertexBufferObject *octreePoints = new VertexBufferObject(GL_POINTS);
 	VertexBufferObject *root = new VertexBufferObject(GL_LINE_STRIP);
 	VertexBufferObject *nodes = new VertexBufferObject(GL_LINE_STRIP);
+	VertexBufferObject *full = new VertexBufferObject(GL_TRIANGLES);
 
-	// Create vertices from octree
-	this->BuildBuffers(this->m_Octree->GetRoot(), octreePoints, root, nodes);
+	// Create vertices from the octrees
+	std::vector<Octree*>::const_iterator it;
+	for (it = this->m_Octrees.begin() ; it != this->m_Octrees.end() ; ++it)
+	{
+		this->BuildBuffers(*it, (*it)->GetRoot(), octreePoints, root, nodes, full);
+	}
 
 	octreePoints->Build();
 	root->Build();
 	nodes->Build();
+	full->Build();
 
 	root->SetRotation(glm::vec3(0, 0, 5));
 	octreePoints->SetRotation(glm::vec3(0, 0, 5));
 	nodes->SetRotation(glm::vec3(0, 0, 5));
+	full->SetRotation(glm::vec3(0, 0, 5));
 
 	this->m_Objects["Root"] = root;
 	this->m_Objects["Points"] = octreePoints;
 	this->m_Objects["Nodes"] = nodes;
+	this->m_Objects["Full"] = full;
 }
 
 void OctreeRenderer::ErrorCallback(int error, const char *description)
@@ -408,6 +445,10 @@ void OctreeRenderer::OnKey(GLFWwindow *window, int key, int scancode, int action
 			{
 				this->m_Objects["Nodes"]->HideToggle();
 			}
+			else if (key == GLFW_KEY_4)
+			{
+				this->m_Objects["Full"]->HideToggle();
+			}
 		}
 		else if (action == GLFW_RELEASE)
 		{
@@ -23,7 +23,8 @@ private:
 
 	std::thread *m_RenderThread;
 
-	Octree *m_Octree;
+	// Octrees of a frame, a single one or one per tile
+	std::vector<Octree*> m_Octrees;
 
 	GLfloat m_DeltaTime, m_LastFrame;
 
@@ -35,14 +36,17 @@ private:
 
 	void Render(void);
 
-	void NodeToVertexList(OctreeNode *node, VertexBufferObject *vbo);
+	// Voxel and node positions are relative to the origin of their octree, in volume coordinates
+	glm::vec3 ToWorld(Octree *octree, const glm::vec3 &p) const;
+
+	void NodeToVertexList(Octree *octree, OctreeNode *node, VertexBufferObject *vbo, const glm::vec4 &color = glm::vec4(1.0f, 1.0f, 1.0f, 0.2f));
 	void NodeToIndexList(const unsigned int offset, VertexBufferObject *vbo);
 
 	void InitShaders(void);
-	void BuildBuffers(OctreeNode *node, VertexBufferObject *points, VertexBufferObject *root, VertexBufferObject *nodes);
+	void BuildBuffers(Octree *octree, OctreeNode *node, VertexBufferObject *points, VertexBufferObject *root, VertexBufferObject *nodes, VertexBufferObject *full);
 	void CreateVboVaoFromOctree(void);
 public:
-	OctreeRenderer(Octree *octree, const unsigned int width = 1280, const unsigned int height = 800);
+	OctreeRenderer(const std::vector<Octree*> &octrees, const unsigned int width = 1280, const unsigned int height = 800);
 	~OctreeRenderer(void);
 
 	bool ShouldStop(void) { return glfwWindowShouldClose(this->m_Window); }
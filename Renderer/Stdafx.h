@@ -17,6 +17,7 @@
 #include <boost/archive/binary_iarchive.hpp> 
 #include <boost/filesystem.hpp>
 #include <boost/serialization/list.hpp>
+#include <boost/serialization/version.hpp>
 
 // CUDA Runtime, Interop, and includes
 #include <cuda_runtime.h>
@@ -0,0 +1,126 @@
+#include "Stdafx.h"
+
+#include <random>
+
+#include "compute_matte_host.h"
+
+#include "Test.h"
+
+#define FRAMES_PER_SIZE 16
+
+// Compares the AVX2 keyer to the scalar reference over random frames, key colors, tresholds and tolerances. The mattes
+// should be identical bit for bit
+
+// Widths around the 32 pixel steps of the vectorized loop, so the tail of the row is hit at every length
+static const int s_Widths[] = { 1, 2, 3, 31, 32, 33, 34, 35, 63, 64, 65, 66, 67, 97, 127, 640, 641, 1917 };
+
+// Tresholds and tolerances the keyer should handle, including empty and inverted ramps and values past the signed range
+static const unsigned int s_Bounds[][2] = {
+	{ 0, 0 }, { 0, 1 }, { 0, 255 }, { 10, 10 }, { 20, 10 }, { 254, 255 }, { 255, 255 }, { 0, 1000 }, { 300, 400 },
+	{ 0x7fffffff, 0xffffffff }, { 0xffffffff, 0xffffffff }, { 5, 0xffffffff }
+};
+
+// Random frame, part of the pixels are drawn close to the key color so the ramp between treshold and tolerance is hit
+static void RandomFrame(std::mt19937 &random, const cv::Vec3i &color, cv::Mat &frame)
+{
+	std::uniform_int_distribution<int> byte(0, 255);
+	std::uniform_int_distribution<int> near(-24, 24);
+
+	for (int y = 0 ; y < frame.rows ; ++y)
+	{
+		uchar *row = frame.ptr<uchar>(y);
+		for (int x = 0 ; x < frame.cols ; ++x)
+		{
+			const bool isNear = (byte(random) & 1) == 0;
+			for (int c = 0 ; c < 3 ; ++c)
+			{
+				int v = isNear ? color[c] + near(random) : byte(random);
+				row[x * 3 + c] = uchar(v < 0 ? 0 : (v > 255 ? 255 : v));
+			}
+		}
+	}
+}
+
+static bool CompareMattes(const cv::Mat &frame, const cv::Vec3i &color, const unsigned int treshold, const unsigned int tolerance)
+{
+	cv::Mat reference, vectorized;
+	compute_matte_scalar(color, treshold, tolerance, frame, reference);
+	compute_matte_avx2(color, treshold, tolerance, frame, vectorized);
+
+	CHECK(reference.size() == frame.size());
+	CHECK(vectorized.size() == frame.size());
+
+	for (int y = 0 ; y < frame.rows ; ++y)
+	{
+		const uchar *r = reference.ptr<uchar>(y);
+		const uchar *v = vectorized.ptr<uchar>(y);
+
+		for (int x = 0 ; x < frame.cols ; ++x)
+		{
+			if (r[x] != v[x])
+			{
+				std::cout << "Matte mismatch at (" << x << ", " << y << ") of a " << frame.cols << "x" << frame.rows << " frame, key (" << color[0] << ", " << color[1] << ", " << color[2] << "), treshold " << treshold << ", tolerance " << tolerance << ": " << int(r[x]) << " vs " << int(v[x]) << std::endl;
+
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool TestComputeMatteHost(void)
+{
+	if (!has_avx2())
+	{
+		std::cout << "No AVX2 on this CPU, skipped" << std::endl;
+
+		return true;
+	}
+
+	std::mt19937 random(1234);
+	std::uniform_int_distribution<int> byte(0, 255);
+	std::uniform_int_distribution<int> bound(0, 300);
+	std::uniform_int_distribution<int> rows(1, 9);
+
+	const int numWidths = sizeof(s_Widths) / sizeof(s_Widths[0]);
+	const int numBounds = sizeof(s_Bounds) / sizeof(s_Bounds[0]);
+
+	for (int w = 0 ; w < numWidths ; ++w)
+	{
+		for (int i = 0 ; i < FRAMES_PER_SIZE ; ++i)
+		{
+			const cv::Vec3i color(byte(random), byte(random), byte(random));
+
+			cv::Mat frame(rows(random), s_Widths[w], CV_8UC3);
+			RandomFrame(random, color, frame);
+
+			// Random ramp, the treshold is usually below the tolerance
+			unsigned int treshold = bound(random);
+			unsigned int tolerance = bound(random);
+			if (treshold > tolerance && (byte(random) & 3) != 0)
+			{
+				std::swap(treshold, tolerance);
+			}
+
+			CHECK(CompareMattes(frame, color, treshold, tolerance));
+
+			const unsigned int *b = s_Bounds[i % numBounds];
+			CHECK(CompareMattes(frame, color, b[0], b[1]));
+
+			// The key color itself, the distance is 0
+			cv::Mat key(1, s_Widths[w], CV_8UC3, cv::Scalar(color[0], color[1], color[2]));
+			CHECK(CompareMattes(key, color, treshold, tolerance));
+		}
+	}
+
+	// Rows of a frame that aren't continuous, the keyer should go by the step of the frame
+	const cv::Vec3i color(40, 200, 60);
+
+	cv::Mat frame(64, 300, CV_8UC3);
+	RandomFrame(random, color, frame);
+
+	CHECK(CompareMattes(frame(cv::Rect(3, 5, 257, 50)), color, 20, 80));
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "Stdafx.h"
+
+#include "DeadlineController.h"
+#include "TileStore.h"
+
+#include "Test.h"
+
+// Checks that deadline mode narrows the carved region to the hull of out-of-core tiles, whose bounds are kept in the tile
+// index so the tiles don't have to be mapped again
+
+// Full voxel space of the test as (xL, xR, yL, yR, zL, zR)
+static const int s_Region[6] = { -512, 512, -512, 512, 0, 512 };
+
+static void MakeVoxel(const int x, const int y, const int z, VisibleVoxel &voxel)
+{
+	voxel.X = x;
+	voxel.Y = y;
+	voxel.Z = z;
+	voxel.R = voxel.G = voxel.B = 255;
+}
+
+static bool CheckTileRegion(const std::string &file)
+{
+	TileStore store(file);
+
+	int hullMin[3], hullMax[3];
+	CHECK(!store.GetBounds(hullMin, hullMax));
+
+	// Two tiles with voxels relative to their origins and an empty tile in between
+	VisibleVoxel first[2], second[2];
+	MakeVoxel(10, 20, 30, first[0]);
+	MakeVoxel(40, 5, 60, first[1]);
+	MakeVoxel(0, 0, 0, second[0]);
+	MakeVoxel(25, 35, 45, second[1]);
+
+	store.AddTile(-100, -100, 0, first, 2);
+	store.AddTile(0, 0, 0, 0, 0);
+	store.AddTile(50, -40, 100, second, 2);
+	store.Flush();
+
+	CHECK(store.GetBounds(hullMin, hullMax));
+	CHECK(hullMin[0] == -90 && hullMin[1] == -95 && hullMin[2] == 30);
+	CHECK(hullMax[0] == 75 && hullMax[1] == -5 && hullMax[2] == 145);
+
+	// The bounds survive reloading the index
+	CHECK(store.Load());
+	CHECK(store.GetBounds(hullMin, hullMax));
+	CHECK(hullMin[0] == -90 && hullMax[2] == 145);
+
+	// The region shrinks to the hull and its margin, at any step
+	for (int step = 1 ; step <= 4 ; ++step)
+	{
+		int min[3], max[3];
+		CHECK(DeadlineController::NextRegion(hullMin, hullMax, s_Region, step, min, max));
+
+		for (int a = 0 ; a < 3 ; ++a)
+		{
+			CHECK(min[a] == hullMin[a] - DEADLINE_REGION_MARGIN * step);
+			CHECK(max[a] == hullMax[a] + DEADLINE_REGION_MARGIN * step);
+			CHECK(min[a] > s_Region[a * 2] && max[a] < s_Region[a * 2 + 1]);
+		}
+	}
+
+	// A hull touching the border may have been cut off, the full voxel space is carved again
+	int min[3], max[3];
+	const int floorMin[3] = { hullMin[0], hullMin[1], s_Region[4] };
+	CHECK(!DeadlineController::NextRegion(floorMin, hullMax, s_Region, 1, min, max));
+
+	const int edgeMax[3] = { s_Region[1] - 1, hullMax[1], hullMax[2] };
+	CHECK(!DeadlineController::NextRegion(hullMin, edgeMax, s_Region, 1, min, max));
+
+	// Cleared stores have no hull
+	store.Clear();
+	CHECK(!store.GetBounds(hullMin, hullMax));
+
+	return true;
+}
+
+bool TestDeadlineRegion(void)
+{
+	const std::string file = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+
+	const bool passed = CheckTileRegion(file);
+
+	boost::filesystem::remove(file);
+	boost::filesystem::remove(file + ".idx");
+
+	return passed;
+}
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "Stdafx.h"
+
+#include "KeyframeIndex.h"
+
+#include "Test.h"
+
+// Builds small Matroska and MP4 files with B-frames and an audio track next to the video, and checks that the keyframes
+// are numbered in presentation order
+
+// Frames in decode order as presentation time units, an open GOP with keyframes on units 0 and 6
+static const int s_DecodeOrder[] = { 0, 3, 1, 2, 6, 4, 5, 9, 7, 8 };
+static const int s_NumFrames = sizeof(s_DecodeOrder) / sizeof(s_DecodeOrder[0]);
+
+static std::string BigEndian(const unsigned long long int value, const int bytes)
+{
+	std::string s;
+	for (int i = bytes - 1 ; i >= 0 ; --i)
+	{
+		s += (char)((value >> (i * 8)) & 0xFF);
+	}
+
+	return s;
+}
+
+// Matroska element, sizes are written as 8 byte variable length integers
+static std::string Element(const unsigned int id, const std::string &content)
+{
+	const int idBytes = id > 0xFFFFFF ? 4 : (id > 0xFFFF ? 3 : (id > 0xFF ? 2 : 1));
+
+	return BigEndian(id, idBytes) + (char)0x01 + BigEndian(content.size(), 7) + content;
+}
+
+static std::string UIntElement(const unsigned int id, const unsigned long long int value)
+{
+	return Element(id, BigEndian(value, 8));
+}
+
+static std::string SimpleBlock(const int track, const int relative, const bool key)
+{
+	return Element(0xA3, std::string(1, (char)(0x80 | track)) + BigEndian((unsigned short)relative, 2) + (char)(key ? 0x80 : 0x00) + "frame");
+}
+
+static std::string CuePoint(const unsigned long long int time, const int track)
+{
+	return Element(0xBB, UIntElement(0xB3, time) + Element(0xB7, UIntElement(0xF7, track) + UIntElement(0xF1, 0)));
+}
+
+static std::string TrackEntry(const int number, const int type)
+{
+	return Element(0xAE, UIntElement(0xD7, number) + UIntElement(0x83, type));
+}
+
+// Video on track 2 at 40 ms per frame from 1000 ms on, audio on track 1. Clusters start at 1000 and 1200 ms
+static std::string MakeMatroska(const int *times, const int numFrames)
+{
+	std::string clusters[2];
+	for (int c = 0 ; c < 2 ; ++c)
+	{
+		clusters[c] = UIntElement(0xE7, 1000 + c * 200);
+	}
+
+	for (int i = 0 ; i < numFrames ; ++i)
+	{
+		const int c = i < numFrames / 2 ? 0 : 1;
+		clusters[c] += SimpleBlock(2, times[i] - c * 200, i == 0 || i == numFrames / 2 - 1);
+		clusters[c] += SimpleBlock(1, times[i] - c * 200 + 10, true);
+	}
+
+	// The audio cues fall between frames and on a frame, neither are keyframes of the video
+	const std::string cues = CuePoint(1000, 2) + CuePoint(1000 + times[numFrames / 2 - 1], 2) + CuePoint(1010, 1) + CuePoint(1000 + times[1], 1);
+
+	const std::string segment =
+		Element(0x1549A966, UIntElement(0x2AD7B1, 1000000)) +
+		Element(0x1654AE6B, TrackEntry(1, 2) + TrackEntry(2, 1)) +
+		Element(0x1F43B675, clusters[0]) +
+		Element(0x1F43B675, clusters[1]) +
+		Element(0x1C53BB6B, cues);
+
+	return Element(0x1A45DFA3, UIntElement(0x4286, 1)) + Element(0x18538067, segment);
+}
+
+static std::string Box(const char *type, const std::string &content)
+{
+	return BigEndian(content.size() + 8, 4) + std::string(type, 4) + content;
+}
+
+static std::string FullBox(const char *type, const std::string &content)
+{
+	return Box(type, BigEndian(0, 4) + content);
+}
+
+static std::string Handler(const char *type)
+{
+	return FullBox("hdlr", BigEndian(0, 4) + std::string(type, 4) + std::string(13, '\0'));
+}
+
+static std::string SampleTable(const std::vector<int> &offsets, const std::vector<int> &syncSamples, const int duration)
+{
+	std::string stts = BigEndian(1, 4) + BigEndian(offsets.size(), 4) + BigEndian(duration, 4);
+
+	std::string ctts = BigEndian(offsets.size(), 4);
+	for (size_t i = 0 ; i < offsets.size() ; ++i)
+	{
+		ctts += BigEndian(1, 4) + BigEndian(offsets[i] * duration, 4);
+	}
+
+	std::string stss = BigEndian(syncSamples.size(), 4);
+	for (size_t i = 0 ; i < syncSamples.size() ; ++i)
+	{
+		stss += BigEndian(syncSamples[i], 4);
+	}
+
+	return Box("stbl", FullBox("stts", stts) + FullBox("ctts", ctts) + FullBox("stss", stss));
+}
+
+// An audio track followed by the video track, the video starts at the edit list media time
+static std::string MakeMp4(const int *times, const int numFrames, const int mediaTime)
+{
+	const int duration = 512;
+
+	// Presentation starts at 1, the composition offsets are positive
+	std::vector<int> offsets, syncSamples;
+	for (int i = 0 ; i < numFrames ; ++i)
+	{
+		offsets.push_back(times[i] + 1 - i);
+
+		if (times[i] == 0 || times[i] == 6)
+		{
+			syncSamples.push_back(i + 1);
+		}
+	}
+
+	std::vector<int> audioSyncSamples(1, 2);
+
+	const std::string audio = Box("trak", Box("mdia", Handler("soun") + Box("minf", SampleTable(std::vector<int>(numFrames, 0), audioSyncSamples, 1024))));
+
+	const std::string elst = FullBox("elst", BigEndian(1, 4) + BigEndian(numFrames * duration, 4) + BigEndian(mediaTime, 4) + BigEndian(0x10000, 4));
+	const std::string video = Box("trak", Box("edts", elst) + Box("mdia", Handler("vide") + Box("minf", SampleTable(offsets, syncSamples, duration))));
+
+	return Box("ftyp", "isom" + BigEndian(0, 4)) + Box("moov", audio + video) + Box("mdat", "frames");
+}
+
+static bool WriteFile(const std::string &file, const std::string &content)
+{
+	std::ofstream out(file.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+	out.write(content.data(), content.size());
+
+	return out.good();
+}
+
+static void RemoveFile(const std::string &file)
+{
+	boost::filesystem::remove(file);
+	boost::filesystem::remove(file + ".keyframes.xml");
+}
+
+static bool CheckKeyframes(const std::string &file, const std::string &content, const bool expectIndex)
+{
+	CHECK(WriteFile(file, content));
+
+	KeyframeIndex index(file);
+	RemoveFile(file);
+
+	if (!expectIndex)
+	{
+		CHECK(index.IsEmpty());
+		return true;
+	}
+
+	// Keyframes on presentation units 0 and 6 are frames 0 and 6
+	CHECK(index.GetNumKeyframes() == 2);
+	CHECK(index.GetKeyframe(0) == 0);
+	CHECK(index.GetKeyframe(5) == 0);
+	CHECK(index.GetKeyframe(6) == 6);
+	CHECK(index.GetKeyframe(9) == 6);
+
+	return true;
+}
+
+bool TestKeyframeIndex(void)
+{
+	const std::string base = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+
+	int times[s_NumFrames];
+	for (int i = 0 ; i < s_NumFrames ; ++i)
+	{
+		times[i] = s_DecodeOrder[i] * 40;
+	}
+
+	CHECK(CheckKeyframes(base + ".mkv", MakeMatroska(times, s_NumFrames), true));
+	CHECK(CheckKeyframes(base + ".mp4", MakeMp4(s_DecodeOrder, s_NumFrames, 512), true));
+
+	// An edit list that drops the first frame, the frames can't be counted
+	CHECK(CheckKeyframes(base + ".mp4", MakeMp4(s_DecodeOrder, s_NumFrames, 1024), false));
+
+	// Frames that don't follow a constant rate are left to the capture
+	times[3] += 25;
+	CHECK(CheckKeyframes(base + ".mkv", MakeMatroska(times, s_NumFrames), false));
+
+	return true;
+}
\ No newline at end of file
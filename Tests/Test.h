@@ -0,0 +1,13 @@
+#pragma once
+
+// Checks of a test, a failing check reports where it failed and ends the test
+#define CHECK(a) \
+	if (!(a)) \
+	{ \
+		std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " << #a << std::endl; \
+		return false; \
+	}
+
+bool TestComputeMatteHost(void);
+bool TestKeyframeIndex(void);
+bool TestDeadlineRegion(void);
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include "Stdafx.h"
+
+#include "Test.h"
+
+typedef struct TestCase
+{
+	const char *Name;
+	bool (*Run)(void);
+} TestCase;
+
+int main(int argc, char **argv)
+{
+	const TestCase tests[] = {
+		{ "compute_matte_host", TestComputeMatteHost },
+		{ "KeyframeIndex", TestKeyframeIndex },
+		{ "DeadlineRegion", TestDeadlineRegion },
+	};
+
+	const int numTests = sizeof(tests) / sizeof(tests[0]);
+
+	int failed = 0;
+	for (int i = 0 ; i < numTests ; ++i)
+	{
+		std::cout << "Running " << tests[i].Name << std::endl;
+
+		if (!tests[i].Run())
+		{
+			std::cout << "FAILED " << tests[i].Name << std::endl;
+
+			++failed;
+		}
+	}
+
+	std::cout << (numTests - failed) << " of " << numTests << " tests passed" << std::endl;
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file